@@ -61,6 +61,38 @@ mc_fhl_array_free (mc_fhl_t * fhl)
         g_ptr_array_foreach (fhl->filters, (GFunc) mc_fhl_filter_free, NULL);
         fhl->filters = (GPtrArray *) g_ptr_array_free (fhl->filters, TRUE);
     }
+
+    if (fhl->extensions != NULL)
+    {
+        g_hash_table_destroy (fhl->extensions);
+        fhl->extensions = NULL;
+    }
+
+    if (fhl->extensions_nocase != NULL)
+    {
+        g_hash_table_destroy (fhl->extensions_nocase);
+        fhl->extensions_nocase = NULL;
+    }
+
+    fhl->stamp = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Fold the case of an extension for case insensitive lookups.
+ *
+ * @param ext extension
+ * @param len length of extension or -1 if it is NUL-terminated
+ * @return newly allocated folded extension
+ */
+
+gchar *
+mc_fhl_fold_extension (const gchar * ext, gssize len)
+{
+    if (g_utf8_validate (ext, len, NULL))
+        return g_utf8_casefold (ext, len);
+
+    return g_ascii_strdown (ext, len);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -155,77 +155,96 @@ mc_fhl_is_special (file_entry * fe)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-mc_fhl_get_color_filetype (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry * fe)
+/**
+ * Get all file types of the entry at once.
+ *
+ * @return bitmask of mc_flhgh_ftype_type values the entry belongs to
+ */
+
+static guint
+mc_fhl_get_file_type_mask (file_entry * fe)
 {
-    gboolean my_color = FALSE;
-    (void) fhl;
+    guint mask = 0;
+
+    if (mc_fhl_is_file (fe))
+    {
+        mask |= 1 << MC_FLHGH_FTYPE_T_FILE;
+        if (mc_fhl_is_file_exec (fe))
+            mask |= 1 << MC_FLHGH_FTYPE_T_FILE_EXE;
+    }
+    if (mc_fhl_is_dir (fe) || mc_fhl_is_link_to_dir (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_DIR;
+    if (mc_fhl_is_link_to_dir (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_LINK_DIR;
+    if (mc_fhl_is_link (fe) || mc_fhl_is_hlink (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_LINK;
+    if (mc_fhl_is_hlink (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_HARDLINK;
+    if (mc_fhl_is_link (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_SYMLINK;
+    if (mc_fhl_is_stale_link (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_STALE_LINK;
+    if (mc_fhl_is_device_char (fe) || mc_fhl_is_device_block (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_DEVICE;
+    if (mc_fhl_is_device_block (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_DEVICE_BLOCK;
+    if (mc_fhl_is_device_char (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_DEVICE_CHAR;
+    if (mc_fhl_is_special (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_SPECIAL;
+    if (mc_fhl_is_special_socket (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_SPECIAL_SOCKET;
+    if (mc_fhl_is_special_fifo (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_SPECIAL_FIFO;
+    if (mc_fhl_is_special_door (fe))
+        mask |= 1 << MC_FLHGH_FTYPE_T_SPECIAL_DOOR;
+
+    return mask;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first extension filter matching the name.
+ *
+ * @return index of the filter, or the number of filters if none matches
+ */
+
+static guint
+mc_fhl_get_extension_filter (mc_fhl_t * fhl, file_entry * fe)
+{
+    guint found;
+    const char *dot;
 
-    switch (mc_filter->file_type)
+    found = fhl->filters->len;
+
+    if (fhl->extensions == NULL && fhl->extensions_nocase == NULL)
+        return found;
+
+    /* every dot may start an extension, e.g. both "tar.gz" and "gz" */
+    for (dot = strchr (fe->fname, '.'); dot != NULL; dot = strchr (dot + 1, '.'))
     {
-    case MC_FLHGH_FTYPE_T_FILE:
-        if (mc_fhl_is_file (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_FILE_EXE:
-        if ((mc_fhl_is_file (fe)) && (mc_fhl_is_file_exec (fe)))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_DIR:
-        if (mc_fhl_is_dir (fe) || mc_fhl_is_link_to_dir (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_LINK_DIR:
-        if (mc_fhl_is_link_to_dir (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_LINK:
-        if ((mc_fhl_is_link (fe)) || (mc_fhl_is_hlink (fe)))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_HARDLINK:
-        if (mc_fhl_is_hlink (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_SYMLINK:
-        if (mc_fhl_is_link (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_STALE_LINK:
-        if (mc_fhl_is_stale_link (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_DEVICE:
-        if ((mc_fhl_is_device_char (fe)) || (mc_fhl_is_device_block (fe)))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_DEVICE_BLOCK:
-        if (mc_fhl_is_device_block (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_DEVICE_CHAR:
-        if (mc_fhl_is_device_char (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_SPECIAL:
-        if (mc_fhl_is_special (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_SPECIAL_SOCKET:
-        if (mc_fhl_is_special_socket (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_SPECIAL_FIFO:
-        if (mc_fhl_is_special_fifo (fe))
-            my_color = TRUE;
-        break;
-    case MC_FLHGH_FTYPE_T_SPECIAL_DOOR:
-        if (mc_fhl_is_special_door (fe))
-            my_color = TRUE;
-        break;
+        guint i;
+
+        if (fhl->extensions != NULL)
+        {
+            i = GPOINTER_TO_UINT (g_hash_table_lookup (fhl->extensions, dot + 1));
+            if (i != 0 && i - 1 < found)
+                found = i - 1;
+        }
+
+        if (fhl->extensions_nocase != NULL)
+        {
+            gchar *ext;
+
+            ext = mc_fhl_fold_extension (dot + 1, -1);
+            i = GPOINTER_TO_UINT (g_hash_table_lookup (fhl->extensions_nocase, ext));
+            g_free (ext);
+            if (i != 0 && i - 1 < found)
+                found = i - 1;
+        }
     }
 
-    return (my_color) ? mc_filter->color_pair_index : -1;
+    return found;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -245,31 +264,29 @@ mc_fhl_get_color_regexp (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry
 
 /* --------------------------------------------------------------------------------------------- */
 
-/* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
-/* --------------------------------------------------------------------------------------------- */
-
-int
-mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
+static int
+mc_fhl_get_color_filters (mc_fhl_t * fhl, file_entry * fe)
 {
-    guint i;
+    guint i, ext_filter;
+    guint type_mask;
     mc_fhl_filter_t *mc_filter;
     int ret;
 
-    if (fhl == NULL)
-        return NORMAL_COLOR;
+    /* extensions are looked up at once; only the filters before the matched one remain */
+    ext_filter = mc_fhl_get_extension_filter (fhl, fe);
+    type_mask = mc_fhl_get_file_type_mask (fe);
 
-    for (i = 0; i < fhl->filters->len; i++)
+    for (i = 0; i < ext_filter; i++)
     {
         mc_filter = (mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, i);
         switch (mc_filter->type)
         {
         case MC_FLHGH_T_FTYPE:
-            ret = mc_fhl_get_color_filetype (mc_filter, fhl, fe);
-            if (ret > 0)
-                return -ret;
+            if ((type_mask & (1 << mc_filter->file_type)) != 0 && mc_filter->color_pair_index > 0)
+                return -mc_filter->color_pair_index;
             break;
         case MC_FLHGH_T_EXT:
+            break;
         case MC_FLHGH_T_FREGEXP:
             ret = mc_fhl_get_color_regexp (mc_filter, fhl, fe);
             if (ret > 0)
@@ -277,7 +294,34 @@ mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
             break;
         }
     }
+
+    if (ext_filter < fhl->filters->len)
+    {
+        mc_filter = (mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, ext_filter);
+        return -mc_filter->color_pair_index;
+    }
+
     return NORMAL_COLOR;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+int
+mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
+{
+    if (fhl == NULL || fhl->filters == NULL)
+        return NORMAL_COLOR;
+
+    /* the color is kept in the entry until the entry or the filters change */
+    if (fhl->stamp == 0 || fe->fhl_stamp != fhl->stamp)
+    {
+        fe->fhl_color = mc_fhl_get_color_filters (fhl, fe);
+        fe->fhl_stamp = fhl->stamp;
+    }
+
+    return fe->fhl_color;
+}
+
+/* --------------------------------------------------------------------------------------------- */
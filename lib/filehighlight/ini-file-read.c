@@ -29,7 +29,6 @@
 
 #include "lib/global.h"
 #include "lib/fileloc.h"
-#include "lib/strescape.h"
 #include "lib/skin.h"
 #include "lib/util.h"           /* exist_file() */
 #include "lib/filehighlight.h"
@@ -46,6 +45,9 @@ extern mc_skin_t mc_skin__default;
 
 /*** file scope variables ************************************************************************/
 
+/* the last stamp given to a set of filters */
+static unsigned int mc_fhl_last_stamp = 0;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -133,7 +135,8 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
     mc_fhl_filter_t *mc_filter;
     gchar **exts, **exts_orig;
     gsize exts_size;
-    GString *buf;
+    gboolean case_sensitive;
+    GHashTable *table;
 
     exts_orig = exts =
         mc_config_get_string_list (fhl->config, group_name, "extensions", &exts_size);
@@ -144,32 +147,42 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
         return FALSE;
     }
 
-    buf = g_string_sized_new (64);
-    for (exts = exts_orig; *exts != NULL; exts++)
-    {
-        char *esc_ext;
+    mc_filter = g_new0 (mc_fhl_filter_t, 1);
+    mc_filter->type = MC_FLHGH_T_EXT;
+    mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
 
-        esc_ext = strutils_regex_escape (*exts);
-        if (buf->len != 0)
-            g_string_append_c (buf, '|');
-        g_string_append (buf, esc_ext);
-        g_free (esc_ext);
+    /* the filter matches names which end with a dot and one of extensions */
+    case_sensitive = mc_config_get_bool (fhl->config, group_name, "extensions_case", TRUE);
+    if (case_sensitive)
+    {
+        if (fhl->extensions == NULL)
+            fhl->extensions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        table = fhl->extensions;
     }
-    g_strfreev (exts_orig);
+    else
+    {
+        if (fhl->extensions_nocase == NULL)
+            fhl->extensions_nocase =
+                g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        table = fhl->extensions_nocase;
+    }
+
+    /* filters without color never match */
+    for (exts = exts_orig; mc_filter->color_pair_index > 0 && *exts != NULL; exts++)
+    {
+        gchar *ext;
 
-    g_string_prepend (buf, ".*\\.(");
-    g_string_append (buf, ")$");
+        ext = case_sensitive ? g_strdup (*exts) : mc_fhl_fold_extension (*exts, -1);
 
-    mc_filter = g_new0 (mc_fhl_filter_t, 1);
-    mc_filter->type = MC_FLHGH_T_FREGEXP;
-    mc_filter->search_condition = mc_search_new (buf->str, buf->len);
-    mc_filter->search_condition->is_case_sensitive =
-        mc_config_get_bool (fhl->config, group_name, "extensions_case", TRUE);
-    mc_filter->search_condition->search_type = MC_SEARCH_T_REGEX;
+        /* the first filter of an extension wins */
+        if (g_hash_table_lookup (table, ext) == NULL)
+            g_hash_table_insert (table, ext, GUINT_TO_POINTER (fhl->filters->len + 1));
+        else
+            g_free (ext);
+    }
+    g_strfreev (exts_orig);
 
-    mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
     g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
-    g_string_free (buf, TRUE);
     return TRUE;
 }
 
@@ -256,6 +269,12 @@ mc_fhl_parse_ini_file (mc_fhl_t * fhl)
     }
 
     g_strfreev (orig_group_names);
+
+    /* invalidate colors cached with the previous filters */
+    if (++mc_fhl_last_stamp == 0)
+        mc_fhl_last_stamp++;
+    fhl->stamp = mc_fhl_last_stamp;
+
     return TRUE;
 }
 
@@ -50,6 +50,7 @@ typedef struct mc_fhl_filter_struct
 /*** declarations of public functions ************************************************************/
 
 void mc_fhl_array_free (mc_fhl_t *);
+gchar *mc_fhl_fold_extension (const gchar * ext, gssize len);
 
 gboolean mc_fhl_init_from_standard_files (mc_fhl_t *);
 
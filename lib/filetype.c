@@ -0,0 +1,684 @@
+/*
+   Built-in file type and encoding detection.
+
+   Copyright (C) 2012
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file filetype.c
+ *  \brief Source: built-in file type and encoding detection
+ *
+ *  The first block of a file is matched against a table of well-known
+ *  signatures.  Descriptions are worded like the output of file(1), so that
+ *  the "type/" rules of mc.ext keep working.  Formats that are not recognized
+ *  here are left to the external tools; their answers can be stored with
+ *  mc_filetype_set() and mc_filetype_set_encoding().
+ *
+ *  Results are cached per path and validated against device, inode,
+ *  modification time and size of the file.
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "filetype.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* the cache is dropped as a whole when it grows over this number of files */
+#define FILETYPE_CACHE_MAX 1024
+
+#define FILETYPE_LE16(p) ((unsigned int) (p)[0] | ((unsigned int) (p)[1] << 8))
+#define FILETYPE_LE32(p) (FILETYPE_LE16 (p) | ((unsigned long) FILETYPE_LE16 ((p) + 2) << 16))
+#define FILETYPE_BE16(p) (((unsigned int) (p)[0] << 8) | (unsigned int) (p)[1])
+#define FILETYPE_BE32(p) (((unsigned long) FILETYPE_BE16 (p) << 16) | FILETYPE_BE16 ((p) + 2))
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    off_t size;
+    gboolean sniffed;           /* first block already examined */
+    char *type;                 /* NULL if unknown */
+    char *encoding;             /* NULL if unknown */
+} filetype_entry_t;
+
+/* fixed signatures */
+typedef struct
+{
+    size_t offset;
+    const char *magic;
+    size_t len;
+    const char *description;
+} filetype_magic_t;
+
+/*** file scope variables ************************************************************************/
+
+static const filetype_magic_t filetype_magic[] = {
+    {0, "\xff\xd8\xff", 3, "JPEG image data"},
+    {0, "\x8bJNG\r\n\x1a\n", 8, "JNG video data"},
+    {0, "\x8aMNG\r\n\x1a\n", 8, "MNG video data"},
+    {0, "II*\0", 4, "TIFF image data, little-endian"},
+    {0, "MM\0*", 4, "TIFF image data, big-endian"},
+    {0, "%!PS", 4, "PostScript document text"},
+    {0, "\x1f\x8b", 2, "gzip compressed data"},
+    {0, "BZh", 3, "bzip2 compressed data"},
+    {0, "\x1f\x9d", 2, "compress'd data 16 bits"},
+    {0, "\xfd" "7zXZ\0", 6, "XZ compressed data"},
+    {0, "Rar!\x1a\x07", 6, "RAR archive data"},
+    {0, "7z\xbc\xaf\x27\x1c", 6, "7-zip archive data"},
+    {0, "SQLite format 3\0", 16, "SQLite 3.x database"},
+    {0, "PAR2\0PKT", 8, "Parity Archive Volume Set"},
+    {0, "<MakerFile", 10, "FrameMaker document"},
+    {257, "ustar  \0", 8, "POSIX tar archive (GNU)"},
+    {257, "ustar\0", 6, "POSIX tar archive"},
+    {0, NULL, 0, NULL}
+};
+
+/* first members of zip archives that file(1) reports as something else */
+static const char *const filetype_zip_special[] = {
+    "[Content_Types].xml",
+    "_rels/",
+    "docProps/",
+    "word/",
+    "xl/",
+    "ppt/",
+    "mimetype",
+    "META-INF/",
+    NULL
+};
+
+static GHashTable *filetype_cache = NULL;
+
+static char filetype_buf[BUF_SMALL];
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+filetype_has (const unsigned char *buf, size_t len, size_t offset, const char *magic, size_t n)
+{
+    return (offset + n <= len && memcmp (buf + offset, magic, n) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+filetype_contains (const unsigned char *buf, size_t len, const char *str)
+{
+    size_t n, i;
+
+    n = strlen (str);
+    for (i = 0; i + n <= len; i++)
+        if (buf[i] == (unsigned char) str[0] && memcmp (buf + i, str, n) == 0)
+            return TRUE;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+filetype_sniff_elf (const unsigned char *buf, size_t len)
+{
+    const char *bits, *order, *kind;
+    unsigned int e_type;
+
+    if (len < 18)
+        return NULL;
+
+    switch (buf[4])
+    {
+    case 1:
+        bits = "32";
+        break;
+    case 2:
+        bits = "64";
+        break;
+    default:
+        return NULL;
+    }
+
+    switch (buf[5])
+    {
+    case 1:
+        order = "LSB";
+        e_type = FILETYPE_LE16 (buf + 16);
+        break;
+    case 2:
+        order = "MSB";
+        e_type = FILETYPE_BE16 (buf + 16);
+        break;
+    default:
+        return NULL;
+    }
+
+    switch (e_type)
+    {
+    case 1:
+        kind = " relocatable";
+        break;
+    case 2:
+        kind = " executable";
+        break;
+    case 3:
+        kind = " shared object";
+        break;
+    case 4:
+        kind = " core file";
+        break;
+    default:
+        kind = "";
+        break;
+    }
+
+    g_snprintf (filetype_buf, sizeof (filetype_buf), "ELF %s-bit %s%s", bits, order, kind);
+    return filetype_buf;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+filetype_sniff_zip (const unsigned char *buf, size_t len)
+{
+    size_t name_len, i;
+
+    if (len < 30)
+        return NULL;
+
+    name_len = FILETYPE_LE16 (buf + 26);
+    if (30 + name_len > len)
+        return NULL;
+
+    for (i = 0; filetype_zip_special[i] != NULL; i++)
+    {
+        size_t n;
+
+        n = strlen (filetype_zip_special[i]);
+        if (n <= name_len && memcmp (buf + 30, filetype_zip_special[i], n) == 0)
+            return NULL;
+    }
+
+    return "Zip archive data";
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+filetype_sniff_netpbm (const unsigned char *buf, size_t len)
+{
+    static const char *const kind[] = { "bitmap", "greymap", "pixmap" };
+    unsigned int n;
+
+    if (len < 3 || buf[0] != 'P' || buf[1] < '1' || buf[1] > '6' || !g_ascii_isspace (buf[2]))
+        return NULL;
+
+    n = buf[1] - '1';
+    g_snprintf (filetype_buf, sizeof (filetype_buf), "Netpbm image data, %s%s",
+                n >= 3 ? "rawbits, " : "", kind[n % 3]);
+    return filetype_buf;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+filetype_sniff_binary (const unsigned char *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; filetype_magic[i].magic != NULL; i++)
+        if (filetype_has (buf, len, filetype_magic[i].offset, filetype_magic[i].magic,
+                          filetype_magic[i].len))
+            return filetype_magic[i].description;
+
+    if (filetype_has (buf, len, 0, "\x7f" "ELF", 4))
+        return filetype_sniff_elf (buf, len);
+
+    if (filetype_has (buf, len, 0, "PK\003\004", 4))
+        return filetype_sniff_zip (buf, len);
+
+    if (filetype_has (buf, len, 0, "\x89PNG\r\n\x1a\n", 8))
+    {
+        if (len >= 24 && memcmp (buf + 12, "IHDR", 4) == 0)
+        {
+            g_snprintf (filetype_buf, sizeof (filetype_buf), "PNG image data, %lu x %lu",
+                        FILETYPE_BE32 (buf + 16), FILETYPE_BE32 (buf + 20));
+            return filetype_buf;
+        }
+        return "PNG image data";
+    }
+
+    if (filetype_has (buf, len, 0, "GIF87a", 6) || filetype_has (buf, len, 0, "GIF89a", 6))
+    {
+        if (len < 10)
+            return NULL;
+        g_snprintf (filetype_buf, sizeof (filetype_buf), "GIF image data, version %.3s, %u x %u",
+                    (const char *) buf + 3, FILETYPE_LE16 (buf + 6), FILETYPE_LE16 (buf + 8));
+        return filetype_buf;
+    }
+
+    if (filetype_has (buf, len, 0, "BM", 2) && len >= 18)
+    {
+        switch (FILETYPE_LE32 (buf + 14))
+        {
+        case 12:
+        case 40:
+        case 52:
+        case 56:
+        case 64:
+        case 108:
+        case 124:
+            return "PC bitmap";
+        default:
+            break;
+        }
+    }
+
+    if (filetype_has (buf, len, 0, "%PDF-", 5))
+    {
+        size_t i;
+
+        for (i = 5; i < len && i < 9 && (g_ascii_isdigit (buf[i]) || buf[i] == '.'); i++)
+            ;
+        g_snprintf (filetype_buf, sizeof (filetype_buf), "PDF document, version %.*s",
+                    (int) (i - 5), (const char *) buf + 5);
+        return filetype_buf;
+    }
+
+    if (filetype_has (buf, len, 2, "-lh", 3) && filetype_has (buf, len, 6, "-", 1))
+        return "LHa (2.x) archive data";
+
+    if (filetype_has (buf, len, 0, "\x1a\x45\xdf\xa3", 4))
+    {
+        if (filetype_contains (buf, len, "webm"))
+            return "WebM";
+        if (filetype_contains (buf, len, "matroska"))
+            return "Matroska data";
+        return NULL;
+    }
+
+    return filetype_sniff_netpbm (buf, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Classify the block as text.
+ * Return TRUE for 7-bit text, FALSE otherwise; *is_text is FALSE if the block holds control
+ * characters that do not occur in text.
+ */
+
+static gboolean
+filetype_scan_text (const unsigned char *buf, size_t len, gboolean * is_text)
+{
+    gboolean ascii = TRUE;
+    size_t i;
+
+    *is_text = TRUE;
+
+    for (i = 0; i < len; i++)
+    {
+        unsigned char c = buf[i];
+
+        if (c >= 0x80)
+            ascii = FALSE;
+        else if (c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != '\b'
+                 && c != 0x1b)
+        {
+            *is_text = FALSE;
+            return FALSE;
+        }
+    }
+
+    return ascii;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check that the block is valid UTF-8.  If the block is not the whole file, a multibyte
+ * sequence may be cut at its end.
+ */
+
+static gboolean
+filetype_is_utf8 (const unsigned char *buf, size_t len, gboolean whole)
+{
+    const gchar *end;
+
+    if (g_utf8_validate ((const gchar *) buf, len, &end))
+        return TRUE;
+
+    return (!whole && (const unsigned char *) end + 4 > buf + len
+            && g_utf8_get_char_validated (end, buf + len - (const unsigned char *) end) ==
+            (gunichar) (-2));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the block starts with an RFC 822 header field, e.g. "Return-Path:".
+ * file(1) reports mail and news by their headers.
+ */
+
+static gboolean
+filetype_is_header (const unsigned char *buf, size_t len)
+{
+    size_t i;
+
+    /* field name is printable ASCII except space and colon */
+    for (i = 0; i < len && buf[i] > ' ' && buf[i] < 0x7f && buf[i] != ':'; i++)
+        ;
+
+    return (i != 0 && i < len && buf[i] == ':');
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+filetype_sniff_text (const unsigned char *buf, size_t len, gboolean whole)
+{
+    gboolean is_text, ascii;
+
+    ascii = filetype_scan_text (buf, len, &is_text);
+    if (!is_text)
+        return NULL;
+
+    /* file(1) tells more about these: scripts, markup, mail, Info */
+    if (filetype_has (buf, len, 0, "#!", 2) || filetype_has (buf, len, 0, "<", 1)
+        || filetype_has (buf, len, 0, "From ", 5) || filetype_is_header (buf, len)
+        || filetype_contains (buf, len, "produced by makeinfo"))
+        return NULL;
+
+    if (ascii)
+        return "ASCII text";
+
+    if (filetype_is_utf8 (buf, len, whole))
+        return "UTF-8 Unicode text";
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+filetype_entry_free (gpointer data)
+{
+    filetype_entry_t *entry = (filetype_entry_t *) data;
+
+    g_free (entry->type);
+    g_free (entry->encoding);
+    g_free (entry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the first block of the file and examine it.
+ */
+
+static void
+filetype_entry_sniff (filetype_entry_t * entry, const vfs_path_t * vpath)
+{
+    unsigned char buf[MC_FILETYPE_BLOCK_SIZE];
+    size_t len = 0;
+    int fd;
+
+    entry->sniffed = TRUE;
+
+    fd = mc_open (vpath, O_RDONLY);
+    if (fd == -1)
+        return;
+
+    while (len < sizeof (buf))
+    {
+        ssize_t n;
+
+        n = mc_read (fd, buf + len, sizeof (buf) - len);
+        if (n <= 0)
+            break;
+        len += (size_t) n;
+    }
+
+    mc_close (fd);
+
+    /* a short read of a file that is not short */
+    if (len < sizeof (buf) && (off_t) len != entry->size)
+        return;
+
+    entry->type = g_strdup (mc_filetype_sniff (buf, len, (off_t) len == entry->size));
+    entry->encoding = g_strdup (mc_filetype_sniff_encoding (buf, len, (off_t) len == entry->size));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the up-to-date cache entry of a regular file, creating an empty one if needed.
+ * Return NULL if the file cannot be examined.
+ */
+
+static filetype_entry_t *
+filetype_get_entry (const vfs_path_t * vpath)
+{
+    struct stat st;
+    filetype_entry_t *entry;
+    char *path;
+
+    if (vpath == NULL || mc_stat (vpath, &st) != 0 || !S_ISREG (st.st_mode))
+        return NULL;
+
+    path = vfs_path_to_str (vpath);
+    if (path == NULL)
+        return NULL;
+
+    if (filetype_cache == NULL)
+        filetype_cache =
+            g_hash_table_new_full (g_str_hash, g_str_equal, g_free, filetype_entry_free);
+
+    entry = (filetype_entry_t *) g_hash_table_lookup (filetype_cache, path);
+
+    if (entry != NULL && (entry->dev != st.st_dev || entry->ino != st.st_ino
+                          || entry->mtime != st.st_mtime || entry->size != st.st_size))
+    {
+        g_hash_table_remove (filetype_cache, path);
+        entry = NULL;
+    }
+
+    if (entry == NULL)
+    {
+        if (g_hash_table_size (filetype_cache) >= FILETYPE_CACHE_MAX)
+            g_hash_table_remove_all (filetype_cache);
+
+        entry = g_new0 (filetype_entry_t, 1);
+        entry->dev = st.st_dev;
+        entry->ino = st.st_ino;
+        entry->mtime = st.st_mtime;
+        entry->size = st.st_size;
+        g_hash_table_insert (filetype_cache, path, entry);
+    }
+    else
+        g_free (path);
+
+    return entry;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Examine the first block of a file.
+ *
+ * @param buf data from the beginning of the file
+ * @param len length of data
+ * @param whole TRUE if the data is the whole file
+ * @return description of the file type worded like file(1) does, or NULL if the type is
+ *         not recognized.  The string may be overwritten by the next call.
+ */
+
+const char *
+mc_filetype_sniff (const unsigned char *buf, size_t len, gboolean whole)
+{
+    const char *type;
+
+    if (len == 0)
+        return whole ? "empty" : NULL;
+
+    type = filetype_sniff_binary (buf, len);
+    if (type == NULL)
+        type = filetype_sniff_text (buf, len, whole);
+
+    return type;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Detect the character encoding of text.
+ *
+ * @return "ASCII" or "UTF-8" for such text, NULL if the encoding cannot be told without
+ *         statistical analysis.
+ */
+
+const char *
+mc_filetype_sniff_encoding (const unsigned char *buf, size_t len, gboolean whole)
+{
+    gboolean is_text;
+
+    if (len == 0)
+        return NULL;
+
+    if (filetype_scan_text (buf, len, &is_text))
+    {
+        /* ESC may start ISO-2022 shifts: leave 7-bit encodings to enca */
+        if (memchr (buf, 0x1b, len) != NULL)
+            return NULL;
+        return "ASCII";
+    }
+
+    if (is_text && filetype_is_utf8 (buf, len, whole))
+        return "UTF-8";
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the type of a regular file.
+ *
+ * @return description of the file type or NULL if it is unknown.  The string is owned by
+ *         the cache and valid until the next call of mc_filetype_* functions.
+ */
+
+const char *
+mc_filetype_get (const vfs_path_t * vpath)
+{
+    filetype_entry_t *entry;
+
+    entry = filetype_get_entry (vpath);
+    if (entry == NULL)
+        return NULL;
+
+    if (!entry->sniffed)
+        filetype_entry_sniff (entry, vpath);
+
+    return entry->type;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the character encoding of a regular file.
+ *
+ * @return encoding name or NULL if it is unknown.  The string is owned by the cache
+ *         and valid until the next call of mc_filetype_* functions.
+ */
+
+const char *
+mc_filetype_get_encoding (const vfs_path_t * vpath)
+{
+    filetype_entry_t *entry;
+
+    entry = filetype_get_entry (vpath);
+    if (entry == NULL)
+        return NULL;
+
+    if (!entry->sniffed)
+        filetype_entry_sniff (entry, vpath);
+
+    return entry->encoding;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember the type of a file found by other means, e.g. by file(1).
+ */
+
+void
+mc_filetype_set (const vfs_path_t * vpath, const char *type)
+{
+    filetype_entry_t *entry;
+
+    entry = filetype_get_entry (vpath);
+    if (entry != NULL)
+    {
+        g_free (entry->type);
+        entry->type = g_strdup (type);
+        entry->sniffed = TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember the character encoding of a file found by other means, e.g. by enca(1).
+ */
+
+void
+mc_filetype_set_encoding (const vfs_path_t * vpath, const char *encoding)
+{
+    filetype_entry_t *entry;
+
+    entry = filetype_get_entry (vpath);
+    if (entry != NULL)
+    {
+        g_free (entry->encoding);
+        entry->encoding = g_strdup (encoding);
+        entry->sniffed = TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget all cached types and encodings.
+ */
+
+void
+mc_filetype_flush (void)
+{
+    if (filetype_cache != NULL)
+    {
+        g_hash_table_destroy (filetype_cache);
+        filetype_cache = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
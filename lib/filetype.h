@@ -0,0 +1,35 @@
+/** \file filetype.h
+ *  \brief Header: built-in file type and encoding detection
+ */
+
+#ifndef MC__FILETYPE_H
+#define MC__FILETYPE_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* size of the block examined by the built-in detector */
+#define MC_FILETYPE_BLOCK_SIZE 4096
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+const char *mc_filetype_sniff (const unsigned char *buf, size_t len, gboolean whole);
+const char *mc_filetype_sniff_encoding (const unsigned char *buf, size_t len, gboolean whole);
+
+const char *mc_filetype_get (const vfs_path_t * vpath);
+const char *mc_filetype_get_encoding (const vfs_path_t * vpath);
+void mc_filetype_set (const vfs_path_t * vpath, const char *type);
+void mc_filetype_set_encoding (const vfs_path_t * vpath, const char *encoding);
+void mc_filetype_flush (void);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__FILETYPE_H */
@@ -15,6 +15,7 @@
 
 typedef int (*mc_search_fn) (const void *user_data, gsize char_offset, int *current_char);
 typedef int (*mc_update_fn) (const void *user_data, gsize char_offset);
+typedef const char *(*mc_search_buf_fn) (const void *user_data, gsize offset, gsize * len);
 
 #define MC_SEARCH__NUM_REPLACE_ARGS 64
 
@@ -77,6 +78,11 @@ typedef struct mc_search_struct
     /* function, used for getting data. NULL if not used */
     mc_search_fn search_fn;
 
+    /* function, used for getting data by contiguous blocks: returns pointer to data
+       at offset and length of block in len, NULL at end of data (search is finished
+       as not found). NULL if not used. If set, it is used instead of search_fn */
+    mc_search_buf_fn search_buf_fn;
+
     /* function, used for updatin current search status. NULL if not used */
     mc_update_fn update_fn;
 
@@ -107,6 +113,10 @@ typedef struct mc_search_struct
     gchar *original;
     gsize original_len;
 
+    /* length of data before start_search in its line given to regex as the context
+       of occurrence (used by mc_search_run_backward) */
+    gsize line_context;
+
     /* error code after search */
     mc_search_error_t error;
     gchar *error_str;
@@ -130,6 +140,8 @@ gboolean mc_search_prepare (mc_search_t * mc_search);
 
 gboolean mc_search_run (mc_search_t * mc_search, const void *user_data, gsize start_search,
                         gsize end_search, gsize * found_len);
+gboolean mc_search_run_backward (mc_search_t * mc_search, const void *user_data,
+                                 gsize start_search, gsize end_search, gsize * found_len);
 
 gboolean mc_search_is_type_avail (mc_search_type_t);
 
@@ -144,6 +156,8 @@ gchar **mc_search_get_types_strings_array (size_t * num);
 
 gboolean mc_search (const gchar *, const gchar *, mc_search_type_t);
 
+gboolean mc_search_match_str (mc_search_t * mc_search, const gchar * str, gsize str_len);
+
 int mc_search_getstart_result_by_num (mc_search_t *, int);
 int mc_search_getend_result_by_num (mc_search_t *, int);
 
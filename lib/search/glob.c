@@ -141,6 +141,95 @@ mc_search__translate_replace_glob_to_regex (const char *str)
     return buff;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether glob consists of a literal with optional leading and trailing '*'.
+ * Such globs are matched without regex.
+ */
+
+static void
+mc_search__glob_simple_init (mc_search_t * lc_mc_search, mc_search_cond_t * mc_search_cond)
+{
+    const char *str = mc_search_cond->str->str;
+    gsize len = mc_search_cond->str->len;
+    gsize loop;
+    gboolean lead_star = FALSE;
+    gboolean trail_star = FALSE;
+    GString *literal;
+
+    if (!lc_mc_search->is_entire_line)
+        return;
+
+    if (len != 0 && str[0] == '*')
+    {
+        lead_star = TRUE;
+        str++;
+        len--;
+    }
+
+    literal = g_string_sized_new (len);
+
+    for (loop = 0; loop < len; loop++)
+    {
+        char c = str[loop];
+
+        switch (c)
+        {
+        case '\\':
+            /* escaped characters which are passed to regex as is */
+            loop++;
+            if (loop >= len || g_ascii_isalnum (str[loop]) || strchr ("*?,{}+.$()^", str[loop]) != NULL)
+                goto not_simple;
+            c = str[loop];
+            break;
+        case '*':
+            if (loop != len - 1)
+                goto not_simple;
+            trail_star = TRUE;
+            continue;
+        case '?':
+        case ',':
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case '|':
+            goto not_simple;
+        default:
+            break;
+        }
+
+        /* only ASCII letters are compared case insensitively here */
+        if (!lc_mc_search->is_case_sensitive && (unsigned char) c >= 0x80)
+            goto not_simple;
+
+        g_string_append_c (literal, c);
+    }
+
+    if (lead_star)
+        mc_search_cond->glob_simple = trail_star ? GLOB__SUBSTR : GLOB__SUFFIX;
+    else
+        mc_search_cond->glob_simple = trail_star ? GLOB__PREFIX : GLOB__EXACT;
+
+    mc_search_cond->glob_literal = literal;
+    return;
+
+  not_simple:
+    g_string_free (literal, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+mc_search__glob_literal_equal (const char *str, const GString * literal, gboolean case_sensitive)
+{
+    if (case_sensitive)
+        return (memcmp (str, literal->str, literal->len) == 0);
+
+    return (g_ascii_strncasecmp (str, literal->str, literal->len) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 
 void
@@ -149,6 +238,8 @@ mc_search__cond_struct_new_init_glob (const char *charset, mc_search_t * lc_mc_s
 {
     GString *tmp;
 
+    mc_search__glob_simple_init (lc_mc_search, mc_search_cond);
+
     tmp = mc_search__glob_translate_to_regex (mc_search_cond->str);
     g_string_free (mc_search_cond->str, TRUE);
 
@@ -171,6 +262,39 @@ mc_search__run_glob (mc_search_t * lc_mc_search, const void *user_data,
     return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Match the whole string against simple glob. Doesn't change any search data.
+ */
+
+gboolean
+mc_search__glob_simple_match (const mc_search_t * lc_mc_search,
+                              const mc_search_cond_t * mc_search_cond, const char *str,
+                              gsize str_len)
+{
+    const GString *literal = mc_search_cond->glob_literal;
+    gboolean case_sensitive = lc_mc_search->is_case_sensitive;
+
+    if (str_len < literal->len)
+        return FALSE;
+
+    switch (mc_search_cond->glob_simple)
+    {
+    case GLOB__EXACT:
+        return (str_len == literal->len
+                && mc_search__glob_literal_equal (str, literal, case_sensitive));
+    case GLOB__PREFIX:
+        return mc_search__glob_literal_equal (str, literal, case_sensitive);
+    case GLOB__SUFFIX:
+        return mc_search__glob_literal_equal (str + str_len - literal->len, literal,
+                                              case_sensitive);
+    case GLOB__SUBSTR:
+        return (mc_search__find_literal (literal, case_sensitive, str, str_len) != NULL);
+    default:
+        return FALSE;
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 GString *
@@ -21,6 +21,16 @@ typedef enum
     COND__FOUND_ERROR
 } mc_search__found_cond_t;
 
+/* kinds of globs which can be matched without regex */
+typedef enum
+{
+    GLOB__NOT_SIMPLE = 0,
+    GLOB__EXACT,                /* literal */
+    GLOB__PREFIX,               /* literal* */
+    GLOB__SUFFIX,               /* *literal */
+    GLOB__SUBSTR                /* *literal* */
+} mc_search__glob_simple_t;
+
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 typedef struct mc_search_cond_struct
@@ -30,6 +40,11 @@ typedef struct mc_search_cond_struct
     GString *lower;
     mc_search_regex_t *regex_handle;
     gchar *charset;
+    /* literal part of simple glob */
+    mc_search__glob_simple_t glob_simple;
+    GString *glob_literal;
+    /* string of normal search which can be found without regex, NULL if regex is required */
+    GString *normal_literal;
 } mc_search_cond_t;
 
 /*** global variables defined in .c file *********************************************************/
@@ -49,6 +64,8 @@ gchar *mc_search__get_one_symbol (const char *, const char *, gsize, gboolean *)
 
 mc_search_cbret_t mc_search__get_char (mc_search_t *, const void *, gsize, int *);
 
+const char *mc_search__find_literal (const GString *, gboolean, const char *, gsize);
+
 GString *mc_search__tolower_case_str (const char *, const char *, gsize);
 
 GString *mc_search__toupper_case_str (const char *, const char *, gsize);
@@ -59,6 +76,8 @@ void mc_search__cond_struct_new_init_regex (const char *, mc_search_t *, mc_sear
 
 gboolean mc_search__run_regex (mc_search_t *, const void *, gsize, gsize, gsize *);
 
+gboolean mc_search__regex_match_str (mc_search_regex_t *, const char *, gsize);
+
 GString *mc_search_regex_prepare_replace_str (mc_search_t *, GString *);
 
 /* search/normal.c : */
@@ -75,6 +94,9 @@ void mc_search__cond_struct_new_init_glob (const char *, mc_search_t *, mc_searc
 
 gboolean mc_search__run_glob (mc_search_t *, const void *, gsize, gsize, gsize *);
 
+gboolean mc_search__glob_simple_match (const mc_search_t *, const mc_search_cond_t *,
+                                       const char *, gsize);
+
 GString *mc_search_glob_prepare_replace_str (mc_search_t *, GString *);
 
 /* search/hex.c : */
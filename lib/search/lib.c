@@ -27,6 +27,7 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "lib/global.h"
@@ -153,6 +154,79 @@ mc_search__get_char (mc_search_t * lc_mc_search, const void *user_data, gsize cu
     return (*current_char == 0) ? MC_SEARCH_CB_ABORT : MC_SEARCH_CB_OK;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find first occurrence of literal string in the buffer.
+ * Candidates are looked up by the first byte of literal using memchr(),
+ * case insensitive comparison is ASCII-only.
+ *
+ * @return pointer to the occurrence in buf, NULL if not found
+ */
+
+const char *
+mc_search__find_literal (const GString * literal, gboolean case_sensitive, const char *buf,
+                         gsize buf_len)
+{
+    const char *p, *last;
+    const char *next_lo = NULL, *next_up = NULL;
+    gboolean may_lo = TRUE, may_up;
+    char lo, up;
+
+    if (literal->len == 0 || buf_len < literal->len)
+        return NULL;
+
+    p = buf;
+    /* last possible start of occurrence */
+    last = buf + buf_len - literal->len;
+
+    if (case_sensitive)
+    {
+        while (p <= last && (p = memchr (p, literal->str[0], last - p + 1)) != NULL)
+        {
+            if (memcmp (p + 1, literal->str + 1, literal->len - 1) == 0)
+                return p;
+            p++;
+        }
+        return NULL;
+    }
+
+    lo = g_ascii_tolower (literal->str[0]);
+    up = g_ascii_toupper (literal->str[0]);
+    may_up = (lo != up);
+
+    /* keep next position of both cases to scan the buffer for each of them only once */
+    while (p <= last)
+    {
+        const char *cand;
+
+        if (may_lo && (next_lo == NULL || next_lo < p))
+        {
+            next_lo = memchr (p, lo, last - p + 1);
+            may_lo = (next_lo != NULL);
+        }
+        if (may_up && (next_up == NULL || next_up < p))
+        {
+            next_up = memchr (p, up, last - p + 1);
+            may_up = (next_up != NULL);
+        }
+
+        if (may_lo && may_up)
+            cand = MIN (next_lo, next_up);
+        else if (may_lo)
+            cand = next_lo;
+        else if (may_up)
+            cand = next_up;
+        else
+            break;
+
+        if (g_ascii_strncasecmp (cand + 1, literal->str + 1, literal->len - 1) == 0)
+            return cand;
+        p = cand + 1;
+    }
+
+    return NULL;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 GString *
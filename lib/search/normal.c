@@ -26,6 +26,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "lib/global.h"
 #include "lib/strutil.h"
 #include "lib/search.h"
@@ -80,6 +82,218 @@ mc_search__normal_translate_to_regex (const GString * astr)
     return buff;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Keep the search string for matching without regex if it's possible:
+ * whole words need regex, lines are matched separately by regex so string may not
+ * contain newline, case insensitive comparison without regex is ASCII-only.
+ */
+
+static void
+mc_search__normal_literal_init (const mc_search_t * lc_mc_search,
+                                mc_search_cond_t * mc_search_cond)
+{
+    const GString *str = mc_search_cond->str;
+    gsize loop;
+
+    if (lc_mc_search->whole_words || str->len == 0)
+        return;
+
+    for (loop = 0; loop < str->len; loop++)
+    {
+        unsigned char c = (unsigned char) str->str[loop];
+
+        if (c == '\n' || c == '\0' || (!lc_mc_search->is_case_sensitive && c >= 0x80))
+            return;
+    }
+
+    mc_search_cond->normal_literal = g_string_new_len (str->str, str->len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__normal_is_literal (const mc_search_t * lc_mc_search)
+{
+    gsize loop;
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        const mc_search_cond_t *mc_search_cond;
+
+        mc_search_cond = (const mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions,
+                                                                       loop);
+        if (mc_search_cond->normal_literal == NULL)
+            return FALSE;
+    }
+
+    return (lc_mc_search->conditions->len != 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find first occurrence of any condition in the buffer.
+ *
+ * @return pointer to the occurrence in buf, NULL if not found
+ */
+
+static const char *
+mc_search__normal_find (const mc_search_t * lc_mc_search, const char *buf, gsize buf_len,
+                        gsize * found_len)
+{
+    const char *found = NULL;
+    gsize loop;
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        const mc_search_cond_t *mc_search_cond;
+        const char *p;
+
+        mc_search_cond = (const mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions,
+                                                                       loop);
+        p = mc_search__find_literal (mc_search_cond->normal_literal,
+                                     lc_mc_search->is_case_sensitive, buf, buf_len);
+        if (p != NULL && (found == NULL || p < found))
+        {
+            found = p;
+            *found_len = mc_search_cond->normal_literal->len;
+        }
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search in the string (user_data) without regex.
+ *
+ * @return TRUE if found; else FALSE, and data_end is set to TRUE if string is over
+ *         before end_search
+ */
+
+static gboolean
+mc_search__normal_run_literal_str (mc_search_t * lc_mc_search, const char *str,
+                                   gsize start_search, gsize end_search, gsize * found_len,
+                                   gboolean * data_end)
+{
+    const char *data = str + start_search;
+    const char *found;
+    gsize data_len;
+
+    if (end_search - start_search == G_MAXSIZE)
+    {
+        data_len = strlen (data);
+        *data_end = TRUE;
+    }
+    else
+    {
+        const char *eod;
+
+        data_len = end_search - start_search + 1;
+        eod = memchr (data, '\0', data_len);
+        *data_end = (eod != NULL);
+        if (eod != NULL)
+            data_len = eod - data;
+    }
+
+    found = mc_search__normal_find (lc_mc_search, data, data_len, found_len);
+    if (found == NULL)
+        return FALSE;
+
+    lc_mc_search->normal_offset = start_search + (found - data);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search in the data fetched by blocks without regex. Occurrences crossing
+ * the block boundaries are looked for in the tail of previous block joined
+ * with the head of the next one.
+ *
+ * @return TRUE if found; else FALSE, and aborted is set to TRUE if search was
+ *         interrupted by update_fn
+ */
+
+static gboolean
+mc_search__normal_run_literal_buf (mc_search_t * lc_mc_search, const void *user_data,
+                                   gsize start_search, gsize end_search, gsize * found_len,
+                                   gboolean * aborted)
+{
+    GString *tail;
+    gsize tail_max = 0, tail_pos = 0;
+    gsize pos = start_search;
+    gboolean found = FALSE;
+    gsize loop;
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        const mc_search_cond_t *mc_search_cond;
+
+        mc_search_cond = (const mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions,
+                                                                       loop);
+        tail_max = MAX (tail_max, mc_search_cond->normal_literal->len - 1);
+    }
+
+    tail = g_string_sized_new (2 * tail_max);
+
+    while (pos <= end_search)
+    {
+        const char *buf, *p;
+        gsize buf_len = 0, tail_len;
+
+        buf = lc_mc_search->search_buf_fn (user_data, pos, &buf_len);
+        if (buf == NULL || buf_len == 0)
+            break;
+
+        if (buf_len - 1 > end_search - pos)
+            buf_len = end_search - pos + 1;
+
+        tail_len = tail->len;
+        g_string_append_len (tail, buf, MIN (buf_len, tail_max));
+
+        if (tail_len != 0)
+        {
+            p = mc_search__normal_find (lc_mc_search, tail->str, tail->len, found_len);
+            if (p != NULL)
+            {
+                lc_mc_search->normal_offset = tail_pos + (p - tail->str);
+                found = TRUE;
+                break;
+            }
+        }
+
+        p = mc_search__normal_find (lc_mc_search, buf, buf_len, found_len);
+        if (p != NULL)
+        {
+            lc_mc_search->normal_offset = pos + (p - buf);
+            found = TRUE;
+            break;
+        }
+
+        /* keep the tail of data for occurrences crossing the block boundary */
+        if (buf_len >= tail_max)
+        {
+            g_string_set_size (tail, 0);
+            g_string_append_len (tail, buf + buf_len - tail_max, tail_max);
+        }
+        else if (tail->len > tail_max)
+            g_string_erase (tail, 0, tail->len - tail_max);
+
+        pos += buf_len;
+        tail_pos = pos - tail->len;
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, pos) == MC_SEARCH_CB_ABORT)
+        {
+            *aborted = TRUE;
+            break;
+        }
+    }
+
+    g_string_free (tail, TRUE);
+    return found;
+}
+
 /*** public functions ****************************************************************************/
 
 void
@@ -88,6 +302,8 @@ mc_search__cond_struct_new_init_normal (const char *charset, mc_search_t * lc_mc
 {
     GString *tmp;
 
+    mc_search__normal_literal_init (lc_mc_search, mc_search_cond);
+
     tmp = mc_search__normal_translate_to_regex (mc_search_cond->str);
     g_string_free (mc_search_cond->str, TRUE);
 
@@ -109,7 +325,40 @@ gboolean
 mc_search__run_normal (mc_search_t * lc_mc_search, const void *user_data,
                        gsize start_search, gsize end_search, gsize * found_len)
 {
-    return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
+    gboolean found;
+    gboolean aborted = FALSE;
+    gsize len = 0;
+
+    /* data got char by char is searched by regex */
+    if ((lc_mc_search->search_buf_fn == NULL && lc_mc_search->search_fn != NULL)
+        || !mc_search__normal_is_literal (lc_mc_search))
+        return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search,
+                                     found_len);
+
+    if (end_search < start_search)
+        found = FALSE;
+    else if (lc_mc_search->search_buf_fn != NULL)
+        found = mc_search__normal_run_literal_buf (lc_mc_search, user_data, start_search,
+                                                   end_search, &len, &aborted);
+    else
+        found = mc_search__normal_run_literal_str (lc_mc_search, (const char *) user_data,
+                                                   start_search, end_search, &len, &aborted);
+
+    if (found)
+    {
+        lc_mc_search->start_buffer = lc_mc_search->normal_offset;
+        lc_mc_search->num_results = 1;
+        if (found_len != NULL)
+            *found_len = len;
+        return TRUE;
+    }
+
+    lc_mc_search->error = MC_SEARCH_E_NOTFOUND;
+    /* like regex search, end of string and interruption are not reported */
+    if (!aborted && end_search >= start_search)
+        lc_mc_search->error_str = g_strdup (_(STR_E_NOTFOUND));
+
+    return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -28,6 +28,7 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "lib/global.h"
 #include "lib/strutil.h"
@@ -252,12 +253,12 @@ mc_search__cond_struct_new_regex_ci_str (const char *charset, const GString * as
 
 static mc_search__found_cond_t
 mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t * regex,
-                                 GString * search_str)
+                                 const char *search_str, gsize search_len, gsize start_pos)
 {
 #ifdef SEARCH_TYPE_GLIB
     GError *error = NULL;
 
-    if (!g_regex_match_full (regex, search_str->str, search_str->len, 0, G_REGEX_MATCH_NEWLINE_ANY,
+    if (!g_regex_match_full (regex, search_str, search_len, start_pos, G_REGEX_MATCH_NEWLINE_ANY,
                              &lc_mc_search->regex_match_info, &error))
     {
         g_match_info_free (lc_mc_search->regex_match_info);
@@ -275,7 +276,7 @@ mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t *
     lc_mc_search->num_results = g_match_info_get_match_count (lc_mc_search->regex_match_info);
 #else /* SEARCH_TYPE_GLIB */
     lc_mc_search->num_results = pcre_exec (regex, lc_mc_search->regex_match_info,
-                                           search_str->str, search_str->len, 0, 0,
+                                           search_str, search_len, (int) start_pos, 0,
                                            lc_mc_search->iovector, MC_SEARCH__NUM_REPLACE_ARGS);
     if (lc_mc_search->num_results < 0)
     {
@@ -289,7 +290,8 @@ mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t *
 /* --------------------------------------------------------------------------------------------- */
 
 static mc_search__found_cond_t
-mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
+mc_search__regex_found_cond (mc_search_t * lc_mc_search, const char *search_str, gsize search_len,
+                             gsize start_pos)
 {
     gsize loop1;
     mc_search_cond_t *mc_search_cond;
@@ -304,7 +306,7 @@ mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
 
         ret =
             mc_search__regex_found_cond_one (lc_mc_search, mc_search_cond->regex_handle,
-                                             search_str);
+                                             search_str, search_len, start_pos);
 
         if (ret != COND__NOT_FOUND)
             return ret;
@@ -312,6 +314,105 @@ mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
     return COND__NOT_ALL_FOUND;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Collect one line (up to '\n' or end_search inclusive) into regex_buffer
+ * fetching data char by char via search_fn callback.
+ *
+ * @return MC_SEARCH_CB_ABORT if there is no more data, MC_SEARCH_CB_OK otherwise
+ */
+
+static mc_search_cbret_t
+mc_search__regex_get_line_by_char (mc_search_t * lc_mc_search, const void *user_data,
+                                   gsize * current_pos, gsize * virtual_pos, gsize end_search)
+{
+    mc_search_cbret_t ret;
+
+    while (TRUE)
+    {
+        int current_chr = '\n';        /* stop search symbol */
+
+        ret = mc_search__get_char (lc_mc_search, user_data, *current_pos, &current_chr);
+        if (ret == MC_SEARCH_CB_ABORT)
+            break;
+
+        if (ret == MC_SEARCH_CB_INVALID)
+            continue;
+
+        (*current_pos)++;
+
+        if (ret == MC_SEARCH_CB_SKIP)
+            continue;
+
+        (*virtual_pos)++;
+
+        g_string_append_c (lc_mc_search->regex_buffer, (char) current_chr);
+
+        if ((char) current_chr == '\n' || *virtual_pos > end_search)
+            break;
+    }
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get one line (up to '\n' or end_search inclusive) fetching data by blocks
+ * via search_buf_fn callback. Line lying in one block is returned in place,
+ * line crossing the block boundaries is assembled in regex_buffer.
+ *
+ * @return FALSE if data is over before end of line, TRUE otherwise
+ */
+
+static gboolean
+mc_search__regex_get_line_by_buf (mc_search_t * lc_mc_search, const void *user_data,
+                                  gsize start_pos, gsize end_search, const char **line,
+                                  gsize * line_len)
+{
+    gboolean ret = TRUE;
+    gsize pos = start_pos;
+
+    g_string_set_size (lc_mc_search->regex_buffer, 0);
+
+    while (pos <= end_search)
+    {
+        const char *buf, *eol;
+        gsize buf_len = 0;
+
+        buf = lc_mc_search->search_buf_fn (user_data, pos, &buf_len);
+        if (buf == NULL || buf_len == 0)
+        {
+            ret = FALSE;
+            break;
+        }
+
+        if (buf_len - 1 > end_search - pos)
+            buf_len = end_search - pos + 1;
+
+        eol = memchr (buf, '\n', buf_len);
+        if (eol != NULL)
+            buf_len = eol - buf + 1;
+
+        pos += buf_len;
+
+        if (lc_mc_search->regex_buffer->len == 0 && (eol != NULL || pos > end_search))
+        {
+            *line = buf;
+            *line_len = buf_len;
+            return TRUE;
+        }
+
+        g_string_append_len (lc_mc_search->regex_buffer, buf, buf_len);
+
+        if (eol != NULL)
+            break;
+    }
+
+    *line = lc_mc_search->regex_buffer->str;
+    *line_len = lc_mc_search->regex_buffer->len;
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -791,7 +892,9 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
                       gsize start_search, gsize end_search, gsize * found_len)
 {
     mc_search_cbret_t ret = MC_SEARCH_CB_ABORT;
+    gboolean data_end = FALSE;
     gsize current_pos, virtual_pos;
+    gsize context;
     gint start_pos;
     gint end_pos;
 
@@ -800,37 +903,34 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
 
     lc_mc_search->regex_buffer = g_string_sized_new (64);
 
-    virtual_pos = current_pos = start_search;
+    /* the first line is got from its start, occurrence is looked for after the context */
+    context = MIN (lc_mc_search->line_context, start_search);
+    virtual_pos = current_pos = start_search - context;
     while (virtual_pos <= end_search)
     {
-        g_string_set_size (lc_mc_search->regex_buffer, 0);
+        const char *line;
+        gsize line_len;
+
         lc_mc_search->start_buffer = current_pos;
 
-        while (TRUE)
+        if (lc_mc_search->search_buf_fn != NULL)
         {
-            int current_chr = '\n';     /* stop search symbol */
-
-            ret = mc_search__get_char (lc_mc_search, user_data, current_pos, &current_chr);
-            if (ret == MC_SEARCH_CB_ABORT)
-                break;
-
-            if (ret == MC_SEARCH_CB_INVALID)
-                continue;
-
-            current_pos++;
-
-            if (ret == MC_SEARCH_CB_SKIP)
-                continue;
-
-            virtual_pos++;
-
-            g_string_append_c (lc_mc_search->regex_buffer, (char) current_chr);
-
-            if ((char) current_chr == '\n' || virtual_pos > end_search)
-                break;
+            ret = MC_SEARCH_CB_OK;
+            data_end = !mc_search__regex_get_line_by_buf (lc_mc_search, user_data, current_pos,
+                                                          end_search, &line, &line_len);
+            current_pos += line_len;
+            virtual_pos = current_pos;
+        }
+        else
+        {
+            g_string_set_size (lc_mc_search->regex_buffer, 0);
+            ret = mc_search__regex_get_line_by_char (lc_mc_search, user_data, &current_pos,
+                                                     &virtual_pos, end_search);
+            line = lc_mc_search->regex_buffer->str;
+            line_len = lc_mc_search->regex_buffer->len;
         }
 
-        switch (mc_search__regex_found_cond (lc_mc_search, lc_mc_search->regex_buffer))
+        switch (mc_search__regex_found_cond (lc_mc_search, line, line_len, MIN (context, line_len)))
         {
         case COND__FOUND_OK:
 #ifdef SEARCH_TYPE_GLIB
@@ -850,11 +950,18 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
                 end_pos = lc_mc_search->iovector[1];
             }
 #endif /* SEARCH_TYPE_GLIB */
+            if (line != lc_mc_search->regex_buffer->str)
+            {
+                /* line was matched in place: keep it for the replace tokens */
+                g_string_set_size (lc_mc_search->regex_buffer, 0);
+                g_string_append_len (lc_mc_search->regex_buffer, line, line_len);
+            }
             if (found_len != NULL)
                 *found_len = end_pos - start_pos;
             lc_mc_search->normal_offset = lc_mc_search->start_buffer + start_pos;
             return TRUE;
         case COND__NOT_ALL_FOUND:
+            context = 0;
             break;
         default:
             g_string_free (lc_mc_search->regex_buffer, TRUE);
@@ -866,7 +973,7 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
             ((lc_mc_search->update_fn) (user_data, current_pos) == MC_SEARCH_CB_ABORT))
             ret = MC_SEARCH_CB_ABORT;
 
-        if (ret == MC_SEARCH_CB_ABORT)
+        if (ret == MC_SEARCH_CB_ABORT || data_end)
             break;
     }
 
@@ -882,6 +989,22 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
     return FALSE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Match the whole string against compiled regex. Match data is kept locally,
+ * so the same regex can be used by several callers at once.
+ */
+
+gboolean
+mc_search__regex_match_str (mc_search_regex_t * regex, const char *str, gsize str_len)
+{
+#ifdef SEARCH_TYPE_GLIB
+    return g_regex_match_full (regex, str, str_len, 0, G_REGEX_MATCH_NEWLINE_ANY, NULL, NULL);
+#else /* SEARCH_TYPE_GLIB */
+    return (pcre_exec (regex, NULL, str, (int) str_len, 0, 0, NULL, 0) >= 0);
+#endif /* SEARCH_TYPE_GLIB */
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 GString *
@@ -27,6 +27,7 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "lib/global.h"
@@ -42,6 +43,10 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* backward search scans blocks of growing size going back from the start position */
+#define MC_SEARCH_BACKWARD_BLOCK_MIN 4096
+#define MC_SEARCH_BACKWARD_BLOCK_MAX (1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -97,6 +102,12 @@ mc_search__cond_struct_free (mc_search_cond_t * mc_search_cond)
     if (mc_search_cond->lower)
         g_string_free (mc_search_cond->lower, TRUE);
 
+    if (mc_search_cond->glob_literal != NULL)
+        g_string_free (mc_search_cond->glob_literal, TRUE);
+
+    if (mc_search_cond->normal_literal != NULL)
+        g_string_free (mc_search_cond->normal_literal, TRUE);
+
     g_string_free (mc_search_cond->str, TRUE);
     g_free (mc_search_cond->charset);
 
@@ -126,6 +137,110 @@ mc_search__conditions_free (GPtrArray * array)
     g_ptr_array_free (array, TRUE);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the end of search for occurrences starting at pos: the length of search string
+ * after pos for fixed strings, the end of line for regex and glob, which are matched
+ * line by line.
+ */
+
+static gsize
+mc_search__backward_end (mc_search_t * lc_mc_search, const void *user_data, gsize pos,
+                         gsize end_search)
+{
+    if (mc_search_is_fixed_search_str (lc_mc_search))
+        return MIN (pos + lc_mc_search->original_len, end_search);
+
+    if (lc_mc_search->search_buf_fn != NULL)
+        while (pos <= end_search)
+        {
+            const char *buf, *eol;
+            gsize buf_len = 0;
+
+            buf = lc_mc_search->search_buf_fn (user_data, pos, &buf_len);
+            if (buf == NULL || buf_len == 0)
+                break;
+
+            eol = memchr (buf, '\n', buf_len);
+            if (eol != NULL)
+                return MIN (pos + (gsize) (eol - buf), end_search);
+
+            pos += buf_len;
+        }
+    else if (lc_mc_search->search_fn == NULL)
+    {
+        const char *eol;
+
+        eol = strchr ((const char *) user_data + pos, '\n');
+        if (eol != NULL)
+            return MIN ((gsize) (eol - (const char *) user_data), end_search);
+    }
+
+    return end_search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the start of line containing pos. Regex is matched line by line: anchors and word
+ * boundaries depend on the data before the occurrence. Fixed strings need no context.
+ */
+
+static gsize
+mc_search__backward_line_start (mc_search_t * lc_mc_search, const void *user_data, gsize pos)
+{
+    if (mc_search_is_fixed_search_str (lc_mc_search) && !lc_mc_search->whole_words)
+        return pos;
+
+    if (lc_mc_search->search_buf_fn == NULL)
+    {
+        for (; pos > 0; pos--)
+        {
+            int current_chr = 0;
+
+            if (mc_search__get_char (lc_mc_search, user_data, pos - 1, &current_chr)
+                == MC_SEARCH_CB_OK && current_chr == '\n')
+                break;
+        }
+
+        return pos;
+    }
+
+    while (pos > 0)
+    {
+        gsize start, offset, line_start = 0;
+
+        start = pos > MC_SEARCH_BACKWARD_BLOCK_MIN ? pos - MC_SEARCH_BACKWARD_BLOCK_MIN : 0;
+
+        /* data is got forwards, the last newline before pos wins */
+        for (offset = start; offset < pos;)
+        {
+            const char *buf;
+            gsize buf_len = 0, i;
+
+            buf = lc_mc_search->search_buf_fn (user_data, offset, &buf_len);
+            if (buf == NULL || buf_len == 0)
+                break;
+
+            buf_len = MIN (buf_len, pos - offset);
+            for (i = buf_len; i > 0; i--)
+                if (buf[i - 1] == '\n')
+                {
+                    line_start = offset + i;
+                    break;
+                }
+
+            offset += buf_len;
+        }
+
+        if (line_start != 0)
+            return line_start;
+
+        pos = start;
+    }
+
+    return 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 /*** public functions ****************************************************************************/
@@ -281,6 +396,97 @@ mc_search_run (mc_search_t * lc_mc_search, const void *user_data,
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search backwards: find the occurrence with the greatest offset not exceeding start_search.
+ *
+ * Blocks preceding start_search are scanned forwards by mc_search_run(), the last occurrence
+ * in the block wins. Blocks grow as the search goes back, so search for a near occurrence
+ * is fast and search over the whole data is linear. Regex blocks start at the line start
+ * and each run gets its line from the start as the context, so anchors and word boundaries
+ * match like they do in forward search.
+ *
+ * @param end_search end of data, occurrences cannot cross it
+ * @return TRUE if found. Results are set like mc_search_run() does.
+ */
+
+gboolean
+mc_search_run_backward (mc_search_t * lc_mc_search, const void *user_data, gsize start_search,
+                        gsize end_search, gsize * found_len)
+{
+    gsize block = MC_SEARCH_BACKWARD_BLOCK_MIN;
+    gsize limit = start_search;
+
+    if (lc_mc_search == NULL || user_data == NULL)
+        return FALSE;
+
+    while (TRUE)
+    {
+        gsize block_start, block_end, pos, line_start;
+        gsize found_pos = 0, found_line_start = 0;
+        gboolean found = FALSE;
+
+        block_start = limit >= block ? limit - block + 1 : 0;
+        block_start = mc_search__backward_line_start (lc_mc_search, user_data, block_start);
+        block_end = mc_search__backward_end (lc_mc_search, user_data, limit, end_search);
+
+        for (pos = line_start = block_start; pos <= limit;)
+        {
+            gboolean ok;
+
+            lc_mc_search->line_context = pos - line_start;
+            ok = mc_search_run (lc_mc_search, user_data, pos, block_end, NULL);
+            lc_mc_search->line_context = 0;
+
+            if (!ok)
+            {
+                /* error or interruption */
+                if (lc_mc_search->error != MC_SEARCH_E_NOTFOUND
+                    || lc_mc_search->error_str == NULL)
+                    return FALSE;
+                break;
+            }
+
+            if ((gsize) lc_mc_search->normal_offset > limit)
+                break;
+
+            found = TRUE;
+            found_pos = pos;
+            found_line_start = line_start;
+            pos = (gsize) lc_mc_search->normal_offset + 1;
+            /* regex sets start_buffer to the start of line containing the occurrence */
+            line_start = MIN ((gsize) lc_mc_search->start_buffer, pos);
+        }
+
+        /* repeat search which found the last occurrence to get its results */
+        if (found)
+        {
+            gboolean ok;
+
+            lc_mc_search->line_context = found_pos - found_line_start;
+            ok = mc_search_run (lc_mc_search, user_data, found_pos, block_end, found_len);
+            lc_mc_search->line_context = 0;
+
+            return ok;
+        }
+
+        if (block_start == 0)
+            return FALSE;
+
+        limit = block_start - 1;
+        if (block < MC_SEARCH_BACKWARD_BLOCK_MAX)
+            block *= 2;
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, limit) == MC_SEARCH_CB_ABORT)
+        {
+            g_free (lc_mc_search->error_str);
+            lc_mc_search->error_str = NULL;
+            return FALSE;
+        }
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
@@ -397,11 +603,60 @@ mc_search (const gchar * pattern, const gchar * str, mc_search_type_t type)
     if (type == MC_SEARCH_T_GLOB)
         search->is_entire_line = TRUE;
 
-    ret = mc_search_run (search, str, 0, strlen (str), NULL);
+    ret = mc_search_match_str (search, str, strlen (str));
     mc_search_free (search);
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the string matches the search conditions. Unlike mc_search_run(), the string
+ * is matched as a whole, no match positions are stored and mc_search is not changed
+ * once it is prepared, so the same compiled search can be used for many strings.
+ * Globs like "*.ext", "prefix*" and "*substring*" are matched without regex.
+ *
+ * @param lc_mc_search search conditions
+ * @param str string to match
+ * @param str_len length of str
+ * @return TRUE if string matches
+ */
+
+gboolean
+mc_search_match_str (mc_search_t * lc_mc_search, const gchar * str, gsize str_len)
+{
+    gsize loop1;
+
+    if (lc_mc_search == NULL || str == NULL)
+        return FALSE;
+
+    if ((lc_mc_search->conditions == NULL) && !mc_search_prepare (lc_mc_search))
+        return FALSE;
+
+    for (loop1 = 0; loop1 < lc_mc_search->conditions->len; loop1++)
+    {
+        mc_search_cond_t *mc_search_cond;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop1);
+
+        if (mc_search_cond->glob_simple != GLOB__NOT_SIMPLE)
+        {
+            if (mc_search__glob_simple_match (lc_mc_search, mc_search_cond, str, str_len))
+                return TRUE;
+        }
+        else if (mc_search_cond->normal_literal != NULL)
+        {
+            if (mc_search__find_literal (mc_search_cond->normal_literal,
+                                         lc_mc_search->is_case_sensitive, str, str_len) != NULL)
+                return TRUE;
+        }
+        else if (mc_search_cond->regex_handle != NULL
+                 && mc_search__regex_match_str (mc_search_cond->regex_handle, str, str_len))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
@@ -49,7 +49,7 @@ enum compression_type
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
-/* keys are set only during sorting */
+/* keys are created on the first sorting by name or extension and kept until the entry is freed */
 typedef struct
 {
     /* File attributes */
@@ -60,6 +60,9 @@ typedef struct
     char *sort_key;
     /* key used for comparing extensions */
     char *second_sort_key;
+    /* file highlighting color and the stamp of the filters it was found with, 0 if none */
+    int fhl_color;
+    unsigned int fhl_stamp;
 
     /* Flags */
     struct
@@ -68,6 +71,7 @@ typedef struct
         unsigned int link_to_dir:1;     /* If this is a link, does it point to directory? */
         unsigned int stale_link:1;      /* If this is a symlink and points to Charon's land */
         unsigned int dir_size_computed:1;       /* Size of directory was computed with dirsizes_cmd */
+        unsigned int sort_key_case_sen:1;       /* Sort keys were created for case sensitive sorting */
     } f;
 } file_entry;
 
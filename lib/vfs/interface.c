@@ -498,6 +498,11 @@ mc_readdir (DIR * dirp)
         g_string_assign (vfs_str_buffer, entry->d_name);
 #endif
         mc_readdir_result->d_ino = entry->d_ino;
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+        /* entry type is reliable for local filesystem only */
+        mc_readdir_result->d_type =
+            (vfs->flags & VFSF_LOCAL) != 0 ? entry->d_type : (unsigned char) DT_UNKNOWN;
+#endif
         g_strlcpy (mc_readdir_result->d_name, vfs_str_buffer->str, MAXNAMLEN + 1);
     }
     if (entry == NULL)
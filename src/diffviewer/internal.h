@@ -86,7 +86,6 @@ typedef struct WDiff
 {
     Widget widget;
 
-    const char *args;           /* Args passed to diff */
     const char *file[DIFF_COUNT];       /* filenames */
     char *label[DIFF_COUNT];
     FBUF *f[DIFF_COUNT];
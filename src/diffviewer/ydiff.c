@@ -32,7 +32,6 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 
 #include "lib/global.h"
 #include "lib/tty/tty.h"
@@ -86,9 +85,12 @@ do { \
 #define CHG_CH '*'
 #define EQU_CH ' '
 
+/* cost limits of a single step of the line diff, see dff_split() */
+#define DIFF_TOO_EXPENSIVE 4096
+#define DIFF_TOO_EXPENSIVE_FAST 256
+
 #define HDIFF_ENABLE 1
 #define HDIFF_MINCTX 5
-#define HDIFF_DEPTH 10
 
 #define FILE_DIRTY(fs) \
 do \
@@ -106,6 +108,45 @@ typedef enum
     FROM_RIGHT_TO_LEFT
 } action_direction_t;
 
+/* line of a file being compared */
+typedef struct
+{
+    const char *text;           /* line normalized according to the diff options */
+    size_t len;
+    guint hash;
+    gboolean incomplete;        /* last line without newline */
+    char *buf;                  /* owned copy of text, if any */
+    PAIR count;                 /* number of lines of this class in each file */
+} LINEKEY;
+
+/* bucket of the table of line classes */
+typedef struct
+{
+    guint hash;
+    int id;                     /* number of class, -1 if empty */
+} LINEBUCKET;
+
+/* equivalence classes of lines */
+typedef struct
+{
+    GArray *keys;               /* LINEKEY of every class, indexed by number of class */
+    LINEBUCKET *buckets;        /* open addressing table of classes */
+    guint mask;                 /* number of buckets minus one */
+} LINECLASSES;
+
+/* state of the line diff */
+typedef struct
+{
+    const int *x;               /* line classes of the first file */
+    const int *y;               /* line classes of the second file */
+    const int *xmap;            /* line numbers of x in the first file, NULL if same */
+    const int *ymap;            /* line numbers of y in the second file, NULL if same */
+    char *changed[DIFF_COUNT];  /* marks of changed lines */
+    int *fdiag;                 /* furthest reaching forward paths, indexed by diagonal */
+    int *bdiag;                 /* furthest reaching backward paths, indexed by diagonal */
+    int too_expensive;
+} DIFFSEQ;
+
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
@@ -485,71 +526,6 @@ f_close (FBUF * fs)
 
 /* --------------------------------------------------------------------------------------------- */
 
-/**
- * Create pipe stream to process.
- *
- * @param cmd shell command line
- * @param flags open mode, either O_RDONLY or O_WRONLY
- *
- * @return file structure
- */
-
-static FBUF *
-p_open (const char *cmd, int flags)
-{
-    FILE *f;
-    FBUF *fs;
-    const char *type = NULL;
-
-    if (flags == O_RDONLY)
-        type = "r";
-    else if (flags == O_WRONLY)
-        type = "w";
-
-    if (type == NULL)
-        return NULL;
-
-    fs = f_dopen (0);
-    if (fs == NULL)
-        return NULL;
-
-    f = popen (cmd, type);
-    if (f == NULL)
-    {
-        f_free (fs);
-        return NULL;
-    }
-
-    fs->fd = fileno (f);
-    fs->data = f;
-    return fs;
-}
-
-/* --------------------------------------------------------------------------------------------- */
-
-/**
- * Close pipe stream.
- *
- * @param fs structure
- * @return 0 on success, non-zero on error
- */
-
-static int
-p_close (FBUF * fs)
-{
-    int rv = -1;
-
-    if (fs != NULL)
-    {
-        rv = pclose (fs->data);
-        f_free (fs);
-    }
-
-    return rv;
-}
-
-/* --------------------------------------------------------------------------------------------- */
-
 /**
  * Get one char (byte) from string
  *
@@ -649,7 +625,7 @@ dview_str_utf8_offset_to_pos (const char *text, size_t length)
 
 /* --------------------------------------------------------------------------------------------- */
 
-/* diff parse *************************************************************** */
+/* diff statements ********************************************************* */
 
 /**
  * Read decimal number from string.
@@ -675,112 +651,616 @@ scan_deci (const char **str, int *n)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/* line diff **************************************************************** */
+
 /**
- * Parse line for diff statement.
+ * Bring a line to the form used for comparison according to the diff options.
  *
- * @param p string to parse
- * @param ops list of diff statements
- * @return 0 if success, otherwise non-zero
+ * @param dview diff view
+ * @param s line without newline
+ * @param len length of line
+ * @param buf buffer for the normalized line
+ * @param[out] rlen length of normalized line
+ * @return normalized line: either s or buf->str
+ */
+
+static const char *
+dff_normalize_line (const WDiff * dview, const char *s, size_t len, GString * buf, size_t * rlen)
+{
+    size_t i;
+
+    if (dview->opt.strip_trailing_cr && len != 0 && s[len - 1] == '\r')
+        len--;
+
+    if (!dview->opt.ignore_case && !dview->opt.ignore_tab_expansion
+        && !dview->opt.ignore_space_change && !dview->opt.ignore_all_space)
+    {
+        *rlen = len;
+        return s;
+    }
+
+    g_string_set_size (buf, 0);
+
+    for (i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char) s[i];
+
+        if (dview->opt.ignore_all_space)
+        {
+            if (isspace (c))
+                continue;
+        }
+        else if (dview->opt.ignore_space_change)
+        {
+            if (isspace (c))
+            {
+                while (i + 1 < len && isspace ((unsigned char) s[i + 1]))
+                    i++;
+                /* white space at end of line is ignored */
+                if (i + 1 < len)
+                    g_string_append_c (buf, ' ');
+                continue;
+            }
+        }
+        else if (dview->opt.ignore_tab_expansion && c == '\t')
+        {
+            do
+                g_string_append_c (buf, ' ');
+            while (buf->len % 8 != 0);
+            continue;
+        }
+
+        g_string_append_c (buf, dview->opt.ignore_case ? tolower (c) : c);
+    }
+
+    *rlen = buf->len;
+    return buf->str;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dff_line_equal (const LINEKEY * ka, const LINEKEY * kb)
+{
+    return ka->hash == kb->hash && ka->len == kb->len && ka->incomplete == kb->incomplete
+        && memcmp (ka->text, kb->text, ka->len) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dff_classes_init (LINECLASSES * classes)
+{
+    classes->keys = g_array_new (FALSE, FALSE, sizeof (LINEKEY));
+    classes->mask = 1023;
+    classes->buckets = g_new (LINEBUCKET, classes->mask + 1);
+    memset (classes->buckets, -1, (classes->mask + 1) * sizeof (LINEBUCKET));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dff_classes_free (LINECLASSES * classes)
+{
+    guint i;
+
+    for (i = 0; i < classes->keys->len; i++)
+        g_free (g_array_index (classes->keys, LINEKEY, i).buf);
+    g_array_free (classes->keys, TRUE);
+    g_free (classes->buckets);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Double the number of buckets and put classes to them again.
+ */
+
+static void
+dff_classes_grow (LINECLASSES * classes)
+{
+    guint i, j;
+
+    g_free (classes->buckets);
+    classes->mask = classes->mask * 2 + 1;
+    classes->buckets = g_new (LINEBUCKET, classes->mask + 1);
+    memset (classes->buckets, -1, (classes->mask + 1) * sizeof (LINEBUCKET));
+
+    for (i = 0; i < classes->keys->len; i++)
+    {
+        guint hash = g_array_index (classes->keys, LINEKEY, i).hash;
+
+        for (j = hash & classes->mask; classes->buckets[j].id != -1; j = (j + 1) & classes->mask)
+            ;
+        classes->buckets[j].hash = hash;
+        classes->buckets[j].id = i;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Find the equivalence class of line, add a new class if there is none.
+ *
+ * @param classes table of known lines
+ * @param key line; its text must live as long as the table unless it is in buf
+ * @param buf reused buffer of normalized lines
+ * @return number of the class
  */
 
 static int
-scan_line (const char *p, GArray * ops)
+dff_line_class (LINECLASSES * classes, const LINEKEY * key, const GString * buf)
 {
-    DIFFCMD op;
+    LINEKEY *k;
+    guint i;
+    int id;
+
+    /* open addressing with linear probing */
+    for (i = key->hash & classes->mask; classes->buckets[i].id != -1; i = (i + 1) & classes->mask)
+    {
+        id = classes->buckets[i].id;
+        if (classes->buckets[i].hash == key->hash
+            && dff_line_equal (&g_array_index (classes->keys, LINEKEY, id), key))
+            return id;
+    }
 
-    int f1, f2;
-    int t1, t2;
-    int cmd;
-    int range;
+    id = classes->keys->len;
+    g_array_append_vals (classes->keys, key, 1);
+    k = &g_array_index (classes->keys, LINEKEY, id);
+    k->buf = NULL;
+    k->count[DIFF_LEFT] = k->count[DIFF_RIGHT] = 0;
+    /* the normalized line lives in the reused buffer */
+    if (key->text == buf->str)
+        k->text = k->buf = g_memdup (key->text, key->len);
+    classes->buckets[i].hash = key->hash;
+    classes->buckets[i].id = id;
 
-    /* handle the following cases:
-     *  NUMaNUM[,NUM]
-     *  NUM[,NUM]cNUM[,NUM]
-     *  NUM[,NUM]dNUM
-     * where NUM is a positive integer
-     */
+    /* keep the table at most half full */
+    if ((guint) id >= classes->mask / 2)
+        dff_classes_grow (classes);
 
-    if (scan_deci (&p, &f1) != 0 || f1 < 0)
-        return -1;
+    return id;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Split file into lines and replace every line by the number of its equivalence class.
+ *
+ * @param dview diff view
+ * @param text file contents
+ * @param size size of file
+ * @param ord file being hashed
+ * @param classes table of known lines, counts of lines in the file are updated
+ * @param lines list of line classes to fill
+ */
 
-    f2 = f1;
-    range = 0;
-    if (*p == ',')
+static void
+dff_hash_lines (const WDiff * dview, const char *text, size_t size, diff_place_t ord,
+                LINECLASSES * classes, GArray * lines)
+{
+    GString *buf;
+    size_t pos = 0;
+
+    buf = g_string_sized_new (128);
+
+    while (pos < size)
     {
-        p++;
-        if (scan_deci (&p, &f2) != 0 || f2 < f1)
-            return -1;
+        const char *s, *nl;
+        size_t len;
+        LINEKEY key;
+        int id;
+
+        nl = memchr (text + pos, '\n', size - pos);
+        len = (nl != NULL ? (size_t) (nl - text) : size) - pos;
+
+        s = dff_normalize_line (dview, text + pos, len, buf, &key.len);
+        key.text = s;
+        /* like in GNU diff, a missing newline is a white space change */
+        key.incomplete = nl == NULL && !dview->opt.ignore_space_change
+            && !dview->opt.ignore_all_space;
+        key.hash = 5381;
+        for (len = 0; len < key.len; len++)
+            key.hash = (key.hash << 5) + key.hash + (unsigned char) s[len];
+
+        id = dff_line_class (classes, &key, buf);
+        g_array_index (classes->keys, LINEKEY, id).count[ord]++;
+        g_array_append_val (lines, id);
 
-        range = 1;
+        pos = nl != NULL ? (size_t) (nl - text) + 1 : size;
     }
 
-    cmd = *p++;
-    if (cmd == 'a')
+    g_string_free (buf, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Find the midpoint of the shortest edit script for a part of sequences
+ * (Myers' O(ND) algorithm searching from both ends).
+ *
+ * If the search becomes too expensive, the point furthest from the ends is returned instead,
+ * which gives a good but not necessarily minimal result.
+ */
+
+static void
+dff_split (const DIFFSEQ * seq, int xoff, int xlim, int yoff, int ylim, int *xmid, int *ymid)
+{
+    const int *xv = seq->x;
+    const int *yv = seq->y;
+    int *fd = seq->fdiag;
+    int *bd = seq->bdiag;
+    int dmin = xoff - ylim;
+    int dmax = xlim - yoff;
+    int fmid = xoff - yoff;
+    int bmid = xlim - ylim;
+    int fmin = fmid, fmax = fmid;
+    int bmin = bmid, bmax = bmid;
+    gboolean odd = ((fmid - bmid) & 1) != 0;
+    int c;
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+
+    for (c = 1;; c++)
+    {
+        int d;
+
+        /* extend the forward search by one edit */
+        if (fmin > dmin)
+            fd[--fmin - 1] = -1;
+        else
+            fmin++;
+        if (fmax < dmax)
+            fd[++fmax + 1] = -1;
+        else
+            fmax--;
+
+        for (d = fmax; d >= fmin; d -= 2)
+        {
+            int x, y;
+
+            x = fd[d - 1] >= fd[d + 1] ? fd[d - 1] + 1 : fd[d + 1];
+            y = x - d;
+            while (x < xlim && y < ylim && xv[x] == yv[y])
+            {
+                x++;
+                y++;
+            }
+            fd[d] = x;
+            if (odd && bmin <= d && d <= bmax && bd[d] <= x)
+            {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        /* extend the backward search by one edit */
+        if (bmin > dmin)
+            bd[--bmin - 1] = INT_MAX;
+        else
+            bmin++;
+        if (bmax < dmax)
+            bd[++bmax + 1] = INT_MAX;
+        else
+            bmax--;
+
+        for (d = bmax; d >= bmin; d -= 2)
+        {
+            int x, y;
+
+            x = bd[d - 1] < bd[d + 1] ? bd[d - 1] : bd[d + 1] - 1;
+            y = x - d;
+            while (x > xoff && y > yoff && xv[x - 1] == yv[y - 1])
+            {
+                x--;
+                y--;
+            }
+            bd[d] = x;
+            if (!odd && fmin <= d && d <= fmax && x <= fd[d])
+            {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        if (c >= seq->too_expensive)
+        {
+            int fxybest = -1, fxbest = 0;
+            int bxybest = INT_MAX, bxbest = INT_MAX;
+
+            for (d = fmax; d >= fmin; d -= 2)
+            {
+                int x, y;
+
+                x = min (fd[d], xlim);
+                y = x - d;
+                if (y > ylim)
+                {
+                    x = ylim + d;
+                    y = ylim;
+                }
+                if (fxybest < x + y)
+                {
+                    fxybest = x + y;
+                    fxbest = x;
+                }
+            }
+
+            for (d = bmax; d >= bmin; d -= 2)
+            {
+                int x, y;
+
+                x = max (xoff, bd[d]);
+                y = x - d;
+                if (y < yoff)
+                {
+                    x = yoff + d;
+                    y = yoff;
+                }
+                if (x + y < bxybest)
+                {
+                    bxybest = x + y;
+                    bxbest = x;
+                }
+            }
+
+            if ((xlim + ylim) - bxybest < fxybest - (xoff + yoff))
+            {
+                *xmid = fxbest;
+                *ymid = fxybest - fxbest;
+            }
+            else
+            {
+                *xmid = bxbest;
+                *ymid = bxybest - bxbest;
+            }
+            return;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Mark lines which are not part of the longest common subsequence of a part of sequences.
+ */
+
+static void
+dff_compare_seq (const DIFFSEQ * seq, int xoff, int xlim, int yoff, int ylim)
+{
+    const int *xv = seq->x;
+    const int *yv = seq->y;
+
+    /* skip common head and tail */
+    while (xoff < xlim && yoff < ylim && xv[xoff] == yv[yoff])
     {
-        if (range != 0)
-            return -1;
+        xoff++;
+        yoff++;
+    }
+    while (xlim > xoff && ylim > yoff && xv[xlim - 1] == yv[ylim - 1])
+    {
+        xlim--;
+        ylim--;
     }
-    else if (cmd != 'c' && cmd != 'd')
-        return -1;
 
-    if (scan_deci (&p, &t1) != 0 || t1 < 0)
-        return -1;
+    if (xoff == xlim)
+        for (; yoff < ylim; yoff++)
+            seq->changed[DIFF_RIGHT][seq->ymap != NULL ? seq->ymap[yoff] : yoff] = 1;
+    else if (yoff == ylim)
+        for (; xoff < xlim; xoff++)
+            seq->changed[DIFF_LEFT][seq->xmap != NULL ? seq->xmap[xoff] : xoff] = 1;
+    else
+    {
+        int xmid, ymid;
+
+        dff_split (seq, xoff, xlim, yoff, ylim, &xmid, &ymid);
+        dff_compare_seq (seq, xoff, xmid, yoff, ymid);
+        dff_compare_seq (seq, xmid, xlim, ymid, ylim);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Find anchors like patience diff does: lines occurring once in each file whose order is the
+ * same in both files (the longest increasing subsequence of their positions).
+ *
+ * @param seq sequences
+ * @param xlen length of the first sequence
+ * @param ylen length of the second sequence
+ * @param keys classes of lines
+ * @param anchors list of positions of anchors in both sequences (PAIR) to fill
+ */
+
+static void
+dff_find_anchors (const DIFFSEQ * seq, int xlen, int ylen, const GArray * keys, GArray * anchors)
+{
+    int *ypos, *cand, *tails, *prev;
+    int i, k = 0, piles = 0;
 
-    t2 = t1;
-    range = 0;
-    if (*p == ',')
+    /* positions in the second sequence of unique lines */
+    ypos = g_new (int, keys->len + 1);
+    for (i = 0; i < (int) keys->len; i++)
+        ypos[i] = -1;
+    for (i = 0; i < ylen; i++)
     {
-        p++;
-        if (scan_deci (&p, &t2) != 0 || t2 < t1)
-            return -1;
+        const LINEKEY *key = &g_array_index (keys, LINEKEY, seq->y[i]);
 
-        range = 1;
+        if (key->count[DIFF_LEFT] == 1 && key->count[DIFF_RIGHT] == 1)
+            ypos[seq->y[i]] = i;
     }
 
-    if (cmd == 'd' && range != 0)
-        return -1;
+    /* unique lines in order of the first sequence */
+    cand = g_new (int, xlen + 1);
+    for (i = 0; i < xlen; i++)
+        if (ypos[seq->x[i]] >= 0)
+            cand[k++] = i;
 
-    op.a[0][0] = f1;
-    op.a[0][1] = f2;
-    op.cmd = cmd;
-    op.a[1][0] = t1;
-    op.a[1][1] = t2;
-    g_array_append_val (ops, op);
-    return 0;
+    /* patience sorting: tails[p] is the candidate on top of pile p,
+       prev[i] is the candidate on top of the previous pile when i was put */
+    tails = g_new (int, k + 1);
+    prev = g_new (int, k + 1);
+    for (i = 0; i < k; i++)
+    {
+        int y = ypos[seq->x[cand[i]]];
+        int lo = 0, hi = piles;
+
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+
+            if (ypos[seq->x[cand[tails[mid]]]] < y)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        prev[i] = lo > 0 ? tails[lo - 1] : -1;
+        tails[lo] = i;
+        if (lo == piles)
+            piles++;
+    }
+
+    g_array_set_size (anchors, piles);
+    for (i = piles > 0 ? tails[piles - 1] : -1; i >= 0; i = prev[i])
+    {
+        piles--;
+        g_array_index (anchors, PAIR, piles)[DIFF_LEFT] = cand[i];
+        g_array_index (anchors, PAIR, piles)[DIFF_RIGHT] = ypos[seq->x[cand[i]]];
+    }
+
+    g_free (prev);
+    g_free (tails);
+    g_free (cand);
+    g_free (ypos);
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 /**
- * Parse diff output and extract diff statements.
+ * Mark elements which are not part of the longest common subsequence of two sequences.
  *
- * @param f stream to read from
- * @param ops list of diff statements to fill
- * @return positive number indicating number of hunks, otherwise negative
+ * Unless the minimal result is required, elements which are unique in both sequences are matched
+ * first (see dff_find_anchors()), and only parts between them are compared.
+ *
+ * @param seq sequences, their maps and marks of changes; the rest is set up here
+ * @param xlen length of the first sequence
+ * @param ylen length of the second sequence
+ * @param keys classes of lines to find anchors, NULL to compare without anchors
+ * @param too_expensive minimal cost limit of a single split, INT_MAX to find the minimal result
  */
 
-static int
-scan_diff (FBUF * f, GArray * ops)
+static void
+dff_compare (DIFFSEQ * seq, int xlen, int ylen, const GArray * keys, int too_expensive)
 {
-    int sz;
-    char buf[BUFSIZ];
+    int *diag;
+    int i;
 
-    while ((sz = f_gets (buf, sizeof (buf) - 1, f)) != 0)
+    /* diagonals from -ylen - 1 to xlen + 1 */
+    diag = g_new (int, 2 * (xlen + ylen + 3));
+    seq->fdiag = diag + ylen + 1;
+    seq->bdiag = seq->fdiag + xlen + ylen + 3;
+
+    /* limit the cost of a single split to about square root of the problem size */
+    seq->too_expensive = too_expensive;
+    if (too_expensive != INT_MAX)
     {
-        if (isdigit (buf[0]))
+        int c = 1;
+
+        for (i = xlen + ylen + 3; i != 0; i >>= 2)
+            c <<= 1;
+        seq->too_expensive = max (too_expensive, c);
+    }
+
+    if (keys == NULL || too_expensive == INT_MAX)
+        dff_compare_seq (seq, 0, xlen, 0, ylen);
+    else
+    {
+        GArray *anchors;
+        int xoff = 0, yoff = 0;
+
+        anchors = g_array_new (FALSE, FALSE, sizeof (PAIR));
+        dff_find_anchors (seq, xlen, ylen, keys, anchors);
+
+        for (i = 0; i < (int) anchors->len; i++)
         {
-            if (buf[sz - 1] != '\n')
-                return -1;
+            const int *a = g_array_index (anchors, PAIR, i);
 
-            buf[sz] = '\0';
-            if (scan_line (buf, ops) != 0)
-                return -1;
+            dff_compare_seq (seq, xoff, a[DIFF_LEFT], yoff, a[DIFF_RIGHT]);
+            xoff = a[DIFF_LEFT] + 1;
+            yoff = a[DIFF_RIGHT] + 1;
+        }
+        dff_compare_seq (seq, xoff, xlen, yoff, ylen);
+
+        g_array_free (anchors, TRUE);
+    }
+
+    g_free (diag);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Convert marks of changed lines to diff statements.
+ *
+ * @param changed marks of changed lines of both files
+ * @param n number of lines of both files
+ * @param ops list of diff statements to fill
+ * @return number of hunks, negative on error
+ */
+
+static int
+dff_build_ops (char *const *changed, const int *n, GArray * ops)
+{
+    int i = 0, j = 0;
 
+    while (i < n[DIFF_LEFT] || j < n[DIFF_RIGHT])
+    {
+        DIFFCMD op;
+        int i0 = i, j0 = j;
+
+        if (i < n[DIFF_LEFT] && j < n[DIFF_RIGHT] && !changed[DIFF_LEFT][i]
+            && !changed[DIFF_RIGHT][j])
+        {
+            i++;
+            j++;
             continue;
         }
 
-        while (buf[sz - 1] != '\n' && (sz = f_gets (buf, sizeof (buf), f)) != 0)
-            ;
+        while (i < n[DIFF_LEFT] && changed[DIFF_LEFT][i])
+            i++;
+        while (j < n[DIFF_RIGHT] && changed[DIFF_RIGHT][j])
+            j++;
+
+        if (i == i0 && j == j0)
+            return -1;
+
+        if (i == i0)
+        {
+            op.cmd = 'a';
+            op.a[0][0] = op.a[0][1] = i0;
+            op.a[1][0] = j0 + 1;
+            op.a[1][1] = j;
+        }
+        else if (j == j0)
+        {
+            op.cmd = 'd';
+            op.a[0][0] = i0 + 1;
+            op.a[0][1] = i;
+            op.a[1][0] = op.a[1][1] = j0;
+        }
+        else
+        {
+            op.cmd = 'c';
+            op.a[0][0] = i0 + 1;
+            op.a[0][1] = i;
+            op.a[1][0] = j0 + 1;
+            op.a[1][1] = j;
+        }
+        g_array_append_val (ops, op);
     }
 
     return ops->len;
@@ -789,65 +1269,134 @@ scan_diff (FBUF * f, GArray * ops)
 /* --------------------------------------------------------------------------------------------- */
 
 /**
- * Invoke diff and extract diff statements.
+ * Compare files line by line and extract diff statements.
  *
- * @param args extra arguments to be passed to diff
- * @param extra more arguments to be passed to diff
- * @param file1 first file to compare
- * @param file2 second file to compare
+ * @param dview diff view: comparison options
+ * @param text contents of both files
+ * @param size sizes of both files
  * @param ops list of diff statements to fill
  *
  * @return positive number indicating number of hunks, otherwise negative
  */
 
 static int
-dff_execute (const char *args, const char *extra, const char *file1, const char *file2,
-             GArray * ops)
-{
-    static const char *opt =
-        " --old-group-format='%df%(f=l?:,%dl)d%dE\n'"
-        " --new-group-format='%dea%dF%(F=L?:,%dL)\n'"
-        " --changed-group-format='%df%(f=l?:,%dl)c%dF%(F=L?:,%dL)\n'"
-        " --unchanged-group-format=''";
-
-    int rv;
-    FBUF *f;
-    char *cmd;
-    int code;
-    char *file1_esc, *file2_esc;
-
-    /* escape potential $ to avoid shell variable substitutions in popen() */
-    file1_esc = strutils_shell_escape (file1);
-    file2_esc = strutils_shell_escape (file2);
-    cmd = g_strdup_printf ("diff %s %s %s %s %s", args, extra, opt, file1_esc, file2_esc);
-    g_free (file1_esc);
-    g_free (file2_esc);
-
-    if (cmd == NULL)
-        return -1;
+dff_execute (const WDiff * dview, const char *const *text, const size_t * size, GArray * ops)
+{
+    GArray *lines[DIFF_COUNT];
+    LINECLASSES classes;
+    char *changed[DIFF_COUNT];
+    int *seqbuf[DIFF_COUNT], *mapbuf[DIFF_COUNT];
+    int n[DIFF_COUNT], len[DIFF_COUNT];
+    DIFFSEQ seq;
+    int ord, i, rv;
 
-    f = p_open (cmd, O_RDONLY);
-    g_free (cmd);
+    dff_classes_init (&classes);
 
-    if (f == NULL)
-        return -1;
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+    {
+        lines[ord] = g_array_new (FALSE, FALSE, sizeof (int));
+        dff_hash_lines (dview, text[ord], size[ord], ord, &classes, lines[ord]);
+    }
+
+    /* lines absent in the other file are changed anyway: leave them out of the search */
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+    {
+        n[ord] = lines[ord]->len;
+        changed[ord] = g_new0 (char, n[ord] + 1);
+        seqbuf[ord] = g_new (int, n[ord] + 1);
+        mapbuf[ord] = g_new (int, n[ord] + 1);
+        len[ord] = 0;
 
-    rv = scan_diff (f, ops);
-    code = p_close (f);
+        for (i = 0; i < n[ord]; i++)
+        {
+            int id = g_array_index (lines[ord], int, i);
 
-    if (rv < 0 || code == -1 || !WIFEXITED (code) || WEXITSTATUS (code) == 2)
-        rv = -1;
+            if (g_array_index (classes.keys, LINEKEY, id).count[ord ^ 1] == 0)
+                changed[ord][i] = 1;
+            else
+            {
+                seqbuf[ord][len[ord]] = id;
+                mapbuf[ord][len[ord]] = i;
+                len[ord]++;
+            }
+        }
+    }
+
+    seq.x = seqbuf[DIFF_LEFT];
+    seq.y = seqbuf[DIFF_RIGHT];
+    seq.xmap = mapbuf[DIFF_LEFT];
+    seq.ymap = mapbuf[DIFF_RIGHT];
+    seq.changed[DIFF_LEFT] = changed[DIFF_LEFT];
+    seq.changed[DIFF_RIGHT] = changed[DIFF_RIGHT];
+
+    if (dview->opt.quality == 2)
+        i = INT_MAX;
+    else if (dview->opt.quality == 1)
+        i = DIFF_TOO_EXPENSIVE_FAST;
+    else
+        i = DIFF_TOO_EXPENSIVE;
 
+    dff_compare (&seq, len[DIFF_LEFT], len[DIFF_RIGHT], classes.keys, i);
+    rv = dff_build_ops (changed, n, ops);
+
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+    {
+        g_free (changed[ord]);
+        g_free (seqbuf[ord]);
+        g_free (mapbuf[ord]);
+        g_array_free (lines[ord], TRUE);
+    }
+
+    dff_classes_free (&classes);
     return rv;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Pass the next line of file to the printer.
+ *
+ * @param text file contents
+ * @param size size of file
+ * @param off offset of the line, moved to the next line
+ * @param ch line marker
+ * @param line line number
+ * @param printer printf-like function to be used for displaying
+ * @param ctx printer context
+ *
+ * @return FALSE if the file is over, TRUE otherwise
+ */
+
+static gboolean
+dff_print_line (const char *text, size_t size, off_t * off, int ch, int line, DFUNC printer,
+                void *ctx)
+{
+    const char *nl;
+    size_t sz;
+
+    if ((size_t) *off >= size)
+        return FALSE;
+
+    nl = memchr (text + *off, '\n', size - *off);
+    sz = (nl != NULL ? (size_t) (nl - text) + 1 : size) - *off;
+    printer (ctx, ch, line, *off, sz, text + *off);
+    *off += sz;
+
+    /* last line without newline is terminated */
+    if (nl == NULL)
+        printer (ctx, 0, 0, 0, 1, "\n");
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 /**
  * Reparse and display file according to diff statements.
  *
  * @param ord DIFF_LEFT if 1nd file is displayed , DIFF_RIGHT if 2nd file is displayed.
- * @param filename file name to display
+ * @param text contents of file to display
+ * @param size size of file
  * @param ops list of diff statements
  * @param printer printf-like function to be used for displaying
  * @param ctx printer context
@@ -856,12 +1405,10 @@ dff_execute (const char *args, const char *extra, const char *file1, const char
  */
 
 static int
-dff_reparse (diff_place_t ord, const char *filename, const GArray * ops, DFUNC printer, void *ctx)
+dff_reparse (diff_place_t ord, const char *text, size_t size, const GArray * ops, DFUNC printer,
+             void *ctx)
 {
     size_t i;
-    FBUF *f;
-    size_t sz;
-    char buf[BUFSIZ];
     int line = 0;
     off_t off = 0;
     const DIFFCMD *op;
@@ -869,10 +1416,6 @@ dff_reparse (diff_place_t ord, const char *filename, const GArray * ops, DFUNC p
     int add_cmd;
     int del_cmd;
 
-    f = f_open (filename, O_RDONLY);
-    if (f == NULL)
-        return -1;
-
     ord &= 1;
     eff = ord;
 
@@ -894,26 +1437,11 @@ dff_reparse (diff_place_t ord, const char *filename, const GArray * ops, DFUNC p
         op = &g_array_index (ops, DIFFCMD, i);
         n = op->F1 - (op->cmd != add_cmd);
 
-        while (line < n && (sz = f_gets (buf, sizeof (buf), f)) != 0)
-        {
+        while (line < n && dff_print_line (text, size, &off, EQU_CH, line + 1, printer, ctx))
             line++;
-            printer (ctx, EQU_CH, line, off, sz, buf);
-            off += sz;
-            while (buf[sz - 1] != '\n')
-            {
-                sz = f_gets (buf, sizeof (buf), f);
-                if (sz == 0)
-                {
-                    printer (ctx, 0, 0, 0, 1, "\n");
-                    break;
-                }
-                printer (ctx, 0, 0, 0, sz, buf);
-                off += sz;
-            }
-        }
 
         if (line != n)
-            goto err;
+            return -1;
 
         if (op->cmd == add_cmd)
         {
@@ -928,53 +1456,27 @@ dff_reparse (diff_place_t ord, const char *filename, const GArray * ops, DFUNC p
         if (op->cmd == del_cmd)
         {
             n = op->F2 - op->F1 + 1;
-            while (n != 0 && (sz = f_gets (buf, sizeof (buf), f)) != 0)
+            while (n != 0 && dff_print_line (text, size, &off, ADD_CH, line + 1, printer, ctx))
             {
                 line++;
-                printer (ctx, ADD_CH, line, off, sz, buf);
-                off += sz;
-                while (buf[sz - 1] != '\n')
-                {
-                    sz = f_gets (buf, sizeof (buf), f);
-                    if (sz == 0)
-                    {
-                        printer (ctx, 0, 0, 0, 1, "\n");
-                        break;
-                    }
-                    printer (ctx, 0, 0, 0, sz, buf);
-                    off += sz;
-                }
                 n--;
             }
 
             if (n != 0)
-                goto err;
+                return -1;
         }
 
         if (op->cmd == 'c')
         {
             n = op->F2 - op->F1 + 1;
-            while (n != 0 && (sz = f_gets (buf, sizeof (buf), f)) != 0)
+            while (n != 0 && dff_print_line (text, size, &off, CHG_CH, line + 1, printer, ctx))
             {
                 line++;
-                printer (ctx, CHG_CH, line, off, sz, buf);
-                off += sz;
-                while (buf[sz - 1] != '\n')
-                {
-                    sz = f_gets (buf, sizeof (buf), f);
-                    if (sz == 0)
-                    {
-                        printer (ctx, 0, 0, 0, 1, "\n");
-                        break;
-                    }
-                    printer (ctx, 0, 0, 0, sz, buf);
-                    off += sz;
-                }
                 n--;
             }
 
             if (n != 0)
-                goto err;
+                return -1;
 
             n = op->T2 - op->T1 - (op->F2 - op->F1);
             while (n > 0)
@@ -989,30 +1491,10 @@ dff_reparse (diff_place_t ord, const char *filename, const GArray * ops, DFUNC p
 #undef F2
 #undef F1
 
-    while ((sz = f_gets (buf, sizeof (buf), f)) != 0)
-    {
+    while (dff_print_line (text, size, &off, EQU_CH, line + 1, printer, ctx))
         line++;
-        printer (ctx, EQU_CH, line, off, sz, buf);
-        off += sz;
-        while (buf[sz - 1] != '\n')
-        {
-            sz = f_gets (buf, sizeof (buf), f);
-            if (sz == 0)
-            {
-                printer (ctx, 0, 0, 0, 1, "\n");
-                break;
-            }
-            printer (ctx, 0, 0, 0, sz, buf);
-            off += sz;
-        }
-    }
 
-    f_close (f);
     return 0;
-
-  err:
-    f_close (f);
-    return -1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1020,214 +1502,151 @@ dff_reparse (diff_place_t ord, const char *filename, const GArray * ops, DFUNC p
 /* horizontal diff ********************************************************** */
 
 /**
- * Longest common substring.
+ * Append a horizontal diff range.
  *
- * @param s first string
- * @param m length of first string
- * @param t second string
- * @param n length of second string
- * @param ret list of offsets for longest common substrings inside each string
- * @param min minimum length of common substrings
- *
- * @return 0 if success, nonzero otherwise
+ * @param hdiff list of horizontal diff ranges to fill
+ * @param off offset of the range inside both of the strings
+ * @param end end of the range inside both of the strings
  */
 
-static int
-lcsubstr (const char *s, int m, const char *t, int n, GArray * ret, int min)
+static void
+hdiff_add (GArray * hdiff, const int off[DIFF_COUNT], const int end[DIFF_COUNT])
 {
-    int i, j;
-    int *Lprev, *Lcurr;
-    int z = 0;
-
-    if (m < min || n < min)
-    {
-        /* XXX early culling */
-        return 0;
-    }
-
-    Lprev = g_try_new0 (int, n + 1);
-    if (Lprev == NULL)
-        return -1;
-
-    Lcurr = g_try_new0 (int, n + 1);
-    if (Lcurr == NULL)
-    {
-        g_free (Lprev);
-        return -1;
-    }
-
-    for (i = 0; i < m; i++)
-    {
-        int *L;
-
-        L = Lprev;
-        Lprev = Lcurr;
-        Lcurr = L;
-#ifdef USE_MEMSET_IN_LCS
-        memset (Lcurr, 0, (n + 1) * sizeof (int));
-#endif
-        for (j = 0; j < n; j++)
-        {
-#ifndef USE_MEMSET_IN_LCS
-            Lcurr[j + 1] = 0;
-#endif
-            if (s[i] == t[j])
-            {
-                int v;
-
-                v = Lprev[j] + 1;
-                Lcurr[j + 1] = v;
-                if (z < v)
-                {
-                    z = v;
-                    g_array_set_size (ret, 0);
-                }
-                if (z == v && z >= min)
-                {
-                    int off0, off1;
-                    size_t k;
-
-                    off0 = i - z + 1;
-                    off1 = j - z + 1;
-
-                    for (k = 0; k < ret->len; k++)
-                    {
-                        PAIR *p = (PAIR *) g_array_index (ret, PAIR, k);
-                        if ((*p)[0] == off0 || (*p)[1] >= off1)
-                            break;
-                    }
-                    if (k == ret->len)
-                    {
-                        PAIR p2;
-
-                        p2[0] = off0;
-                        p2[1] = off1;
-                        g_array_append_val (ret, p2);
-                    }
-                }
-            }
-        }
-    }
+    BRACKET b;
 
-    free (Lcurr);
-    free (Lprev);
-    return z;
+    b[DIFF_LEFT].off = off[DIFF_LEFT];
+    b[DIFF_LEFT].len = end[DIFF_LEFT] - off[DIFF_LEFT];
+    b[DIFF_RIGHT].off = off[DIFF_RIGHT];
+    b[DIFF_RIGHT].len = end[DIFF_RIGHT] - off[DIFF_RIGHT];
+    g_array_append_val (hdiff, b);
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 /**
- * Scan recursively for common substrings and build ranges.
+ * Build list of horizontal diff ranges.
+ *
+ * Characters are compared with the same O(ND) diff as lines.  Common runs shorter than
+ * 'min' between two changes are merged into one range, so the line is not split into noise.
  *
  * @param s first string
+ * @param m length of first string
  * @param t second string
- * @param bracket current limits for both of the strings
+ * @param n length of second string
  * @param min minimum length of common substrings
  * @param hdiff list of horizontal diff ranges to fill
- * @param depth recursion depth
- *
- * @return 0 if success, nonzero otherwise
  */
 
-static gboolean
-hdiff_multi (const char *s, const char *t, const BRACKET bracket, int min, GArray * hdiff,
-             unsigned int depth)
+static void
+hdiff_scan (const char *s, int m, const char *t, int n, int min, GArray * hdiff)
 {
-    BRACKET p;
+    DIFFSEQ seq;
+    int *x, *y;
+    int len[DIFF_COUNT], pos[DIFF_COUNT], off[DIFF_COUNT], end[DIFF_COUNT];
+    gboolean open = FALSE;
+    int i, k;
+
+    /* skip common head and tail */
+    for (i = 0; i < m && i < n && s[i] == t[i]; i++)
+        ;
+    for (; m > i && n > i && s[m - 1] == t[n - 1]; m--, n--)
+        ;
+
+    s += i;
+    t += i;
+    len[DIFF_LEFT] = m - i;
+    len[DIFF_RIGHT] = n - i;
 
-    if (depth-- != 0)
+    if (len[DIFF_LEFT] == 0 && len[DIFF_RIGHT] == 0)
+        return;
+
+    if (len[DIFF_LEFT] == 0 || len[DIFF_RIGHT] == 0)
     {
-        GArray *ret;
-        BRACKET b;
-        int len;
+        off[DIFF_LEFT] = off[DIFF_RIGHT] = i;
+        end[DIFF_LEFT] = m;
+        end[DIFF_RIGHT] = n;
+        hdiff_add (hdiff, off, end);
+        return;
+    }
 
-        ret = g_array_new (FALSE, TRUE, sizeof (PAIR));
-        if (ret == NULL)
-            return FALSE;
+    x = g_new (int, len[DIFF_LEFT]);
+    for (k = 0; k < len[DIFF_LEFT]; k++)
+        x[k] = (unsigned char) s[k];
+    y = g_new (int, len[DIFF_RIGHT]);
+    for (k = 0; k < len[DIFF_RIGHT]; k++)
+        y[k] = (unsigned char) t[k];
+
+    seq.x = x;
+    seq.y = y;
+    seq.xmap = NULL;
+    seq.ymap = NULL;
+    seq.changed[DIFF_LEFT] = g_new0 (char, len[DIFF_LEFT]);
+    seq.changed[DIFF_RIGHT] = g_new0 (char, len[DIFF_RIGHT]);
+
+    dff_compare (&seq, len[DIFF_LEFT], len[DIFF_RIGHT], NULL, DIFF_TOO_EXPENSIVE_FAST);
+
+    pos[DIFF_LEFT] = pos[DIFF_RIGHT] = 0;
+    while (pos[DIFF_LEFT] < len[DIFF_LEFT] || pos[DIFF_RIGHT] < len[DIFF_RIGHT])
+    {
+        int start[DIFF_COUNT];
+        int run, ord;
+        gboolean moved;
 
-        len = lcsubstr (s + bracket[DIFF_LEFT].off, bracket[DIFF_LEFT].len,
-                        t + bracket[DIFF_RIGHT].off, bracket[DIFF_RIGHT].len, ret, min);
-        if (ret->len != 0)
+        /* common run */
+        for (run = 0; pos[DIFF_LEFT] < len[DIFF_LEFT] && pos[DIFF_RIGHT] < len[DIFF_RIGHT]; run++)
         {
-            size_t k = 0;
-            const PAIR *data = (const PAIR *) &g_array_index (ret, PAIR, 0);
-            const PAIR *data2;
-
-            b[DIFF_LEFT].off = bracket[DIFF_LEFT].off;
-            b[DIFF_LEFT].len = (*data)[0];
-            b[DIFF_RIGHT].off = bracket[DIFF_RIGHT].off;
-            b[DIFF_RIGHT].len = (*data)[1];
-            if (!hdiff_multi (s, t, b, min, hdiff, depth))
-                return FALSE;
-
-            for (k = 0; k < ret->len - 1; k++)
-            {
-                data = (const PAIR *) &g_array_index (ret, PAIR, k);
-                data2 = (const PAIR *) &g_array_index (ret, PAIR, k + 1);
-                b[DIFF_LEFT].off = bracket[DIFF_LEFT].off + (*data)[0] + len;
-                b[DIFF_LEFT].len = (*data2)[0] - (*data)[0] - len;
-                b[DIFF_RIGHT].off = bracket[DIFF_RIGHT].off + (*data)[1] + len;
-                b[DIFF_RIGHT].len = (*data2)[1] - (*data)[1] - len;
-                if (!hdiff_multi (s, t, b, min, hdiff, depth))
-                    return FALSE;
-            }
-            data = (const PAIR *) &g_array_index (ret, PAIR, k);
-            b[DIFF_LEFT].off = bracket[DIFF_LEFT].off + (*data)[0] + len;
-            b[DIFF_LEFT].len = bracket[DIFF_LEFT].len - (*data)[0] - len;
-            b[DIFF_RIGHT].off = bracket[DIFF_RIGHT].off + (*data)[1] + len;
-            b[DIFF_RIGHT].len = bracket[DIFF_RIGHT].len - (*data)[1] - len;
-            if (!hdiff_multi (s, t, b, min, hdiff, depth))
-                return FALSE;
-
-            g_array_free (ret, TRUE);
-            return TRUE;
+            if (seq.changed[DIFF_LEFT][pos[DIFF_LEFT]] != 0
+                || seq.changed[DIFF_RIGHT][pos[DIFF_RIGHT]] != 0)
+                break;
+            pos[DIFF_LEFT]++;
+            pos[DIFF_RIGHT]++;
         }
-    }
 
-    p[DIFF_LEFT].off = bracket[DIFF_LEFT].off;
-    p[DIFF_LEFT].len = bracket[DIFF_LEFT].len;
-    p[DIFF_RIGHT].off = bracket[DIFF_RIGHT].off;
-    p[DIFF_RIGHT].len = bracket[DIFF_RIGHT].len;
-    g_array_append_val (hdiff, p);
+        if (open && run >= min)
+        {
+            hdiff_add (hdiff, off, end);
+            open = FALSE;
+        }
 
-    return TRUE;
-}
+        /* changed run */
+        moved = FALSE;
+        for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+        {
+            start[ord] = pos[ord];
+            for (; pos[ord] < len[ord] && seq.changed[ord][pos[ord]] != 0; pos[ord]++)
+                moved = TRUE;
+        }
 
-/* --------------------------------------------------------------------------------------------- */
+        if (!moved)
+            break;
 
-/**
- * Build list of horizontal diff ranges.
- *
- * @param s first string
- * @param m length of first string
- * @param t second string
- * @param n length of second string
- * @param min minimum length of common substrings
- * @param hdiff list of horizontal diff ranges to fill
- * @param depth recursion depth
- *
- * @return 0 if success, nonzero otherwise
- */
+        if (!open)
+        {
+            off[DIFF_LEFT] = start[DIFF_LEFT];
+            off[DIFF_RIGHT] = start[DIFF_RIGHT];
+            open = TRUE;
+        }
+        end[DIFF_LEFT] = pos[DIFF_LEFT];
+        end[DIFF_RIGHT] = pos[DIFF_RIGHT];
+    }
 
-static gboolean
-hdiff_scan (const char *s, int m, const char *t, int n, int min, GArray * hdiff, unsigned int depth)
-{
-    int i;
-    BRACKET b;
+    g_free (seq.changed[DIFF_LEFT]);
+    g_free (seq.changed[DIFF_RIGHT]);
+    g_free (x);
+    g_free (y);
 
-    /* dumbscan (single horizontal diff) -- does not compress whitespace */
-    for (i = 0; i < m && i < n && s[i] == t[i]; i++)
-        ;
-    for (; m > i && n > i && s[m - 1] == t[n - 1]; m--, n--)
-        ;
+    if (open)
+        hdiff_add (hdiff, off, end);
 
-    b[DIFF_LEFT].off = i;
-    b[DIFF_LEFT].len = m - i;
-    b[DIFF_RIGHT].off = i;
-    b[DIFF_RIGHT].len = n - i;
+    /* make ranges relative to the beginning of the strings */
+    for (k = 0; k < (int) hdiff->len; k++)
+    {
+        BRACKET *b;
 
-    /* smartscan (multiple horizontal diff) */
-    return hdiff_multi (s, t, b, min, hdiff, depth);
+        b = &g_array_index (hdiff, BRACKET, k);
+        (*b)[DIFF_LEFT].off += i;
+        (*b)[DIFF_RIGHT].off += i;
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1247,20 +1666,28 @@ hdiff_scan (const char *s, int m, const char *t, int n, int min, GArray * hdiff,
 static gboolean
 is_inside (int k, GArray * hdiff, diff_place_t ord)
 {
-    size_t i;
-    BRACKET *b;
+    size_t lo, hi;
+    const BRACKET *b;
 
-    for (i = 0; i < hdiff->len; i++)
+    /* ranges are sorted and do not overlap: find the last one starting at or before k */
+    lo = 0;
+    hi = hdiff->len;
+    while (lo < hi)
     {
-        int start, end;
+        size_t mid = lo + (hi - lo) / 2;
 
-        b = &g_array_index (hdiff, BRACKET, i);
-        start = (*b)[ord].off;
-        end = start + (*b)[ord].len;
-        if (k >= start && k < end)
-            return TRUE;
+        b = &g_array_index (hdiff, BRACKET, mid);
+        if ((*b)[ord].off <= k)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    return FALSE;
+
+    if (lo == 0)
+        return FALSE;
+
+    b = &g_array_index (hdiff, BRACKET, lo - 1);
+    return (k < (*b)[ord].off + (*b)[ord].len);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1734,26 +2161,13 @@ redo_diff (WDiff * dview)
 {
     FBUF *const *f = dview->f;
     PRINTER_CTX ctx;
+    GMappedFile *map[DIFF_COUNT];
+    const char *text[DIFF_COUNT];
+    size_t size[DIFF_COUNT];
     GArray *ops;
-    int ndiff;
-    int rv;
-    char extra[256];
-
-    extra[0] = '\0';
-    if (dview->opt.quality == 2)
-        strcat (extra, " -d");
-    if (dview->opt.quality == 1)
-        strcat (extra, " --speed-large-files");
-    if (dview->opt.strip_trailing_cr)
-        strcat (extra, " --strip-trailing-cr");
-    if (dview->opt.ignore_tab_expansion)
-        strcat (extra, " -E");
-    if (dview->opt.ignore_space_change)
-        strcat (extra, " -b");
-    if (dview->opt.ignore_all_space)
-        strcat (extra, " -w");
-    if (dview->opt.ignore_case)
-        strcat (extra, " -i");
+    int ndiff = -1;
+    int ord;
+    int rv = -1;
 
     if (dview->dsrc != DATA_SRC_MEM)
     {
@@ -1761,28 +2175,42 @@ redo_diff (WDiff * dview)
         f_reset (f[DIFF_RIGHT]);
     }
 
-    ops = g_array_new (FALSE, FALSE, sizeof (DIFFCMD));
-    ndiff = dff_execute (dview->args, extra, dview->file[DIFF_LEFT], dview->file[DIFF_RIGHT], ops);
-    if (ndiff < 0)
+    /* files are read once for both comparison and display */
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
     {
-        if (ops != NULL)
-            g_array_free (ops, TRUE);
-        return -1;
+        map[ord] = g_mapped_file_new (dview->file[ord], FALSE, NULL);
+        text[ord] = map[ord] != NULL ? g_mapped_file_get_contents (map[ord]) : NULL;
+        size[ord] = map[ord] != NULL ? g_mapped_file_get_length (map[ord]) : 0;
     }
 
-    ctx.dsrc = dview->dsrc;
+    ops = g_array_new (FALSE, FALSE, sizeof (DIFFCMD));
+
+    if (map[DIFF_LEFT] != NULL && map[DIFF_RIGHT] != NULL)
+        ndiff = dff_execute (dview, text, size, ops);
+
+    if (ndiff >= 0)
+    {
+        ctx.dsrc = dview->dsrc;
+
+        rv = 0;
+        ctx.a = dview->a[DIFF_LEFT];
+        ctx.f = f[DIFF_LEFT];
+        rv |= dff_reparse (DIFF_LEFT, text[DIFF_LEFT], size[DIFF_LEFT], ops, printer, &ctx);
 
-    rv = 0;
-    ctx.a = dview->a[DIFF_LEFT];
-    ctx.f = f[DIFF_LEFT];
-    rv |= dff_reparse (DIFF_LEFT, dview->file[DIFF_LEFT], ops, printer, &ctx);
+        ctx.a = dview->a[DIFF_RIGHT];
+        ctx.f = f[DIFF_RIGHT];
+        rv |= dff_reparse (DIFF_RIGHT, text[DIFF_RIGHT], size[DIFF_RIGHT], ops, printer, &ctx);
+    }
 
-    ctx.a = dview->a[DIFF_RIGHT];
-    ctx.f = f[DIFF_RIGHT];
-    rv |= dff_reparse (DIFF_RIGHT, dview->file[DIFF_RIGHT], ops, printer, &ctx);
+    g_array_free (ops, TRUE);
 
-    if (ops != NULL)
-        g_array_free (ops, TRUE);
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+        if (map[ord] != NULL)
+#if GLIB_CHECK_VERSION (2, 22, 0)
+            g_mapped_file_unref (map[ord]);
+#else
+            g_mapped_file_free (map[ord]);
+#endif /* GLIB_CHECK_VERSION */
 
     if (rv != 0 || dview->a[DIFF_LEFT]->len != dview->a[DIFF_RIGHT]->len)
         return -1;
@@ -1795,41 +2223,47 @@ redo_diff (WDiff * dview)
 
     if (dview->dsrc == DATA_SRC_MEM && HDIFF_ENABLE)
     {
+        /* horizontal diffs are computed on demand, see dview_get_hdiff() */
         dview->hdiff = g_ptr_array_new ();
-        if (dview->hdiff != NULL)
-        {
-            size_t i;
-            const DIFFLN *p;
-            const DIFFLN *q;
+        g_ptr_array_set_size (dview->hdiff, dview->a[DIFF_LEFT]->len);
+    }
+    return ndiff;
+}
 
-            for (i = 0; i < dview->a[DIFF_LEFT]->len; i++)
-            {
-                GArray *h = NULL;
+/* --------------------------------------------------------------------------------------------- */
 
-                p = &g_array_index (dview->a[DIFF_LEFT], DIFFLN, i);
-                q = &g_array_index (dview->a[DIFF_RIGHT], DIFFLN, i);
-                if (p->line && q->line && p->ch == CHG_CH)
-                {
-                    h = g_array_new (FALSE, FALSE, sizeof (BRACKET));
-                    if (h != NULL)
-                    {
-                        gboolean runresult;
+/**
+ * Get horizontal diff ranges of a changed line, computing them on first use.
+ *
+ * @param dview WDiff widget
+ * @param i line number in the diff view
+ *
+ * @return list of horizontal diff ranges, NULL if the line is not changed on both sides
+ */
 
-                        runresult =
-                            hdiff_scan (p->p, p->u.len, q->p, q->u.len, HDIFF_MINCTX, h,
-                                        HDIFF_DEPTH);
-                        if (!runresult)
-                        {
-                            g_array_free (h, TRUE);
-                            h = NULL;
-                        }
-                    }
-                }
-                g_ptr_array_add (dview->hdiff, h);
-            }
-        }
-    }
-    return ndiff;
+static GArray *
+dview_get_hdiff (WDiff * dview, size_t i)
+{
+    const DIFFLN *p, *q;
+    GArray *h;
+
+    if (dview->hdiff == NULL || i >= dview->hdiff->len)
+        return NULL;
+
+    h = (GArray *) g_ptr_array_index (dview->hdiff, i);
+    if (h != NULL)
+        return h;
+
+    p = &g_array_index (dview->a[DIFF_LEFT], DIFFLN, i);
+    q = &g_array_index (dview->a[DIFF_RIGHT], DIFFLN, i);
+    if (p->line == 0 || q->line == 0 || p->ch != CHG_CH)
+        return NULL;
+
+    h = g_array_new (FALSE, FALSE, sizeof (BRACKET));
+    hdiff_scan (p->p, p->u.len, q->p, q->u.len, HDIFF_MINCTX, h);
+    g_ptr_array_index (dview->hdiff, i) = h;
+
+    return h;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1839,12 +2273,9 @@ destroy_hdiff (WDiff * dview)
 {
     if (dview->hdiff != NULL)
     {
-        int i;
-        int len;
-
-        len = dview->a[DIFF_LEFT]->len;
+        guint i;
 
-        for (i = 0; i < len; i++)
+        for (i = 0; i < dview->hdiff->len; i++)
         {
             GArray *h;
 
@@ -2385,7 +2816,7 @@ dview_diff_options (WDiff * dview)
 /* --------------------------------------------------------------------------------------------- */
 
 static int
-dview_init (WDiff * dview, const char *args, const char *file1, const char *file2,
+dview_init (WDiff * dview, const char *file1, const char *file2,
             const char *label1, const char *label2, DSRC dsrc)
 {
     int ndiff;
@@ -2421,7 +2852,6 @@ dview_init (WDiff * dview, const char *args, const char *file1, const char *file
         }
     }
 
-    dview->args = args;
     dview->file[DIFF_LEFT] = file1;
     dview->file[DIFF_RIGHT] = file2;
     dview->label[DIFF_LEFT] = g_strdup (label1);
@@ -2515,7 +2945,7 @@ dview_fini (WDiff * dview)
 /* --------------------------------------------------------------------------------------------- */
 
 static int
-dview_display_file (const WDiff * dview, diff_place_t ord, int r, int c, int height, int width)
+dview_display_file (WDiff * dview, diff_place_t ord, int r, int c, int height, int width)
 {
     size_t i, k;
     int j;
@@ -2564,6 +2994,7 @@ dview_display_file (const WDiff * dview, diff_place_t ord, int r, int c, int hei
     {
         int ch, next_ch, col;
         size_t cnt;
+        GArray *hdiff;
 
         p = (DIFFLN *) & g_array_index (dview->a[ord], DIFFLN, i);
         ch = p->ch;
@@ -2587,9 +3018,10 @@ dview_display_file (const WDiff * dview, diff_place_t ord, int r, int c, int hei
                 tty_setcolor (DFF_CHG_COLOR);
             if (f == NULL)
             {
+                hdiff = dview_get_hdiff (dview, i);
                 if (i == (size_t) dview->search.last_found_line)
                     tty_setcolor (MARKED_SELECTED_COLOR);
-                else if (dview->hdiff != NULL && g_ptr_array_index (dview->hdiff, i) != NULL)
+                else if (hdiff != NULL)
                 {
                     char att[BUFSIZ];
 
@@ -2599,7 +3031,7 @@ dview_display_file (const WDiff * dview, diff_place_t ord, int r, int c, int hei
                         k = width;
 
                     cvt_mgeta (p->p, p->u.len, buf, k, skip, tab_size, show_cr,
-                               g_ptr_array_index (dview->hdiff, i), ord, att);
+                               hdiff, ord, att);
                     tty_gotoyx (r + j, c);
                     col = 0;
 
@@ -3463,7 +3895,7 @@ diff_view (const char *file1, const char *file2, const char *label1, const char
 
     dview_dlg->get_title = dview_get_title;
 
-    error = dview_init (dview, "-a", file1, file2, label1, label2, DATA_SRC_MEM);       /* XXX binary diff? */
+    error = dview_init (dview, file1, file2, label1, label2, DATA_SRC_MEM);
 
     /* Please note that if you add another widget,
      * you have to modify dview_adjust_size to
@@ -55,21 +55,13 @@
 /* Buffer mask (used to find cursor position relative to the buffer) */
 #define M_EDIT_BUF_SIZE (EDIT_BUF_SIZE - 1)
 
-/*
- * Configurable: Maximal allowed number of buffers in each buffer array.
- * This number can be increased for systems with enough physical memory.
- */
-#ifndef MAXBUFF
-#define MAXBUFF 1024
-#endif
-
-/* Maximal length of file that can be opened */
-#define SIZE_LIMIT (EDIT_BUF_SIZE * (MAXBUFF - 2))
+/* Buffer with given index in the array of buffers */
+#define EDIT_BUF(buffers, index) ((unsigned char *) g_ptr_array_index ((buffers), (index)))
 
-/* Initial size of the undo stack, in bytes */
-#define START_STACK_SIZE 32
+/* Default size of file (in MiB) which is opened only after confirmation */
+#define DEFAULT_FILESIZE_THRESHOLD 64
 
-/* Some codes that may be pushed onto or returned from the undo stack */
+/* Some codes that may be pushed onto or returned from the undo journal */
 #define CURS_LEFT       601
 #define CURS_RIGHT      602
 #define DELCHAR         603
@@ -183,6 +175,7 @@ void edit_init_menu (struct WMenuBar *menubar);
 void edit_save_mode_cmd (void);
 gboolean edit_translate_key (WEdit * edit, long x_key, int *cmd, int *ch);
 int edit_get_byte (const WEdit * edit, off_t byte_index);
+const char *edit_get_chunk (const WEdit * edit, off_t byte_index, off_t * len);
 int edit_get_utf (const WEdit * edit, off_t byte_index, int *char_width);
 long edit_count_lines (const WEdit * edit, off_t current, off_t upto);
 off_t edit_move_forward (const WEdit * edit, off_t current, long lines, off_t upto);
@@ -212,11 +205,15 @@ int edit_block_delete_cmd (WEdit * edit);
 void edit_delete_line (WEdit * edit);
 
 int edit_delete (WEdit * edit, gboolean byte_delete);
+void edit_delete_chunk (WEdit * edit, off_t len);
 int edit_backspace (WEdit * edit, gboolean byte_delete);
 void edit_insert (WEdit * edit, int c);
+void edit_insert_chunk (WEdit * edit, const char *buf, size_t len);
 void edit_cursor_move (WEdit * edit, off_t increment);
 void edit_push_undo_action (WEdit * edit, long c);
+void edit_push_undo_offset (WEdit * edit, long c, off_t offset);
 void edit_push_redo_action (WEdit * edit, long c);
+void edit_push_redo_offset (WEdit * edit, long c, off_t offset);
 void edit_push_key_press (WEdit * edit);
 void edit_insert_ahead (WEdit * edit, int c);
 off_t edit_write_stream (WEdit * edit, FILE * f);
@@ -241,6 +238,7 @@ void edit_replace_cmd (WEdit * edit, int again);
 void edit_search_cmd (WEdit * edit, gboolean again);
 mc_search_cbret_t edit_search_cmd_callback (const void *user_data, gsize char_offset,
                                             int *current_char);
+const char *edit_search_cmd_get_buf (const void *user_data, gsize char_offset, gsize * len);
 void edit_complete_word_cmd (WEdit * edit);
 void edit_get_match_keyword_cmd (WEdit * edit);
 
@@ -306,6 +304,7 @@ void edit_set_filename (WEdit * edit, const vfs_path_t * name_vpath);
 void edit_load_syntax (WEdit * edit, char ***pnames, const char *type);
 void edit_free_syntax_rules (WEdit * edit);
 int edit_get_syntax_color (WEdit * edit, off_t byte_index);
+void edit_syntax_change (WEdit * edit, off_t offset, off_t delta);
 
 void book_mark_insert (WEdit * edit, long line, int c);
 gboolean book_mark_query_color (WEdit * edit, long line, int c);
@@ -84,7 +84,11 @@ int option_backspace_through_tabs = 0;
 int option_fake_half_tabs = 1;
 int option_save_mode = EDIT_QUICK_SAVE;
 int option_save_position = 1;
-int option_max_undo = 32768;
+/* Size limit of undo and redo journals, in bytes (it used to be a number of actions).
+   Deleted text is stored in the journal as is, one byte per byte, so it also limits
+   the size of a block whose deletion can be undone. */
+int option_max_undo = 32 * 1024 * 1024;
+int option_filesize_threshold = DEFAULT_FILESIZE_THRESHOLD;
 int option_persistent_selections = 1;
 int option_cursor_beyond_eol = 0;
 int option_line_state = 0;
@@ -110,10 +114,18 @@ const char VERTICAL_MAGIC[] = { '\1', '\1', '\1', '\1', '\n' };
 
 /*** file scope macro definitions ****************************************************************/
 
-#define TEMP_BUF_LEN 1024
-
 #define space_width 1
 
+/* distance (in lines) between anchors of the line index */
+#define EDIT_LINE_INDEX_STEP 256
+
+/* undo journal records of deleted text: reinserted with edit_insert() or edit_insert_ahead() */
+#define TEXT_INSERT (-1)
+#define TEXT_INSERT_AHEAD (-2)
+
+/* compact undo journal if so many records are dropped from the bottom */
+#define UNDO_JOURNAL_COMPACT 1024
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -171,23 +183,78 @@ static off_t last_bracket = -1;
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * Initialize the buffers for an empty files.
+ * Get buffer with given index from the array of buffers, allocate it if needed.
+ * The array grows as needed, so size of file is limited by memory only.
  */
 
+static unsigned char *
+edit_buffer_alloc (GPtrArray * buffers, off_t index)
+{
+    if ((off_t) buffers->len <= index)
+        g_ptr_array_set_size (buffers, index + 1);
+
+    if (g_ptr_array_index (buffers, index) == NULL)
+        g_ptr_array_index (buffers, index) = g_malloc0 (EDIT_BUF_SIZE);
+
+    return EDIT_BUF (buffers, index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
-edit_init_buffers (WEdit * edit)
+edit_buffer_free (GPtrArray * buffers, off_t index)
+{
+    if (index < (off_t) buffers->len)
+    {
+        g_free (g_ptr_array_index (buffers, index));
+        g_ptr_array_index (buffers, index) = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_free_buffers (GPtrArray * buffers)
 {
-    int j;
+    if (buffers != NULL)
+    {
+        guint i;
 
-    for (j = 0; j <= MAXBUFF; j++)
+        for (i = 0; i < buffers->len; i++)
+            g_free (g_ptr_array_index (buffers, i));
+        g_ptr_array_free (buffers, TRUE);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_line_index_free (WEdit * edit)
+{
+    if (edit->line_index != NULL)
     {
-        edit->buffers1[j] = NULL;
-        edit->buffers2[j] = NULL;
+        g_array_free (edit->line_index, TRUE);
+        edit->line_index = NULL;
     }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize the buffers for an empty files.
+ */
+
+static void
+edit_init_buffers (WEdit * edit)
+{
+    edit_free_buffers (edit->buffers1);
+    edit_free_buffers (edit->buffers2);
+    edit->buffers1 = g_ptr_array_new ();
+    edit->buffers2 = g_ptr_array_new ();
+    edit_line_index_free (edit);
 
     edit->curs1 = 0;
     edit->curs2 = 0;
-    edit->buffers2[0] = g_malloc0 (EDIT_BUF_SIZE);
+    edit_buffer_alloc (edit->buffers2, 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -221,22 +288,17 @@ edit_load_file_fast (WEdit * edit, const vfs_path_t * filename_vpath)
         return FALSE;
     }
 
-    if (!edit->buffers2[buf2])
-        edit->buffers2[buf2] = g_malloc0 (EDIT_BUF_SIZE);
-
     do
     {
         if (mc_read (file,
-                     (char *) edit->buffers2[buf2] + EDIT_BUF_SIZE -
+                     (char *) edit_buffer_alloc (edit->buffers2, buf2) + EDIT_BUF_SIZE -
                      (edit->curs2 & M_EDIT_BUF_SIZE), edit->curs2 & M_EDIT_BUF_SIZE) < 0)
             break;
 
         for (buf = buf2 - 1; buf >= 0; buf--)
         {
-            /* edit->buffers2[0] is already allocated */
-            if (!edit->buffers2[buf])
-                edit->buffers2[buf] = g_malloc0 (EDIT_BUF_SIZE);
-            if (mc_read (file, (char *) edit->buffers2[buf], EDIT_BUF_SIZE) < 0)
+            if (mc_read (file, (char *) edit_buffer_alloc (edit->buffers2, buf), EDIT_BUF_SIZE) <
+                0)
                 break;
         }
         ret = TRUE;
@@ -310,13 +372,18 @@ edit_get_filter (const vfs_path_t * filename_vpath)
 static off_t
 edit_insert_stream (WEdit * edit, FILE * f)
 {
-    int c;
+    char *buf;
+    size_t len;
     off_t i = 0;
-    while ((c = fgetc (f)) >= 0)
+
+    buf = g_malloc (EDIT_BUF_SIZE);
+    while ((len = fread (buf, 1, EDIT_BUF_SIZE, f)) != 0)
     {
-        edit_insert (edit, c);
-        i++;
+        edit_insert_chunk (edit, buf, len);
+        i += len;
     }
+    g_free (buf);
+
     return i;
 }
 
@@ -388,15 +455,6 @@ check_file_access (WEdit * edit, const vfs_path_t * filename_vpath, struct stat
     if (st->st_size > 0)
         edit->delete_file = 0;
 
-    if (st->st_size >= SIZE_LIMIT)
-    {
-        char *filename;
-
-        filename = vfs_path_to_str (filename_vpath);
-        errmsg = g_strdup_printf (_("File \"%s\" is too large"), filename);
-        g_free (filename);
-    }
-
   cleanup:
     (void) mc_close (file);
 
@@ -406,6 +464,26 @@ check_file_access (WEdit * edit, const vfs_path_t * filename_vpath, struct stat
         g_free (errmsg);
         return FALSE;
     }
+
+    /* whole file is loaded into memory, so ask before opening a large one */
+    if (option_filesize_threshold > 0
+        && st->st_size >= (off_t) option_filesize_threshold * 1024 * 1024)
+    {
+        char *filename, *msg;
+        int answer;
+
+        filename = vfs_path_to_str (filename_vpath);
+        msg = g_strdup_printf (_("File \"%s\" is larger than %d MB\n"
+                                 "and will be loaded into memory entirely.\nOpen it anyway?"),
+                               filename, option_filesize_threshold);
+        g_free (filename);
+        answer = edit_query_dialog2 (_("Warning"), msg, _("&Yes"), _("&No"));
+        g_free (msg);
+
+        if (answer != 0)
+            return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -548,92 +626,202 @@ edit_purge_widget (WEdit * edit)
 
 /* --------------------------------------------------------------------------------------------- */
 
-/*
-   TODO: if the user undos until the stack bottom, and the stack has not wrapped,
-   then the file should be as it was when he loaded up. Then set edit->modified to 0.
+static void
+edit_journal_init (edit_undo_journal_t * j)
+{
+    j->records = g_array_new (FALSE, FALSE, sizeof (edit_undo_record_t));
+    j->text = g_string_new ("");
+    j->bottom = 0;
+    j->text_bottom = 0;
+    j->overflow = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_journal_free (edit_undo_journal_t * j)
+{
+    if (j->records != NULL)
+    {
+        g_array_free (j->records, TRUE);
+        j->records = NULL;
+    }
+    if (j->text != NULL)
+    {
+        g_string_free (j->text, TRUE);
+        j->text = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_journal_clear (edit_undo_journal_t * j)
+{
+    g_array_set_size (j->records, 0);
+    g_string_truncate (j->text, 0);
+    j->bottom = 0;
+    j->text_bottom = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Return memory used by records of the journal, in bytes */
+
+static gsize
+edit_journal_size (const edit_undo_journal_t * j)
+{
+    return (j->records->len - j->bottom) * sizeof (edit_undo_record_t)
+        + (j->text->len - j->text_bottom);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop the oldest key presses while the journal is over the size limit.
+ * If a single key press doesn't fit, it is dropped too and the rest of its actions
+ * aren't recorded.
  */
 
-static long
-edit_pop_undo_action (WEdit * edit)
+static void
+edit_journal_trim (edit_undo_journal_t * j)
 {
-    long c;
-    unsigned long sp = edit->undo_stack_pointer;
+    while (edit_journal_size (j) > (gsize) option_max_undo)
+    {
+        do
+        {
+            edit_undo_record_t *r;
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+            r = &g_array_index (j->records, edit_undo_record_t, j->bottom);
+            if (r->action == TEXT_INSERT || r->action == TEXT_INSERT_AHEAD)
+                j->text_bottom += r->count;
+            j->bottom++;
+        }
+        while (j->bottom < j->records->len
+               && g_array_index (j->records, edit_undo_record_t, j->bottom).action != KEY_PRESS);
+
+        if (j->bottom == j->records->len)
+        {
+            edit_journal_clear (j);
+            j->overflow = TRUE;
+            return;
+        }
+    }
 
-    sp = (sp - 1) & edit->undo_stack_size_mask;
-    c = edit->undo_stack[sp];
-    if (c >= 0)
+    if (j->bottom >= UNDO_JOURNAL_COMPACT && j->bottom >= j->records->len / 2)
     {
-        /*      edit->undo_stack[sp] = '@'; */
-        edit->undo_stack_pointer = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
-        return c;
+        g_array_remove_range (j->records, 0, j->bottom);
+        g_string_erase (j->text, 0, j->text_bottom);
+        j->bottom = 0;
+        j->text_bottom = 0;
     }
+}
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record an action into the journal.
+ * Deleted chars are collected into spans of text, repeated actions are counted.
+ */
 
-    c = edit->undo_stack[(sp - 1) & edit->undo_stack_size_mask];
-    if (edit->undo_stack[sp] == -2)
+static void
+edit_journal_push (edit_undo_journal_t * j, long action, off_t offset)
+{
+    edit_undo_record_t *top = NULL;
+    edit_undo_record_t r;
+
+    if (action == KEY_PRESS)
+        j->overflow = FALSE;
+    else if (j->overflow)
+        return;
+
+    if (j->records->len > j->bottom)
+        top = &g_array_index (j->records, edit_undo_record_t, j->records->len - 1);
+
+    if (action >= 0 && action < 512)
+    {
+        /* deleted char */
+        g_string_append_c (j->text, (char) (action & 0xff));
+        action = action < 256 ? TEXT_INSERT : TEXT_INSERT_AHEAD;
+        offset = 0;
+    }
+
+    if (top != NULL && top->action == action && top->offset == offset)
     {
-        /*      edit->undo_stack[sp] = '@'; */
-        edit->undo_stack_pointer = sp;
+        /* no need to push multiple do-nothings */
+        if (action < MARK_1)
+            top->count++;
     }
     else
-        edit->undo_stack[sp]++;
+    {
+        r.action = action;
+        r.offset = offset;
+        r.count = 1;
+        g_array_append_val (j->records, r);
+    }
 
-    return c;
+    edit_journal_trim (j);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take the last action from the journal.
+ *
+ * @param offset position for MARK_1, MARK_2, MARK_CURS and KEY_PRESS actions
+ * @return action as it was pushed to the journal or STACK_BOTTOM
+ */
+
 static long
-edit_pop_redo_action (WEdit * edit)
+edit_journal_pop (edit_undo_journal_t * j, off_t * offset)
 {
+    edit_undo_record_t *r;
     long c;
-    unsigned long sp = edit->redo_stack_pointer;
 
-    if (sp == edit->redo_stack_bottom)
+    *offset = 0;
+
+    if (j->records->len == j->bottom)
         return STACK_BOTTOM;
 
-    sp = (sp - 1) & edit->redo_stack_size_mask;
-    c = edit->redo_stack[sp];
-    if (c >= 0)
+    r = &g_array_index (j->records, edit_undo_record_t, j->records->len - 1);
+
+    if (r->action == TEXT_INSERT || r->action == TEXT_INSERT_AHEAD)
     {
-        edit->redo_stack_pointer = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
-        return c;
+        c = (unsigned char) j->text->str[j->text->len - 1];
+        if (r->action == TEXT_INSERT_AHEAD)
+            c += 256;
+        g_string_truncate (j->text, j->text->len - 1);
     }
-
-    if (sp == edit->redo_stack_bottom)
-        return STACK_BOTTOM;
-
-    c = edit->redo_stack[(sp - 1) & edit->redo_stack_size_mask];
-    if (edit->redo_stack[sp] == -2)
-        edit->redo_stack_pointer = sp;
     else
-        edit->redo_stack[sp]++;
+    {
+        c = r->action;
+        *offset = r->offset;
+    }
+
+    if (--r->count == 0)
+        g_array_set_size (j->records, j->records->len - 1);
 
     return c;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Return the last action of the journal without taking it */
+
 static long
-get_prev_undo_action (WEdit * edit)
+edit_journal_peek (const edit_undo_journal_t * j, off_t * offset)
 {
-    long c;
-    unsigned long sp = edit->undo_stack_pointer;
+    const edit_undo_record_t *r;
+
+    *offset = 0;
 
-    if (sp == edit->undo_stack_bottom)
+    if (j->records->len == j->bottom)
         return STACK_BOTTOM;
 
-    sp = (sp - 1) & edit->undo_stack_size_mask;
-    c = edit->undo_stack[sp];
-    if (c >= 0)
-        return c;
+    r = &g_array_index (j->records, edit_undo_record_t, j->records->len - 1);
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+    if (r->action == TEXT_INSERT)
+        return (unsigned char) j->text->str[j->text->len - 1];
+    if (r->action == TEXT_INSERT_AHEAD)
+        return (unsigned char) j->text->str[j->text->len - 1] + 256;
 
-    c = edit->undo_stack[(sp - 1) & edit->undo_stack_size_mask];
-    return c;
+    *offset = r->offset;
+    return r->action;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -642,8 +830,6 @@ get_prev_undo_action (WEdit * edit)
 static void
 edit_modification (WEdit * edit)
 {
-    edit->caches_valid = FALSE;
-
     /* raise lock when file modified */
     if (!edit->modified && !edit->delete_file)
         edit->locked = lock_file (edit->filename_vpath);
@@ -664,11 +850,11 @@ edit_get_byte_ptr (const WEdit * edit, off_t byte_index)
         off_t p;
 
         p = edit->curs1 + edit->curs2 - byte_index - 1;
-        return (char *) (edit->buffers2[p >> S_EDIT_BUF_SIZE] +
+        return (char *) (EDIT_BUF (edit->buffers2, p >> S_EDIT_BUF_SIZE) +
                          (EDIT_BUF_SIZE - (p & M_EDIT_BUF_SIZE) - 1));
     }
 
-    return (char *) (edit->buffers1[byte_index >> S_EDIT_BUF_SIZE] +
+    return (char *) (EDIT_BUF (edit->buffers1, byte_index >> S_EDIT_BUF_SIZE) +
                      (byte_index & M_EDIT_BUF_SIZE));
 }
 #endif
@@ -769,55 +955,204 @@ is_blank (const WEdit * edit, off_t offset)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** returns the offset of line i */
+/**
+ * Skip forward up to 'lines' newlines starting from 'current'.
+ *
+ * @param lines number of lines to skip, on return contains number of lines which were not
+ *              skipped because text is over
+ * @return offset of start of the last reached line
+ */
 
 static off_t
-edit_find_line (WEdit * edit, long line)
+edit_forward_lines (const WEdit * edit, off_t current, long *lines)
+{
+    off_t pos = current;
+
+    while (*lines > 0)
+    {
+        const char *chunk, *p, *nl;
+        off_t len;
+
+        chunk = edit_get_chunk (edit, pos, &len);
+        if (chunk == NULL)
+            break;
+
+        for (p = chunk; *lines > 0 && (nl = memchr (p, '\n', chunk + len - p)) != NULL; p = nl + 1)
+        {
+            (*lines)--;
+            current = pos + (nl + 1 - chunk);
+        }
+
+        pos += len;
+    }
+
+    return current;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_line_anchor_t
+edit_line_index_get (const WEdit * edit, guint i)
+{
+    edit_line_anchor_t a;
+
+    a = g_array_index (edit->line_index, edit_line_anchor_t, i);
+    if (i >= edit->line_index_dirty)
+    {
+        a.line += edit->line_index_dline;
+        a.offset += edit->line_index_doffset;
+    }
+
+    return a;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Apply pending shift to the anchors of line index */
+
+static void
+edit_line_index_flush (WEdit * edit)
+{
+    guint i;
+
+    for (i = edit->line_index_dirty; i < edit->line_index->len; i++)
+    {
+        edit_line_anchor_t *a;
+
+        a = &g_array_index (edit->line_index, edit_line_anchor_t, i);
+        a->line += edit->line_index_dline;
+        a->offset += edit->line_index_doffset;
+    }
+
+    edit->line_index_dirty = G_MAXUINT;
+    edit->line_index_dline = 0;
+    edit->line_index_doffset = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Return index of first anchor located after offset */
+
+static guint
+edit_line_index_after (const WEdit * edit, off_t offset)
+{
+    guint lo = 0, hi = edit->line_index->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (edit_line_index_get (edit, mid).offset <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Shift anchors located after the offset.
+ * The shift of anchors is accumulated while edits are made in front of the same anchor,
+ * so typing or pasting a block doesn't touch whole index on every byte.
+ */
+
+static void
+edit_line_index_shift (WEdit * edit, guint i, off_t doffset, long dline)
+{
+    if (i >= edit->line_index->len)
+        return;
+
+    if (i != edit->line_index_dirty)
+    {
+        edit_line_index_flush (edit);
+        edit->line_index_dirty = i;
+    }
+
+    edit->line_index_doffset += doffset;
+    edit->line_index_dline += dline;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Update line index after one byte was inserted to or removed from the position */
+
+static void
+edit_line_index_update (WEdit * edit, off_t offset, int c, gboolean insert)
 {
-    long i, j = 0;
-    long m = 2000000000;        /* what is the magic number? */
+    guint i;
+
+    if (edit->line_index == NULL)
+        return;
 
-    if (!edit->caches_valid)
+    i = edit_line_index_after (edit, offset);
+
+    /* line that starts after removed newline is joined to previous one */
+    if (!insert && c == '\n' && i < edit->line_index->len
+        && edit_line_index_get (edit, i).offset == offset + 1)
     {
-        memset (edit->line_numbers, 0, sizeof (edit->line_numbers));
-        memset (edit->line_offsets, 0, sizeof (edit->line_offsets));
-        /* three offsets that we *know* are line 0 at 0 and these two: */
-        edit->line_numbers[1] = edit->curs_line;
-        edit->line_offsets[1] = edit_bol (edit, edit->curs1);
-        edit->line_numbers[2] = edit->total_lines;
-        edit->line_offsets[2] = edit_bol (edit, edit->last_byte);
-        edit->caches_valid = TRUE;
+        edit_line_index_flush (edit);
+        g_array_remove_index (edit->line_index, i);
     }
+
+    if (insert)
+        edit_line_index_shift (edit, i, 1, c == '\n' ? 1 : 0);
+    else
+        edit_line_index_shift (edit, i, -1, c == '\n' ? -1 : 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** returns the offset of line i */
+
+static off_t
+edit_find_line (WEdit * edit, long line)
+{
+    edit_line_anchor_t a;
+    guint lo, hi;
+    long n;
+
     if (line >= edit->total_lines)
-        return edit->line_offsets[2];
+        return edit_bol (edit, edit->last_byte);
     if (line <= 0)
         return 0;
-    /* find the closest known point */
-    for (i = 0; i < N_LINE_CACHES; i++)
+
+    if (edit->line_index == NULL)
+    {
+        edit->line_index = g_array_new (FALSE, FALSE, sizeof (edit_line_anchor_t));
+        a.line = 0;
+        a.offset = 0;
+        g_array_append_val (edit->line_index, a);
+        edit->line_index_dirty = G_MAXUINT;
+        edit->line_index_dline = 0;
+        edit->line_index_doffset = 0;
+    }
+
+    /* find last known line before the requested one: first anchor is always line 0 */
+    for (lo = 0, hi = edit->line_index->len; hi - lo > 1;)
     {
-        long n;
+        guint mid = lo + (hi - lo) / 2;
 
-        n = abs (edit->line_numbers[i] - line);
-        if (n < m)
-        {
-            m = n;
-            j = i;
-        }
+        if (edit_line_index_get (edit, mid).line <= line)
+            lo = mid;
+        else
+            hi = mid;
     }
-    if (m == 0)
-        return edit->line_offsets[j];   /* know the offset exactly */
-    if (m == 1 && j >= 3)
-        i = j;                  /* one line different - caller might be looping, so stay in this cache */
-    else
-        i = 3 + (rand () % (N_LINE_CACHES - 3));
-    if (line > edit->line_numbers[j])
-        edit->line_offsets[i] =
-            edit_move_forward (edit, edit->line_offsets[j], line - edit->line_numbers[j], 0);
-    else
-        edit->line_offsets[i] =
-            edit_move_backward (edit, edit->line_offsets[j], edit->line_numbers[j] - line);
-    edit->line_numbers[i] = line;
-    return edit->line_offsets[i];
+
+    a = edit_line_index_get (edit, lo);
+
+    /* add missing anchors on the way */
+    while (line - a.line >= EDIT_LINE_INDEX_STEP)
+    {
+        n = EDIT_LINE_INDEX_STEP;
+        a.offset = edit_forward_lines (edit, a.offset, &n);
+        if (n != 0)
+            return a.offset;
+        a.line += EDIT_LINE_INDEX_STEP;
+
+        edit_line_index_flush (edit);
+        g_array_insert_val (edit->line_index, ++lo, a);
+    }
+
+    n = line - a.line;
+    return edit_forward_lines (edit, a.offset, &n);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1171,9 +1506,13 @@ edit_move_updown (WEdit * edit, long lines, gboolean do_scroll, gboolean directi
         else
             edit_scroll_downward (edit, lines);
     }
-    p = edit_bol (edit, edit->curs1);
-
-    p = direction ? edit_move_backward (edit, p, lines) : edit_move_forward (edit, p, lines, 0);
+    if (lines > EDIT_LINE_INDEX_STEP)
+        p = edit_find_line (edit, direction ? edit->curs_line - lines : edit->curs_line + lines);
+    else
+    {
+        p = edit_bol (edit, edit->curs1);
+        p = direction ? edit_move_backward (edit, p, lines) : edit_move_forward (edit, p, lines, 0);
+    }
 
     edit_cursor_move (edit, p - edit->curs1);
 
@@ -1240,11 +1579,12 @@ static void
 edit_do_undo (WEdit * edit)
 {
     long ac;
+    off_t offset;
     long count = 0;
 
     edit->undo_stack_disable = 1;       /* don't record undo's onto undo stack! */
     edit->over_col = 0;
-    while ((ac = edit_pop_undo_action (edit)) < KEY_PRESS)
+    while ((ac = edit_journal_pop (&edit->undo_journal, &offset)) < KEY_PRESS)
     {
         switch ((int) ac)
         {
@@ -1270,43 +1610,40 @@ edit_do_undo (WEdit * edit)
         case COLUMN_OFF:
             edit->column_highlight = 0;
             break;
+        case MARK_1:
+            edit->mark1 = offset;
+            edit->column1 =
+                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark1), 0, edit->mark1);
+            break;
+        case MARK_2:
+            edit->mark2 = offset;
+            edit->column2 =
+                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark2), 0, edit->mark2);
+            break;
+        case MARK_CURS:
+            edit->end_mark_curs = offset;
+            break;
         }
         if (ac >= 256 && ac < 512)
             edit_insert_ahead (edit, ac - 256);
         if (ac >= 0 && ac < 256)
             edit_insert (edit, ac);
 
-        if (ac >= MARK_1 - 2 && ac < MARK_2 - 2)
-        {
-            edit->mark1 = ac - MARK_1;
-            edit->column1 =
-                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark1), 0, edit->mark1);
-        }
-        if (ac >= MARK_2 - 2 && ac < MARK_CURS - 2)
-        {
-            edit->mark2 = ac - MARK_2;
-            edit->column2 =
-                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark2), 0, edit->mark2);
-        }
-        else if (ac >= MARK_CURS - 2 && ac < KEY_PRESS)
-        {
-            edit->end_mark_curs = ac - MARK_CURS;
-        }
         if (count++)
             edit->force |= REDRAW_PAGE; /* more than one pop usually means something big */
     }
 
-    if (edit->start_display > ac - KEY_PRESS)
+    if (edit->start_display > offset)
     {
-        edit->start_line -= edit_count_lines (edit, ac - KEY_PRESS, edit->start_display);
+        edit->start_line -= edit_count_lines (edit, offset, edit->start_display);
         edit->force |= REDRAW_PAGE;
     }
-    else if (edit->start_display < ac - KEY_PRESS)
+    else if (edit->start_display < offset)
     {
-        edit->start_line += edit_count_lines (edit, edit->start_display, ac - KEY_PRESS);
+        edit->start_line += edit_count_lines (edit, edit->start_display, offset);
         edit->force |= REDRAW_PAGE;
     }
-    edit->start_display = ac - KEY_PRESS;       /* see push and pop above */
+    edit->start_display = offset;       /* see push and pop above */
     edit_update_curs_row (edit);
 
   done_undo:
@@ -1319,13 +1656,14 @@ static void
 edit_do_redo (WEdit * edit)
 {
     long ac;
+    off_t offset;
     long count = 0;
 
     if (edit->redo_stack_reset)
         return;
 
     edit->over_col = 0;
-    while ((ac = edit_pop_redo_action (edit)) < KEY_PRESS)
+    while ((ac = edit_journal_pop (&edit->redo_journal, &offset)) < KEY_PRESS)
     {
         switch ((int) ac)
         {
@@ -1349,40 +1687,41 @@ edit_do_redo (WEdit * edit)
         case COLUMN_OFF:
             edit->column_highlight = 0;
             break;
+        case MARK_1:
+            edit->mark1 = offset;
+            edit->column1 =
+                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark1), 0, edit->mark1);
+            break;
+        case MARK_2:
+            edit->mark2 = offset;
+            edit->column2 =
+                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark2), 0, edit->mark2);
+            break;
+        case MARK_CURS:
+            edit->end_mark_curs = offset;
+            break;
         }
         if (ac >= 256 && ac < 512)
             edit_insert_ahead (edit, ac - 256);
         if (ac >= 0 && ac < 256)
             edit_insert (edit, ac);
 
-        if (ac >= MARK_1 - 2 && ac < MARK_2 - 2)
-        {
-            edit->mark1 = ac - MARK_1;
-            edit->column1 =
-                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark1), 0, edit->mark1);
-        }
-        else if (ac >= MARK_2 - 2 && ac < KEY_PRESS)
-        {
-            edit->mark2 = ac - MARK_2;
-            edit->column2 =
-                (long) edit_move_forward3 (edit, edit_bol (edit, edit->mark2), 0, edit->mark2);
-        }
         /* more than one pop usually means something big */
         if (count++)
             edit->force |= REDRAW_PAGE;
     }
 
-    if (edit->start_display > ac - KEY_PRESS)
+    if (edit->start_display > offset)
     {
-        edit->start_line -= edit_count_lines (edit, ac - KEY_PRESS, edit->start_display);
+        edit->start_line -= edit_count_lines (edit, offset, edit->start_display);
         edit->force |= REDRAW_PAGE;
     }
-    else if (edit->start_display < ac - KEY_PRESS)
+    else if (edit->start_display < offset)
     {
-        edit->start_line += edit_count_lines (edit, edit->start_display, ac - KEY_PRESS);
+        edit->start_line += edit_count_lines (edit, edit->start_display, offset);
         edit->force |= REDRAW_PAGE;
     }
-    edit->start_display = ac - KEY_PRESS;       /* see push and pop above */
+    edit->start_display = offset;       /* see push and pop above */
     edit_update_curs_row (edit);
 
   done_redo:
@@ -1396,11 +1735,14 @@ edit_group_undo (WEdit * edit)
 {
     long ac = KEY_PRESS;
     long cur_ac = KEY_PRESS;
-    while (ac != STACK_BOTTOM && ac == cur_ac)
+    off_t offset = 0;
+    off_t cur_offset = 0;
+
+    while (ac != STACK_BOTTOM && ac == cur_ac && offset == cur_offset)
     {
-        cur_ac = get_prev_undo_action (edit);
+        cur_ac = edit_journal_peek (&edit->undo_journal, &cur_offset);
         edit_do_undo (edit);
-        ac = get_prev_undo_action (edit);
+        ac = edit_journal_peek (&edit->undo_journal, &offset);
         /* exit from cycle if option_group_undo is not set,
          * and make single UNDO operation
          */
@@ -1827,10 +2169,47 @@ edit_get_byte (const WEdit * edit, off_t byte_index)
     if (byte_index >= edit->curs1)
     {
         p = edit->curs1 + edit->curs2 - byte_index - 1;
-        return edit->buffers2[p >> S_EDIT_BUF_SIZE][EDIT_BUF_SIZE - (p & M_EDIT_BUF_SIZE) - 1];
+        return EDIT_BUF (edit->buffers2, p >> S_EDIT_BUF_SIZE)[EDIT_BUF_SIZE -
+                                                               (p & M_EDIT_BUF_SIZE) - 1];
+    }
+
+    return EDIT_BUF (edit->buffers1, byte_index >> S_EDIT_BUF_SIZE)[byte_index & M_EDIT_BUF_SIZE];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get contiguous chunk of text stored in the edit buffers.
+ *
+ * @param edit editor object
+ * @param byte_index offset of the first byte of chunk
+ * @param len length of chunk
+ *
+ * @return pointer to the byte at byte_index, NULL if byte_index is out of text
+ */
+
+const char *
+edit_get_chunk (const WEdit * edit, off_t byte_index, off_t * len)
+{
+    if (byte_index >= (edit->curs1 + edit->curs2) || byte_index < 0)
+    {
+        *len = 0;
+        return NULL;
+    }
+
+    if (byte_index >= edit->curs1)
+    {
+        off_t p;
+
+        /* buffers2 are filled backwards, but text inside each buffer goes forwards */
+        p = edit->curs1 + edit->curs2 - byte_index - 1;
+        *len = (p & M_EDIT_BUF_SIZE) + 1;
+        return (const char *) (EDIT_BUF (edit->buffers2, p >> S_EDIT_BUF_SIZE) +
+                               (EDIT_BUF_SIZE - (p & M_EDIT_BUF_SIZE) - 1));
     }
 
-    return edit->buffers1[byte_index >> S_EDIT_BUF_SIZE][byte_index & M_EDIT_BUF_SIZE];
+    *len = MIN (EDIT_BUF_SIZE - (byte_index & M_EDIT_BUF_SIZE), edit->curs1 - byte_index);
+    return (const char *) (EDIT_BUF (edit->buffers1, byte_index >> S_EDIT_BUF_SIZE) +
+                           (byte_index & M_EDIT_BUF_SIZE));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1928,92 +2307,97 @@ edit_get_write_filter (const vfs_path_t * write_name_vpath, const vfs_path_t * f
 off_t
 edit_write_stream (WEdit * edit, FILE * f)
 {
-    long i;
+    off_t i = 0;
 
-    if (edit->lb == LB_ASIS)
+    while (i < edit->last_byte)
     {
-        for (i = 0; i < edit->last_byte; i++)
-            if (fputc (edit_get_byte (edit, i), f) < 0)
-                break;
-        return i;
-    }
+        const char *chunk;
+        off_t len, n;
+        unsigned char c, c1;
 
-    /* change line breaks */
-    for (i = 0; i < edit->last_byte; i++)
-    {
-        unsigned char c = edit_get_byte (edit, i);
+        chunk = edit_get_chunk (edit, i, &len);
 
-        if (!(c == '\n' || c == '\r'))
+        if (edit->lb == LB_ASIS)
+            n = len;
+        else
+            for (n = 0; n < len && chunk[n] != '\n' && chunk[n] != '\r'; n++)
+                ;
+
+        /* write span without line breaks at once */
+        if (n != 0)
         {
-            /* not line break */
-            if (fputc (c, f) < 0)
+            if (fwrite (chunk, 1, n, f) != (size_t) n)
                 return i;
+            i += n;
+            continue;
         }
-        else
-        {                       /* (c == '\n' || c == '\r') */
-            unsigned char c1 = edit_get_byte (edit, i + 1);     /* next char */
 
-            switch (edit->lb)
-            {
-            case LB_UNIX:      /* replace "\r\n" or '\r' to '\n' */
-                /* put one line break unconditionally */
-                if (fputc ('\n', f) < 0)
-                    return i;
+        /* change line breaks */
+        c = (unsigned char) chunk[0];
+        c1 = edit_get_byte (edit, i + 1);       /* next char */
 
-                i++;            /* 2 chars are processed */
+        switch (edit->lb)
+        {
+        case LB_UNIX:          /* replace "\r\n" or '\r' to '\n' */
+            /* put one line break unconditionally */
+            if (fputc ('\n', f) < 0)
+                return i;
 
-                if (c == '\r' && c1 == '\n')
-                    /* Windows line break; go to the next char */
-                    break;
+            i++;                /* 2 chars are processed */
 
-                if (c == '\r' && c1 == '\r')
-                {
-                    /* two Macintosh line breaks; put second line break */
-                    if (fputc ('\n', f) < 0)
-                        return i;
-                    break;
-                }
+            if (c == '\r' && c1 == '\n')
+                /* Windows line break; go to the next char */
+                break;
 
-                if (fputc (c1, f) < 0)
+            if (c == '\r' && c1 == '\r')
+            {
+                /* two Macintosh line breaks; put second line break */
+                if (fputc ('\n', f) < 0)
                     return i;
                 break;
+            }
 
-            case LB_WIN:       /* replace '\n' or '\r' to "\r\n" */
-                /* put one line break unconditionally */
-                if (fputc ('\r', f) < 0 || fputc ('\n', f) < 0)
-                    return i;
+            if (fputc (c1, f) < 0)
+                return i;
+            break;
 
-                if (c == '\r' && c1 == '\n')
-                    /* Windows line break; go to the next char */
-                    i++;
-                break;
+        case LB_WIN:           /* replace '\n' or '\r' to "\r\n" */
+            /* put one line break unconditionally */
+            if (fputc ('\r', f) < 0 || fputc ('\n', f) < 0)
+                return i;
 
-            case LB_MAC:       /* replace "\r\n" or '\n' to '\r' */
-                /* put one line break unconditionally */
-                if (fputc ('\r', f) < 0)
-                    return i;
+            if (c == '\r' && c1 == '\n')
+                /* Windows line break; go to the next char */
+                i++;
+            break;
 
-                i++;            /* 2 chars are processed */
+        case LB_MAC:           /* replace "\r\n" or '\n' to '\r' */
+            /* put one line break unconditionally */
+            if (fputc ('\r', f) < 0)
+                return i;
 
-                if (c == '\r' && c1 == '\n')
-                    /* Windows line break; go to the next char */
-                    break;
+            i++;                /* 2 chars are processed */
 
-                if (c == '\n' && c1 == '\n')
-                {
-                    /* two Windows line breaks; put second line break */
-                    if (fputc ('\r', f) < 0)
-                        return i;
-                    break;
-                }
+            if (c == '\r' && c1 == '\n')
+                /* Windows line break; go to the next char */
+                break;
 
-                if (fputc (c1, f) < 0)
+            if (c == '\n' && c1 == '\n')
+            {
+                /* two Windows line breaks; put second line break */
+                if (fputc ('\r', f) < 0)
                     return i;
                 break;
-            case LB_ASIS:      /* default without changes */
-                break;
             }
+
+            if (fputc (c1, f) < 0)
+                return i;
+            break;
+        case LB_ASIS:          /* default without changes */
+            break;
         }
+
+        i++;
     }
 
     return edit->last_byte;
@@ -2124,7 +2508,7 @@ edit_insert_file (WEdit * edit, const vfs_path_t * filename_vpath)
         if (file == -1)
             return -1;
 
-        buf = g_malloc0 (TEMP_BUF_LEN);
+        buf = g_malloc0 (EDIT_BUF_SIZE);
         blocklen = mc_read (file, buf, sizeof (VERTICAL_MAGIC));
         if (blocklen > 0)
         {
@@ -2153,13 +2537,8 @@ edit_insert_file (WEdit * edit, const vfs_path_t * filename_vpath)
         }
         else
         {
-            off_t i;
-
-            while ((blocklen = mc_read (file, (char *) buf, TEMP_BUF_LEN)) > 0)
-            {
-                for (i = 0; i < blocklen; i++)
-                    edit_insert (edit, buf[i]);
-            }
+            while ((blocklen = mc_read (file, buf, EDIT_BUF_SIZE)) > 0)
+                edit_insert_chunk (edit, buf, blocklen);
             /* highlight inserted text then not persistent blocks */
             if (!option_persistent_selections && edit->modified)
             {
@@ -2274,13 +2653,8 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
     /* set file name before load file */
     edit_set_filename (edit, filename_vpath);
 
-    edit->undo_stack_size = START_STACK_SIZE;
-    edit->undo_stack_size_mask = START_STACK_SIZE - 1;
-    edit->undo_stack = g_malloc0 ((edit->undo_stack_size + 10) * sizeof (long));
-
-    edit->redo_stack_size = START_STACK_SIZE;
-    edit->redo_stack_size_mask = START_STACK_SIZE - 1;
-    edit->redo_stack = g_malloc0 ((edit->redo_stack_size + 10) * sizeof (long));
+    edit_journal_init (&edit->undo_journal);
+    edit_journal_init (&edit->redo_journal);
 
 #ifdef HAVE_CHARSET
     edit->utf8 = FALSE;
@@ -2324,8 +2698,6 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
 gboolean
 edit_clean (WEdit * edit)
 {
-    int j = 0;
-
     if (edit == NULL)
         return FALSE;
 
@@ -2345,14 +2717,14 @@ edit_clean (WEdit * edit)
 
     edit_free_syntax_rules (edit);
     book_mark_flush (edit, -1);
-    for (; j <= MAXBUFF; j++)
-    {
-        g_free (edit->buffers1[j]);
-        g_free (edit->buffers2[j]);
-    }
-
-    g_free (edit->undo_stack);
-    g_free (edit->redo_stack);
+    edit_free_buffers (edit->buffers1);
+    edit_free_buffers (edit->buffers2);
+    edit->buffers1 = NULL;
+    edit->buffers2 = NULL;
+    edit_line_index_free (edit);
+
+    edit_journal_free (&edit->undo_journal);
+    edit_journal_free (&edit->redo_journal);
     vfs_path_free (edit->filename_vpath);
     vfs_path_free (edit->dir_vpath);
     mc_search_free (edit->search);
@@ -2438,214 +2810,74 @@ edit_set_codeset (WEdit * edit)
 /* --------------------------------------------------------------------------------------------- */
 
 /**
- * Recording stack for undo:
- * The following is an implementation of a compressed stack. Identical
- * pushes are recorded by a negative prefix indicating the number of times the
- * same char was pushed. This saves space for repeated curs-left or curs-right
- * delete etc.
- *
- * eg:
- *
- * pushed:       stored:
- *
- * a
- * b             a
- * b            -3
- * b             b
- * c  -->       -4
- * c             c
- * c             d
- * c
- * d
+ * Recording journal for undo:
+ * Each record of the journal is an action which reverts a change of the text or cursor.
+ * Identical pushes are counted in one record. This saves space for repeated
+ * curs-left or curs-right, typing etc. Chars removed by backspace or delete are
+ * collected into spans of text which are stored separately from records, so
+ * deletion of a large block costs one byte per deleted char.
  *
- * If the stack long int is 0-255 it represents a normal insert (from a backspace),
- * 256-512 is an insert ahead (from a delete), If it is betwen 600 and 700 it is one
- * of the cursor functions define'd in edit-impl.h. 1000 through 700'000'000 is to
- * set edit->mark1 position. 700'000'000 through 1400'000'000 is to set edit->mark2
- * position.
+ * The action code 0-255 represents a normal insert (from a backspace),
+ * 256-511 is an insert ahead (from a delete), If it is betwen 600 and 700 it is one
+ * of the cursor functions define'd in edit-impl.h. MARK_1, MARK_2 and MARK_CURS
+ * set edit->mark1, edit->mark2 and edit->end_mark_curs positions.
  *
  * The only way the cursor moves or the buffer is changed is through the routines:
  * insert, backspace, insert_ahead, delete, and cursor_move.
- * These record the reverse undo movements onto the stack each time they are
+ * These record the reverse undo movements into the journal each time they are
  * called.
  *
  * Each key press results in a set of actions (insert; delete ...). So each time
- * a key is pressed the current position of start_display is pushed as
- * KEY_PRESS + start_display. Then for undoing, we pop until we get to a number
- * over KEY_PRESS. We then assign this number less KEY_PRESS to start_display. So undo
- * tracks scrolling and key actions exactly. (KEY_PRESS is about (2^31) * (2/3) = 1400'000'000)
- *
+ * a key is pressed the KEY_PRESS action with the current position of start_display
+ * is pushed. Then for undoing, we pop until we get to KEY_PRESS. We then assign
+ * its position to start_display. So undo tracks scrolling and key actions exactly.
  *
+ * The size of journal is limited by option_max_undo bytes, the oldest key presses are
+ * dropped if it is exceeded.
  *
  * @param edit editor object
  * @param c code of the action
+ * @param offset position for MARK_1, MARK_2, MARK_CURS and KEY_PRESS actions
  */
 
 void
-edit_push_undo_action (WEdit * edit, long c)
+edit_push_undo_offset (WEdit * edit, long c, off_t offset)
 {
-    unsigned long sp = edit->undo_stack_pointer;
-    unsigned long spm1;
-    long *t;
-
-    /* first enlarge the stack if necessary */
-    if (sp > edit->undo_stack_size - 10)
-    {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->undo_stack_size < (unsigned long) option_max_undo)
-        {
-            t = g_realloc (edit->undo_stack, (edit->undo_stack_size * 2 + 10) * sizeof (long));
-            if (t)
-            {
-                edit->undo_stack = t;
-                edit->undo_stack_size <<= 1;
-                edit->undo_stack_size_mask = edit->undo_stack_size - 1;
-            }
-        }
-    }
-    spm1 = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
     if (edit->undo_stack_disable)
     {
-        edit_push_redo_action (edit, KEY_PRESS);
-        edit_push_redo_action (edit, c);
+        edit_push_redo_offset (edit, KEY_PRESS, 0);
+        edit_push_redo_offset (edit, c, offset);
         return;
     }
 
     if (edit->redo_stack_reset)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
-
-    if (edit->undo_stack_bottom != sp
-        && spm1 != edit->undo_stack_bottom
-        && ((sp - 2) & edit->undo_stack_size_mask) != edit->undo_stack_bottom)
-    {
-        int d;
-        if (edit->undo_stack[spm1] < 0)
-        {
-            d = edit->undo_stack[(sp - 2) & edit->undo_stack_size_mask];
-            if (d == c && edit->undo_stack[spm1] > -1000000000)
-            {
-                if (c < KEY_PRESS)      /* --> no need to push multiple do-nothings */
-                    edit->undo_stack[spm1]--;
-                return;
-            }
-        }
-        else
-        {
-            d = edit->undo_stack[spm1];
-            if (d == c)
-            {
-                if (c >= KEY_PRESS)
-                    return;     /* --> no need to push multiple do-nothings */
-                edit->undo_stack[sp] = -2;
-                goto check_bottom;
-            }
-        }
-    }
-    edit->undo_stack[sp] = c;
-
-  check_bottom:
-    edit->undo_stack_pointer = (edit->undo_stack_pointer + 1) & edit->undo_stack_size_mask;
-
-    /* if the sp wraps round and catches the undo_stack_bottom then erase
-     * the first set of actions on the stack to make space - by moving
-     * undo_stack_bottom forward one "key press" */
-    c = (edit->undo_stack_pointer + 2) & edit->undo_stack_size_mask;
-    if ((unsigned long) c == edit->undo_stack_bottom ||
-        (((unsigned long) c + 1) & edit->undo_stack_size_mask) == edit->undo_stack_bottom)
-        do
-        {
-            edit->undo_stack_bottom = (edit->undo_stack_bottom + 1) & edit->undo_stack_size_mask;
-        }
-        while (edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS
-               && edit->undo_stack_bottom != edit->undo_stack_pointer);
+        edit_journal_clear (&edit->redo_journal);
 
-    /*If a single key produced enough pushes to wrap all the way round then we would notice that the [undo_stack_bottom] does not contain KEY_PRESS. The stack is then initialised: */
-    if (edit->undo_stack_pointer != edit->undo_stack_bottom
-        && edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS)
-    {
-        edit->undo_stack_bottom = edit->undo_stack_pointer = 0;
-    }
+    edit_journal_push (&edit->undo_journal, c, offset);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
 void
-edit_push_redo_action (WEdit * edit, long c)
+edit_push_undo_action (WEdit * edit, long c)
 {
-    unsigned long sp = edit->redo_stack_pointer;
-    unsigned long spm1;
-    long *t;
-    /* first enlarge the stack if necessary */
-    if (sp > edit->redo_stack_size - 10)
-    {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->redo_stack_size < (unsigned long) option_max_undo)
-        {
-            t = g_realloc (edit->redo_stack, (edit->redo_stack_size * 2 + 10) * sizeof (long));
-            if (t)
-            {
-                edit->redo_stack = t;
-                edit->redo_stack_size <<= 1;
-                edit->redo_stack_size_mask = edit->redo_stack_size - 1;
-            }
-        }
-    }
-    spm1 = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
-
-    if (edit->redo_stack_bottom != sp
-        && spm1 != edit->redo_stack_bottom
-        && ((sp - 2) & edit->redo_stack_size_mask) != edit->redo_stack_bottom)
-    {
-        int d;
-        if (edit->redo_stack[spm1] < 0)
-        {
-            d = edit->redo_stack[(sp - 2) & edit->redo_stack_size_mask];
-            if (d == c && edit->redo_stack[spm1] > -1000000000)
-            {
-                if (c < KEY_PRESS)      /* --> no need to push multiple do-nothings */
-                    edit->redo_stack[spm1]--;
-                return;
-            }
-        }
-        else
-        {
-            d = edit->redo_stack[spm1];
-            if (d == c)
-            {
-                if (c >= KEY_PRESS)
-                    return;     /* --> no need to push multiple do-nothings */
-                edit->redo_stack[sp] = -2;
-                goto redo_check_bottom;
-            }
-        }
-    }
-    edit->redo_stack[sp] = c;
+    edit_push_undo_offset (edit, c, 0);
+}
 
-  redo_check_bottom:
-    edit->redo_stack_pointer = (edit->redo_stack_pointer + 1) & edit->redo_stack_size_mask;
+/* --------------------------------------------------------------------------------------------- */
 
-    /* if the sp wraps round and catches the redo_stack_bottom then erase
-     * the first set of actions on the stack to make space - by moving
-     * redo_stack_bottom forward one "key press" */
-    c = (edit->redo_stack_pointer + 2) & edit->redo_stack_size_mask;
-    if ((unsigned long) c == edit->redo_stack_bottom ||
-        (((unsigned long) c + 1) & edit->redo_stack_size_mask) == edit->redo_stack_bottom)
-        do
-        {
-            edit->redo_stack_bottom = (edit->redo_stack_bottom + 1) & edit->redo_stack_size_mask;
-        }
-        while (edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS
-               && edit->redo_stack_bottom != edit->redo_stack_pointer);
+void
+edit_push_redo_offset (WEdit * edit, long c, off_t offset)
+{
+    edit_journal_push (&edit->redo_journal, c, offset);
+}
 
-    /*
-     * If a single key produced enough pushes to wrap all the way round then
-     * we would notice that the [redo_stack_bottom] does not contain KEY_PRESS.
-     * The stack is then initialised:
-     */
+/* --------------------------------------------------------------------------------------------- */
 
-    if (edit->redo_stack_pointer != edit->redo_stack_bottom
-        && edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
+void
+edit_push_redo_action (WEdit * edit, long c)
+{
+    edit_push_redo_offset (edit, c, 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2657,10 +2889,6 @@ edit_push_redo_action (WEdit * edit, long c)
 void
 edit_insert (WEdit * edit, int c)
 {
-    /* check if file has grown to large */
-    if (edit->last_byte >= SIZE_LIMIT)
-        return;
-
     /* first we must update the position of the display window */
     if (edit->curs1 < edit->start_display)
     {
@@ -2691,15 +2919,16 @@ edit_insert (WEdit * edit, int c)
     /* update markers */
     edit->mark1 += (edit->mark1 > edit->curs1);
     edit->mark2 += (edit->mark2 > edit->curs1);
-    edit->last_get_rule += (edit->last_get_rule > edit->curs1);
+    edit_syntax_change (edit, edit->curs1, 1);
 
     /* add a new buffer if we've reached the end of the last one */
     if (!(edit->curs1 & M_EDIT_BUF_SIZE))
-        edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE] = g_malloc0 (EDIT_BUF_SIZE);
+        edit_buffer_alloc (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE);
 
     /* perform the insertion */
-    edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE][edit->curs1 & M_EDIT_BUF_SIZE]
+    EDIT_BUF (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE)[edit->curs1 & M_EDIT_BUF_SIZE]
         = (unsigned char) c;
+    edit_line_index_update (edit, edit->curs1, c, TRUE);
 
     /* update file length */
     edit->last_byte++;
@@ -2709,14 +2938,82 @@ edit_insert (WEdit * edit, int c)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** same as edit_insert and move left */
+/**
+ * Insert block of text at the cursor, the same as edit_insert() for each byte,
+ * but text is copied by whole buffers and the block is undone by one action.
+ */
 
 void
-edit_insert_ahead (WEdit * edit, int c)
+edit_insert_chunk (WEdit * edit, const char *buf, size_t len)
 {
-    if (edit->last_byte >= SIZE_LIMIT)
+    const char *p, *nl;
+    long lines = 0;
+    off_t offset;
+
+    if (len == 0)
         return;
 
+    if (edit->loading_done)
+        edit_modification (edit);
+
+    for (p = buf; (nl = memchr (p, '\n', buf + len - p)) != NULL; p = nl + 1)
+    {
+        book_mark_inc (edit, edit->curs_line + lines);
+        lines++;
+    }
+
+    if (edit->curs1 < edit->start_display)
+    {
+        edit->start_display += len;
+        edit->start_line += lines;
+    }
+
+    if (lines != 0)
+    {
+        edit->curs_line += lines;
+        edit->total_lines += lines;
+        edit->force |= REDRAW_LINE_ABOVE | REDRAW_AFTER_CURSOR;
+    }
+
+    /* update markers */
+    if (edit->mark1 > edit->curs1)
+        edit->mark1 += len;
+    if (edit->mark2 > edit->curs1)
+        edit->mark2 += len;
+    edit_syntax_change (edit, edit->curs1, len);
+
+    if (edit->line_index != NULL)
+        edit_line_index_shift (edit, edit_line_index_after (edit, edit->curs1), len, lines);
+
+    for (offset = 0; offset < (off_t) len;)
+    {
+        off_t n, i;
+
+        /* add a new buffer if we've reached the end of the last one */
+        if (!(edit->curs1 & M_EDIT_BUF_SIZE))
+            edit_buffer_alloc (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE);
+
+        n = MIN (EDIT_BUF_SIZE - (edit->curs1 & M_EDIT_BUF_SIZE), (off_t) len - offset);
+        memcpy (EDIT_BUF (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE) +
+                (edit->curs1 & M_EDIT_BUF_SIZE), buf + offset, n);
+        edit->curs1 += n;
+        edit->last_byte += n;
+
+        /* the same undo actions as edit_insert() pushes, so group undo stops at the same
+           places; repeated actions are stored as one counted action */
+        for (i = 0; i < n; i++)
+            edit_push_undo_action (edit, (unsigned char) buf[offset + i] > 32 ? BACKSPACE
+                                   : BACKSPACE_BR);
+        offset += n;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** same as edit_insert and move left */
+
+void
+edit_insert_ahead (WEdit * edit, int c)
+{
     if (edit->curs1 < edit->start_display)
     {
         edit->start_display++;
@@ -2738,12 +3035,13 @@ edit_insert_ahead (WEdit * edit, int c)
 
     edit->mark1 += (edit->mark1 >= edit->curs1);
     edit->mark2 += (edit->mark2 >= edit->curs1);
-    edit->last_get_rule += (edit->last_get_rule >= edit->curs1);
+    edit_syntax_change (edit, edit->curs1, 1);
 
     if (!((edit->curs2 + 1) & M_EDIT_BUF_SIZE))
-        edit->buffers2[(edit->curs2 + 1) >> S_EDIT_BUF_SIZE] = g_malloc0 (EDIT_BUF_SIZE);
-    edit->buffers2[edit->curs2 >> S_EDIT_BUF_SIZE]
+        edit_buffer_alloc (edit->buffers2, (edit->curs2 + 1) >> S_EDIT_BUF_SIZE);
+    EDIT_BUF (edit->buffers2, edit->curs2 >> S_EDIT_BUF_SIZE)
         [EDIT_BUF_SIZE - (edit->curs2 & M_EDIT_BUF_SIZE) - 1] = c;
+    edit_line_index_update (edit, edit->curs1, c, TRUE);
 
     edit->last_byte++;
     edit->curs2++;
@@ -2777,6 +3075,8 @@ edit_delete (WEdit * edit, gboolean byte_delete)
     if (edit->mark2 != edit->mark1)
         edit_push_markers (edit);
 
+    edit_syntax_change (edit, edit->curs1, -cw);
+
     for (i = 1; i <= cw; i++)
     {
         if (edit->mark1 > edit->curs1)
@@ -2786,20 +3086,15 @@ edit_delete (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 > edit->curs1)
             edit->mark2--;
-        if (edit->last_get_rule > edit->curs1)
-            edit->last_get_rule--;
 
-        p = edit->buffers2[(edit->curs2 - 1) >> S_EDIT_BUF_SIZE][EDIT_BUF_SIZE -
-                                                                 ((edit->curs2 -
-                                                                   1) & M_EDIT_BUF_SIZE) - 1];
+        p = EDIT_BUF (edit->buffers2, (edit->curs2 - 1) >> S_EDIT_BUF_SIZE)
+            [EDIT_BUF_SIZE - ((edit->curs2 - 1) & M_EDIT_BUF_SIZE) - 1];
 
         if (!(edit->curs2 & M_EDIT_BUF_SIZE))
-        {
-            g_free (edit->buffers2[edit->curs2 >> S_EDIT_BUF_SIZE]);
-            edit->buffers2[edit->curs2 >> S_EDIT_BUF_SIZE] = NULL;
-        }
+            edit_buffer_free (edit->buffers2, edit->curs2 >> S_EDIT_BUF_SIZE);
         edit->last_byte--;
         edit->curs2--;
+        edit_line_index_update (edit, edit->curs1, p, FALSE);
         edit_push_undo_action (edit, p + 256);
     }
 
@@ -2820,6 +3115,70 @@ edit_delete (WEdit * edit, gboolean byte_delete)
     return p;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete len bytes after the cursor, the same as edit_delete() for each byte,
+ * but markers are saved to undo journal only once.
+ */
+
+void
+edit_delete_chunk (WEdit * edit, off_t len)
+{
+    long lines = 0;
+
+    len = min (len, edit->curs2);
+    if (len <= 0)
+        return;
+
+    if (edit->mark2 != edit->mark1)
+        edit_push_markers (edit);
+
+    edit_syntax_change (edit, edit->curs1, -len);
+
+    for (; len != 0; len--)
+    {
+        int p;
+
+        if (edit->mark1 > edit->curs1)
+        {
+            edit->mark1--;
+            edit->end_mark_curs--;
+        }
+        if (edit->mark2 > edit->curs1)
+            edit->mark2--;
+
+        p = EDIT_BUF (edit->buffers2, (edit->curs2 - 1) >> S_EDIT_BUF_SIZE)
+            [EDIT_BUF_SIZE - ((edit->curs2 - 1) & M_EDIT_BUF_SIZE) - 1];
+
+        if (!(edit->curs2 & M_EDIT_BUF_SIZE))
+            edit_buffer_free (edit->buffers2, edit->curs2 >> S_EDIT_BUF_SIZE);
+        edit->last_byte--;
+        edit->curs2--;
+        edit_line_index_update (edit, edit->curs1, p, FALSE);
+        edit_push_undo_action (edit, p + 256);
+
+        if (p == '\n')
+            lines++;
+        if (edit->curs1 < edit->start_display)
+        {
+            edit->start_display--;
+            if (p == '\n')
+                edit->start_line--;
+        }
+    }
+
+    edit_modification (edit);
+    if (lines != 0)
+    {
+        long i;
+
+        for (i = 0; i < lines; i++)
+            book_mark_dec (edit, edit->curs_line);
+        edit->total_lines -= lines;
+        edit->force |= REDRAW_AFTER_CURSOR;
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
@@ -2846,6 +3205,8 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
     (void) byte_delete;
 #endif
 
+    edit_syntax_change (edit, edit->curs1 - cw, -cw);
+
     for (i = 1; i <= cw; i++)
     {
         if (edit->mark1 >= edit->curs1)
@@ -2855,18 +3216,14 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 >= edit->curs1)
             edit->mark2--;
-        if (edit->last_get_rule >= edit->curs1)
-            edit->last_get_rule--;
 
-        p = *(edit->buffers1[(edit->curs1 - 1) >> S_EDIT_BUF_SIZE] +
-              ((edit->curs1 - 1) & M_EDIT_BUF_SIZE));
+        p = EDIT_BUF (edit->buffers1, (edit->curs1 - 1) >> S_EDIT_BUF_SIZE)
+            [(edit->curs1 - 1) & M_EDIT_BUF_SIZE];
         if (((edit->curs1 - 1) & M_EDIT_BUF_SIZE) == 0)
-        {
-            g_free (edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE]);
-            edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE] = NULL;
-        }
+            edit_buffer_free (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE);
         edit->last_byte--;
         edit->curs1--;
+        edit_line_index_update (edit, edit->curs1, p, FALSE);
         edit_push_undo_action (edit, p);
     }
     edit_modification (edit);
@@ -2908,17 +3265,14 @@ edit_cursor_move (WEdit * edit, off_t increment)
 
             c = edit_get_byte (edit, edit->curs1 - 1);
             if (!((edit->curs2 + 1) & M_EDIT_BUF_SIZE))
-                edit->buffers2[(edit->curs2 + 1) >> S_EDIT_BUF_SIZE] = g_malloc0 (EDIT_BUF_SIZE);
-            edit->buffers2[edit->curs2 >> S_EDIT_BUF_SIZE][EDIT_BUF_SIZE -
-                                                           (edit->curs2 & M_EDIT_BUF_SIZE) - 1] = c;
+                edit_buffer_alloc (edit->buffers2, (edit->curs2 + 1) >> S_EDIT_BUF_SIZE);
+            EDIT_BUF (edit->buffers2, edit->curs2 >> S_EDIT_BUF_SIZE)
+                [EDIT_BUF_SIZE - (edit->curs2 & M_EDIT_BUF_SIZE) - 1] = c;
             edit->curs2++;
-            c = edit->buffers1[(edit->curs1 - 1) >> S_EDIT_BUF_SIZE][(edit->curs1 -
-                                                                      1) & M_EDIT_BUF_SIZE];
+            c = EDIT_BUF (edit->buffers1, (edit->curs1 - 1) >> S_EDIT_BUF_SIZE)
+                [(edit->curs1 - 1) & M_EDIT_BUF_SIZE];
             if (!((edit->curs1 - 1) & M_EDIT_BUF_SIZE))
-            {
-                g_free (edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE]);
-                edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE] = NULL;
-            }
+                edit_buffer_free (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE);
             edit->curs1--;
             if (c == '\n')
             {
@@ -2939,17 +3293,14 @@ edit_cursor_move (WEdit * edit, off_t increment)
 
             c = edit_get_byte (edit, edit->curs1);
             if (!(edit->curs1 & M_EDIT_BUF_SIZE))
-                edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE] = g_malloc0 (EDIT_BUF_SIZE);
-            edit->buffers1[edit->curs1 >> S_EDIT_BUF_SIZE][edit->curs1 & M_EDIT_BUF_SIZE] = c;
+                edit_buffer_alloc (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE);
+            EDIT_BUF (edit->buffers1, edit->curs1 >> S_EDIT_BUF_SIZE)
+                [edit->curs1 & M_EDIT_BUF_SIZE] = c;
             edit->curs1++;
-            c = edit->buffers2[(edit->curs2 - 1) >> S_EDIT_BUF_SIZE][EDIT_BUF_SIZE -
-                                                                     ((edit->curs2 -
-                                                                       1) & M_EDIT_BUF_SIZE) - 1];
+            c = EDIT_BUF (edit->buffers2, (edit->curs2 - 1) >> S_EDIT_BUF_SIZE)
+                [EDIT_BUF_SIZE - ((edit->curs2 - 1) & M_EDIT_BUF_SIZE) - 1];
             if (!(edit->curs2 & M_EDIT_BUF_SIZE))
-            {
-                g_free (edit->buffers2[edit->curs2 >> S_EDIT_BUF_SIZE]);
-                edit->buffers2[edit->curs2 >> S_EDIT_BUF_SIZE] = 0;
-            }
+                edit_buffer_free (edit->buffers2, edit->curs2 >> S_EDIT_BUF_SIZE);
             edit->curs2--;
             if (c == '\n')
             {
@@ -2968,13 +3319,20 @@ edit_cursor_move (WEdit * edit, off_t increment)
 off_t
 edit_eol (const WEdit * edit, off_t current)
 {
-    if (current >= edit->last_byte)
-        return edit->last_byte;
+    const char *chunk, *nl;
+    off_t len;
 
-    for (; edit_get_byte (edit, current) != '\n'; current++)
-        ;
+    if (current < 0)
+        return current;
 
-    return current;
+    for (; (chunk = edit_get_chunk (edit, current, &len)) != NULL; current += len)
+    {
+        nl = memchr (chunk, '\n', len);
+        if (nl != NULL)
+            return current + (nl - chunk);
+    }
+
+    return edit->last_byte;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3004,8 +3362,16 @@ edit_count_lines (const WEdit * edit, off_t current, off_t upto)
     if (current < 0)
         current = 0;
     while (current < upto)
-        if (edit_get_byte (edit, current++) == '\n')
+    {
+        const char *chunk, *p, *nl;
+        off_t len;
+
+        chunk = edit_get_chunk (edit, current, &len);
+        len = MIN (len, upto - current);
+        for (p = chunk; (nl = memchr (p, '\n', chunk + len - p)) != NULL; p = nl + 1)
             lines++;
+        current += len;
+    }
     return lines;
 }
 
@@ -3021,20 +3387,7 @@ edit_move_forward (const WEdit * edit, off_t current, long lines, off_t upto)
         return (off_t) edit_count_lines (edit, current, upto);
     }
     else
-    {
-        long next;
-        if (lines < 0)
-            lines = 0;
-        while (lines-- != 0)
-        {
-            next = edit_eol (edit, current) + 1;
-            if (next > edit->last_byte)
-                break;
-            else
-                current = next;
-        }
-        return current;
-    }
+        return edit_forward_lines (edit, current, &lines);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3170,7 +3523,10 @@ edit_scroll_upward (WEdit * edit, long i)
     if (i != 0)
     {
         edit->start_line -= i;
-        edit->start_display = edit_move_backward (edit, edit->start_display, i);
+        if (i > EDIT_LINE_INDEX_STEP)
+            edit->start_display = edit_find_line (edit, edit->start_line);
+        else
+            edit->start_display = edit_move_backward (edit, edit->start_display, i);
         edit->force |= REDRAW_PAGE;
         edit->force &= (0xfff - REDRAW_CHAR_ONLY);
     }
@@ -3191,7 +3547,10 @@ edit_scroll_downward (WEdit * edit, long i)
         if (i > lines_below)
             i = lines_below;
         edit->start_line += i;
-        edit->start_display = edit_move_forward (edit, edit->start_display, i, 0);
+        if (i > EDIT_LINE_INDEX_STEP)
+            edit->start_display = edit_find_line (edit, edit->start_line);
+        else
+            edit->start_display = edit_move_forward (edit, edit->start_display, i, 0);
         edit->force |= REDRAW_PAGE;
         edit->force &= (0xfff - REDRAW_CHAR_ONLY);
     }
@@ -3326,9 +3685,9 @@ edit_move_display (WEdit * e, long line)
 void
 edit_push_markers (WEdit * edit)
 {
-    edit_push_undo_action (edit, MARK_1 + edit->mark1);
-    edit_push_undo_action (edit, MARK_2 + edit->mark2);
-    edit_push_undo_action (edit, MARK_CURS + edit->end_mark_curs);
+    edit_push_undo_offset (edit, MARK_1, edit->mark1);
+    edit_push_undo_offset (edit, MARK_2, edit->mark2);
+    edit_push_undo_offset (edit, MARK_CURS, edit->end_mark_curs);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3484,11 +3843,11 @@ edit_insert_indent (WEdit * edit, int indent)
 void
 edit_push_key_press (WEdit * edit)
 {
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
     if (edit->mark2 == -1)
     {
-        edit_push_undo_action (edit, MARK_1 + edit->mark1);
-        edit_push_undo_action (edit, MARK_CURS + edit->end_mark_curs);
+        edit_push_undo_offset (edit, MARK_1, edit->mark1);
+        edit_push_undo_offset (edit, MARK_CURS, edit->end_mark_curs);
     }
 }
 
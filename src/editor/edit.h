@@ -46,6 +46,7 @@ extern int option_save_mode;
 extern int option_save_position;
 extern int option_syntax_highlighting;
 extern int option_group_undo;
+extern int option_filesize_threshold;
 extern char *option_backup_ext;
 
 extern int edit_confirm_save;
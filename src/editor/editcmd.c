@@ -315,16 +315,18 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
         filelen = edit->last_byte;
         while (buf <= (edit->curs1 >> S_EDIT_BUF_SIZE) - 1)
         {
-            if (mc_write (fd, (char *) edit->buffers1[buf], EDIT_BUF_SIZE) != EDIT_BUF_SIZE)
+            if (mc_write (fd, (char *) EDIT_BUF (edit->buffers1, buf), EDIT_BUF_SIZE) !=
+                EDIT_BUF_SIZE)
             {
                 mc_close (fd);
                 goto error_save;
             }
             buf++;
         }
-        if (mc_write
-            (fd, (char *) edit->buffers1[buf],
-             edit->curs1 & M_EDIT_BUF_SIZE) != (edit->curs1 & M_EDIT_BUF_SIZE))
+        /* last block before the cursor is not allocated if it is empty */
+        if ((edit->curs1 & M_EDIT_BUF_SIZE) != 0
+            && mc_write (fd, (char *) EDIT_BUF (edit->buffers1, buf),
+                         edit->curs1 & M_EDIT_BUF_SIZE) != (edit->curs1 & M_EDIT_BUF_SIZE))
         {
             filelen = -1;
         }
@@ -334,7 +336,7 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
             buf = (edit->curs2 >> S_EDIT_BUF_SIZE);
             if (mc_write
                 (fd,
-                 (char *) edit->buffers2[buf] + EDIT_BUF_SIZE -
+                 (char *) EDIT_BUF (edit->buffers2, buf) + EDIT_BUF_SIZE -
                  (edit->curs2 & M_EDIT_BUF_SIZE) - 1,
                  1 + (edit->curs2 & M_EDIT_BUF_SIZE)) != 1 + (edit->curs2 & M_EDIT_BUF_SIZE))
             {
@@ -344,7 +346,8 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
             {
                 while (--buf >= 0)
                 {
-                    if (mc_write (fd, (char *) edit->buffers2[buf], EDIT_BUF_SIZE) != EDIT_BUF_SIZE)
+                    if (mc_write (fd, (char *) EDIT_BUF (edit->buffers2, buf), EDIT_BUF_SIZE) !=
+                        EDIT_BUF_SIZE)
                     {
                         filelen = -1;
                         break;
@@ -596,6 +599,8 @@ edit_block_delete (WEdit * edit)
         return 0;
     if (edit->column_highlight && edit->mark2 < 0)
         edit_mark_cmd (edit, FALSE);
+    /* deleted text takes its size in bytes in the undo journal: warn if the block
+       would push out most of the journal */
     if ((end_mark - start_mark) > option_max_undo / 2)
     {
         /* Warning message with a query to continue or cancel the operation */
@@ -957,7 +962,7 @@ edit_do_search (WEdit * edit)
     if (edit->search == NULL)
         edit->search_start = edit->curs1;
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
 
     if (search_create_bookmark)
     {
@@ -1231,6 +1236,7 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
     srch->search_type = MC_SEARCH_T_REGEX;
     srch->is_case_sensitive = TRUE;
     srch->search_fn = edit_search_cmd_callback;
+    srch->search_buf_fn = edit_search_cmd_get_buf;
 
     current_word = edit_collect_completions_get_current_word (edit, srch, word_start);
 
@@ -1501,6 +1507,91 @@ edit_redraw_page_cb (void *data, void *user_data)
         ((WEdit *) data)->force |= REDRAW_PAGE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Replace the found string and all next occurrences at once.
+ * Matches are collected in one forward pass over the unchanged text, the new text
+ * is built at the same time and then replaces the whole range from the first match
+ * to the end of the last one by one deletion and one insertion.
+ *
+ * @param edit       editor object
+ * @param input2_str replacement string
+ * @param len        length of the found string at edit->search_start
+ * @return number of replacements made
+ */
+
+static long
+edit_replace_all (WEdit * edit, GString * input2_str, gsize len)
+{
+    GString *text;
+    off_t start, pos;
+    gsize repl_len = 0;
+    long times_replaced = 0;
+
+    start = pos = edit->search_start;
+    text = g_string_sized_new (EDIT_BUF_SIZE);
+
+    while (TRUE)
+    {
+        GString *repl_str;
+
+        repl_str = mc_search_prepare_replace_str (edit->search, input2_str);
+        if (edit->search->error != MC_SEARCH_E_OK)
+        {
+            edit_error_dialog (_("Replace"), edit->search->error_str);
+            g_string_free (repl_str, TRUE);
+            break;
+        }
+
+        /* unchanged text before the match */
+        while (pos < edit->search_start)
+        {
+            const char *chunk;
+            off_t chunk_len;
+
+            chunk = edit_get_chunk (edit, pos, &chunk_len);
+            chunk_len = min (chunk_len, edit->search_start - pos);
+            g_string_append_len (text, chunk, chunk_len);
+            pos += chunk_len;
+        }
+
+        g_string_append_len (text, repl_str->str, repl_str->len);
+        repl_len = repl_str->len;
+        g_string_free (repl_str, TRUE);
+        times_replaced++;
+
+        /* so that we don't find the same string again */
+        pos = edit->search_start + len;
+        edit->search_start = pos + (len == 0 ? 1 : 0);
+        if (edit->search_start >= edit->last_byte)
+            break;
+
+        if (!editcmd_find (edit, &len))
+        {
+            if (edit->search->error != MC_SEARCH_E_OK
+                && edit->search->error != MC_SEARCH_E_NOTFOUND)
+                edit_error_dialog (_("Search"), edit->search->error_str);
+            break;
+        }
+
+        edit->search_start = edit->search->normal_offset;
+        if (edit->search_start < pos || edit->search_start >= edit->last_byte)
+            break;
+    }
+
+    edit_cursor_move (edit, start - edit->curs1);
+    edit_delete_chunk (edit, pos - start);
+    edit_insert_chunk (edit, text->str, text->len);
+    g_string_free (text, TRUE);
+
+    edit->found_start = edit->curs1 - repl_len;
+    edit->found_len = repl_len;
+    edit->search_start = edit->curs1;
+    edit->force |= REDRAW_PAGE;
+
+    return times_replaced;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1653,7 +1744,7 @@ edit_save_as_cmd (WEdit * edit)
         return FALSE;
 
     exp_vpath = edit_get_save_file_as (edit);
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
 
     if (exp_vpath != NULL)
     {
@@ -1843,7 +1934,7 @@ edit_store_macro_cmd (WEdit * edit)
     if (macros_config == NULL)
         return FALSE;
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
 
     marcros_string = g_string_sized_new (250);
     macros = g_array_new (TRUE, FALSE, sizeof (macro_action_t));
@@ -1915,7 +2006,7 @@ edit_repeat_macro_cmd (WEdit * edit)
 
     g_free (f);
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
     edit->force |= REDRAW_PAGE;
 
     for (j = 0; j < count_repeat; j++)
@@ -2587,7 +2678,7 @@ edit_replace_cmd (WEdit * edit, int again)
         disp1 = edit_replace_cmd__conv_to_display (saved1 ? saved1 : (char *) "");
         disp2 = edit_replace_cmd__conv_to_display (saved2 ? saved2 : (char *) "");
 
-        edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+        edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
 
         editcmd_dialog_replace_show (edit, disp1, disp2, &input1, &input2);
 
@@ -2629,6 +2720,7 @@ edit_replace_cmd (WEdit * edit, int again)
         edit->search->is_case_sensitive = edit_search_options.case_sens;
         edit->search->whole_words = edit_search_options.whole_words;
         edit->search->search_fn = edit_search_cmd_callback;
+        edit->search->search_buf_fn = edit_search_cmd_get_buf;
         edit->search_line_type = edit_get_search_line_type (edit->search);
         edit_search_fix_search_start_if_selection (edit);
     }
@@ -2711,6 +2803,12 @@ edit_replace_cmd (WEdit * edit, int again)
                 }
             }
 
+            if (edit->replace_mode == 1 && !edit_search_options.backwards)
+            {
+                times_replaced += edit_replace_all (edit, input2_str, len);
+                break;
+            }
+
             repl_str = mc_search_prepare_replace_str (edit->search, input2_str);
 
             if (edit->search->error != MC_SEARCH_E_OK)
@@ -2787,6 +2885,26 @@ edit_search_cmd_callback (const void *user_data, gsize char_offset, int *current
 
 /* --------------------------------------------------------------------------------------------- */
 
+const char *
+edit_search_cmd_get_buf (const void *user_data, gsize char_offset, gsize * len)
+{
+    const char *chunk;
+    off_t chunk_len;
+
+    chunk = edit_get_chunk ((const WEdit *) user_data, (off_t) char_offset, &chunk_len);
+    if (chunk == NULL)
+    {
+        /* like edit_get_byte(), return newline beyond the text */
+        chunk = "\n";
+        chunk_len = 1;
+    }
+
+    *len = (gsize) chunk_len;
+    return chunk;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 void
 edit_search_cmd (WEdit * edit, gboolean again)
 {
@@ -2827,6 +2945,7 @@ edit_search_cmd (WEdit * edit, gboolean again)
                 edit->search->is_case_sensitive = edit_search_options.case_sens;
                 edit->search->whole_words = edit_search_options.whole_words;
                 edit->search->search_fn = edit_search_cmd_callback;
+                edit->search->search_buf_fn = edit_search_cmd_get_buf;
                 edit->search_line_type = edit_get_search_line_type (edit->search);
                 edit_do_search (edit);
             }
@@ -3106,7 +3225,7 @@ edit_save_block_cmd (WEdit * edit)
         input_expand_dialog (_("Save block"), _("Enter file name:"),
                              MC_HISTORY_EDIT_SAVE_BLOCK, tmp, INPUT_COMPLETE_FILENAMES);
     g_free (tmp);
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
 
     if (exp != NULL && *exp != '\0')
     {
@@ -3139,7 +3258,7 @@ edit_insert_file_cmd (WEdit * edit)
                                MC_HISTORY_EDIT_INSERT_FILE, tmp, INPUT_COMPLETE_FILENAMES);
     g_free (tmp);
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_offset (edit, KEY_PRESS, edit->start_display);
 
     if (exp != NULL && *exp != '\0')
     {
@@ -3370,7 +3489,8 @@ edit_complete_word_cmd (WEdit * edit)
         return;
 
     /* prepare match expression */
-    bufpos = &edit->buffers1[word_start >> S_EDIT_BUF_SIZE][word_start & M_EDIT_BUF_SIZE];
+    bufpos =
+        &EDIT_BUF (edit->buffers1, word_start >> S_EDIT_BUF_SIZE)[word_start & M_EDIT_BUF_SIZE];
 
     /* match_expr = g_strdup_printf ("\\b%.*s[a-zA-Z_0-9]+", word_len, bufpos); */
     match_expr =
@@ -3547,7 +3667,8 @@ edit_get_match_keyword_cmd (WEdit * edit)
         return;
 
     /* prepare match expression */
-    bufpos = &edit->buffers1[word_start >> S_EDIT_BUF_SIZE][word_start & M_EDIT_BUF_SIZE];
+    bufpos =
+        &EDIT_BUF (edit->buffers1, word_start >> S_EDIT_BUF_SIZE)[word_start & M_EDIT_BUF_SIZE];
     match_expr = g_strdup_printf ("%.*s", (int) word_len, bufpos);
 
     ptr = g_get_current_dir ();
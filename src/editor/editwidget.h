@@ -12,8 +12,6 @@
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
-#define N_LINE_CACHES 32
-
 /*** enums ***************************************************************************************/
 
 /**
@@ -28,6 +26,30 @@ typedef enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* known start of line */
+typedef struct edit_line_anchor_t
+{
+    long line;
+    off_t offset;
+} edit_line_anchor_t;
+
+/* record of undo journal */
+typedef struct edit_undo_record_t
+{
+    long action;
+    off_t offset;               /* position of mark or start_display */
+    off_t count;                /* number of repeats of action or length of text span */
+} edit_undo_record_t;
+
+typedef struct edit_undo_journal_t
+{
+    GArray *records;            /* edit_undo_record_t */
+    GString *text;              /* deleted text of all records */
+    guint bottom;               /* records and text before these indexes are dropped */
+    gsize text_bottom;
+    gboolean overflow;          /* key press didn't fit into journal, don't record it */
+} edit_undo_journal_t;
+
 typedef struct edit_book_mark_t edit_book_mark_t;
 struct edit_book_mark_t
 {
@@ -76,8 +98,8 @@ struct WEdit
     /* dynamic buffers and cursor position for editor: */
     off_t curs1;                /* position of the cursor from the beginning of the file. */
     off_t curs2;                /* position from the end of the file */
-    unsigned char *buffers1[MAXBUFF + 1];       /* all data up to curs1 */
-    unsigned char *buffers2[MAXBUFF + 1];       /* all data from end of file down to curs2 */
+    GPtrArray *buffers1;        /* all data up to curs1 */
+    GPtrArray *buffers2;        /* all data from end of file down to curs2 */
 
 #ifdef HAVE_CHARSET
     /* multibyte support */
@@ -129,34 +151,31 @@ struct WEdit
     long column2;               /* position of column highlight end */
     off_t bracket;              /* position of a matching bracket */
 
-    /* cache speedup for line lookups */
-    gboolean caches_valid;
-    long line_numbers[N_LINE_CACHES];
-    off_t line_offsets[N_LINE_CACHES];
+    /* index of line starts for line lookups, sorted by line number */
+    GArray *line_index;         /* edit_line_anchor_t */
+    /* anchors starting from line_index_dirty are not shifted yet by the deltas below */
+    guint line_index_dirty;
+    long line_index_dline;
+    off_t line_index_doffset;
 
     edit_book_mark_t *book_mark;
     GArray *serialized_bookmarks;
 
-    /* undo stack and pointers */
-    unsigned long undo_stack_pointer;
-    long *undo_stack;
-    unsigned long undo_stack_size;
-    unsigned long undo_stack_size_mask;
-    unsigned long undo_stack_bottom;
+    /* undo and redo journals */
+    edit_undo_journal_t undo_journal;
     unsigned int undo_stack_disable:1;  /* If not 0, don't save events in the undo stack */
-
-    unsigned long redo_stack_pointer;
-    long *redo_stack;
-    unsigned long redo_stack_size;
-    unsigned long redo_stack_size_mask;
-    unsigned long redo_stack_bottom;
+    edit_undo_journal_t redo_journal;
     unsigned int redo_stack_reset:1;    /* If 1, need clear redo stack */
 
     struct stat stat1;          /* Result of mc_fstat() on the file */
     unsigned int skip_detach_prompt:1;  /* Do not prompt whether to detach a file anymore */
 
     /* syntax higlighting */
-    GSList *syntax_marker;
+    GArray *syntax_marker;      /* highlighting states at line ends, sorted by offset */
+    guint syntax_marker_valid;  /* number of leading markers not affected by later changes */
+    off_t syntax_marker_dirty_end;      /* end of the text changed since markers were verified */
+    guint syntax_marker_shift_from;     /* first marker of the pending offset shift */
+    off_t syntax_marker_shift;  /* pending offset shift of markers */
     struct context_rule **rules;
     off_t last_get_rule;
     edit_syntax_rule_t rule;
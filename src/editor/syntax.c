@@ -117,7 +117,9 @@ struct context_rule
     int between_delimiters;
     char *whole_word_chars_left;
     char *whole_word_chars_right;
-    char *keyword_first_chars;
+    /* keywords to try at character c are keyword_list[keyword_bucket[c] .. keyword_bucket[c + 1]) */
+    int *keyword_list;
+    int keyword_bucket[257];
     gboolean spelling;
     /* first word is word[1] */
     struct key_word **keyword;
@@ -324,17 +326,6 @@ compare_word_to_right (const WEdit * edit, off_t i, const char *text,
 
 /* --------------------------------------------------------------------------------------------- */
 
-static const char *
-xx_strchr (const WEdit * edit, const unsigned char *s, int char_byte)
-{
-    while (*s >= '\005' && xx_tolower (edit, *s) != char_byte)
-        s++;
-
-    return (const char *) s;
-}
-
-/* --------------------------------------------------------------------------------------------- */
-
 static edit_syntax_rule_t
 apply_rules_going_right (WEdit * edit, off_t i, edit_syntax_rule_t rule)
 {
@@ -400,31 +391,29 @@ apply_rules_going_right (WEdit * edit, off_t i, edit_syntax_rule_t rule)
     /* check to turn on a keyword */
     if (!_rule.keyword)
     {
-        const char *p;
+        int n;
 
         r = edit->rules[_rule.context];
-        p = r->keyword_first_chars;
 
-        if (p != NULL)
-            while (*(p = xx_strchr (edit, (unsigned char *) p + 1, c)) != '\0')
+        for (n = r->keyword_bucket[c]; n < r->keyword_bucket[c + 1]; n++)
+        {
+            struct key_word *k;
+            int count;
+            off_t e;
+
+            count = r->keyword_list[n];
+            k = r->keyword[count];
+            e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
+                                       k->whole_word_chars_right, k->line_start);
+            if (e > 0)
             {
-                struct key_word *k;
-                int count;
-                off_t e;
-
-                count = p - r->keyword_first_chars;
-                k = r->keyword[count];
-                e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                           k->whole_word_chars_right, k->line_start);
-                if (e > 0)
-                {
-                    end = e;
-                    _rule.end = e;
-                    _rule.keyword = count;
-                    keyword_foundright = TRUE;
-                    break;
-                }
+                end = e;
+                _rule.end = e;
+                _rule.keyword = count;
+                keyword_foundright = TRUE;
+                break;
             }
+        }
     }
 
     /* check to turn on a context */
@@ -503,18 +492,17 @@ apply_rules_going_right (WEdit * edit, off_t i, edit_syntax_rule_t rule)
     /* check again to turn on a keyword if the context switched */
     if (contextchanged && !_rule.keyword)
     {
-        const char *p;
+        int n;
 
         r = edit->rules[_rule.context];
-        p = r->keyword_first_chars;
 
-        while (*(p = xx_strchr (edit, (unsigned char *) p + 1, c)) != '\0')
+        for (n = r->keyword_bucket[c]; n < r->keyword_bucket[c + 1]; n++)
         {
             struct key_word *k;
             int count;
             off_t e;
 
-            count = p - r->keyword_first_chars;
+            count = r->keyword_list[n];
             k = r->keyword[count];
             e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
                                        k->whole_word_chars_right, k->line_start);
@@ -532,61 +520,193 @@ apply_rules_going_right (WEdit * edit, off_t i, edit_syntax_rule_t rule)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static edit_syntax_rule_t
-edit_get_rule (WEdit * edit, off_t byte_index)
+/** Offset of the marker @i taking the pending shift into account */
+
+static inline off_t
+syntax_marker_offset (const WEdit * edit, guint i)
 {
-    off_t i;
+    off_t offset;
 
-    if (byte_index > edit->last_get_rule)
+    offset = g_array_index (edit->syntax_marker, syntax_marker_t, i).offset;
+    if (i >= edit->syntax_marker_shift_from)
+        offset += edit->syntax_marker_shift;
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Returns index of the first marker located at or after @offset */
+
+static guint
+syntax_marker_find (const WEdit * edit, off_t offset)
+{
+    guint lo = 0, hi = edit->syntax_marker->len;
+
+    while (lo < hi)
     {
-        for (i = edit->last_get_rule + 1; i <= byte_index; i++)
-        {
-            off_t d = SYNTAX_MARKER_DENSITY;
+        guint mid = lo + (hi - lo) / 2;
 
-            edit->rule = apply_rules_going_right (edit, i, edit->rule);
+        if (syntax_marker_offset (edit, mid) < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
 
-            if (edit->syntax_marker != NULL)
-                d += ((syntax_marker_t *) edit->syntax_marker->data)->offset;
+    return lo;
+}
 
-            if (i > d)
-            {
-                syntax_marker_t *s;
+/* --------------------------------------------------------------------------------------------- */
+/** Apply the pending shift to the marker offsets */
 
-                s = g_new (syntax_marker_t, 1);
-                s->offset = i;
-                s->rule = edit->rule;
-                edit->syntax_marker = g_slist_prepend (edit->syntax_marker, s);
-            }
-        }
+static void
+syntax_marker_flush (WEdit * edit)
+{
+    guint i;
+
+    if (edit->syntax_marker_shift == 0)
+        return;
+
+    for (i = edit->syntax_marker_shift_from; i < edit->syntax_marker->len; i++)
+    {
+        syntax_marker_t *s;
+
+        s = &g_array_index (edit->syntax_marker, syntax_marker_t, i);
+        s->offset += edit->syntax_marker_shift;
+        s->rule.end += edit->syntax_marker_shift;
     }
-    else if (byte_index < edit->last_get_rule)
+
+    edit->syntax_marker_shift = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Start highlighting from the beginning of the text */
+
+static void
+syntax_restart (WEdit * edit)
+{
+    edit->last_get_rule = -2;
+    memset (&edit->rule, 0, sizeof (edit->rule));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare two states at @offset. End of keyword which is already passed is irrelevant
+ * for the following text.
+ */
+
+static gboolean
+syntax_rule_equal (const edit_syntax_rule_t * a, const edit_syntax_rule_t * b, off_t offset)
+{
+    return a->keyword == b->keyword && a->context == b->context && a->_context == b->_context
+        && a->border == b->border && (a->end == b->end || (a->end <= offset && b->end <= offset));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record the state reached at the newline at @offset.
+ *
+ * @param n index of the first marker after the previous newline
+ * @return index of the first marker after @offset
+ */
+
+static guint
+syntax_marker_update (WEdit * edit, guint n, off_t offset)
+{
+    GArray *markers = edit->syntax_marker;
+    syntax_marker_t *s = NULL;
+
+    while (n < markers->len)
     {
-        while (TRUE)
+        s = &g_array_index (markers, syntax_marker_t, n);
+        if (s->offset >= offset)
+            break;
+        /* not at line end anymore */
+        if (n < edit->syntax_marker_valid)
+            n++;
+        else
+            g_array_remove_index (markers, n);
+        s = NULL;
+    }
+
+    if (s != NULL && s->offset == offset)
+    {
+        if (n < edit->syntax_marker_valid)
+            return n + 1;
+
+        if (offset >= edit->syntax_marker_dirty_end
+            && syntax_rule_equal (&s->rule, &edit->rule, offset))
+        {
+            /* highlighting has converged: the rest of the text is colored as before */
+            edit->syntax_marker_valid = markers->len;
+        }
+        else
         {
-            syntax_marker_t *s;
+            /* following markers may be inconsistent with the new state */
+            s->rule = edit->rule;
+            edit->syntax_marker_valid = n + 1;
+            edit->syntax_marker_dirty_end = MAX (edit->syntax_marker_dirty_end, offset + 1);
+        }
+        return n + 1;
+    }
 
-            if (edit->syntax_marker == NULL)
-            {
-                memset (&edit->rule, 0, sizeof (edit->rule));
-                for (i = -1; i <= byte_index; i++)
-                    edit->rule = apply_rules_going_right (edit, i, edit->rule);
-                break;
-            }
+    if (offset - (n == 0 ? -1 : g_array_index (markers, syntax_marker_t, n - 1).offset) >=
+        SYNTAX_MARKER_DENSITY)
+    {
+        syntax_marker_t m;
+
+        m.offset = offset;
+        m.rule = edit->rule;
+        g_array_insert_val (markers, n, m);
+        if (n <= edit->syntax_marker_valid)
+            edit->syntax_marker_valid++;
+        if (edit->syntax_marker_valid < markers->len)
+            edit->syntax_marker_dirty_end = MAX (edit->syntax_marker_dirty_end, offset + 1);
+        n++;
+    }
 
-            s = (syntax_marker_t *) edit->syntax_marker->data;
+    return n;
+}
 
-            if (byte_index >= s->offset)
-            {
-                edit->rule = s->rule;
-                for (i = s->offset + 1; i <= byte_index; i++)
-                    edit->rule = apply_rules_going_right (edit, i, edit->rule);
-                break;
-            }
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_syntax_rule_t
+edit_get_rule (WEdit * edit, off_t byte_index)
+{
+    GArray *markers;
+    guint n;
+    off_t i;
 
-            g_free (s);
-            edit->syntax_marker = g_slist_delete_link (edit->syntax_marker, edit->syntax_marker);
+    if (edit->syntax_marker == NULL)
+        edit->syntax_marker = g_array_new (FALSE, FALSE, sizeof (syntax_marker_t));
+    markers = edit->syntax_marker;
+    syntax_marker_flush (edit);
+
+    /* nearest verified state before byte_index */
+    n = MIN (syntax_marker_find (edit, byte_index + 1), edit->syntax_marker_valid);
+
+    if (byte_index < edit->last_get_rule
+        || (n != 0 && edit->last_get_rule < g_array_index (markers, syntax_marker_t, n - 1).offset))
+    {
+        if (n == 0)
+            syntax_restart (edit);
+        else
+        {
+            const syntax_marker_t *s;
+
+            s = &g_array_index (markers, syntax_marker_t, n - 1);
+            edit->rule = s->rule;
+            edit->last_get_rule = s->offset;
         }
     }
+    else
+        n = syntax_marker_find (edit, edit->last_get_rule + 1);
+
+    for (i = edit->last_get_rule + 1; i <= byte_index; i++)
+    {
+        edit->rule = apply_rules_going_right (edit, i, edit->rule);
+        if (i >= 0 && edit_get_byte (edit, i) == '\n')
+            n = syntax_marker_update (edit, n, i);
+    }
+
     edit->last_get_rule = byte_index;
     return edit->rule;
 }
@@ -873,6 +993,57 @@ xx_lowerize_line (WEdit * edit, char *line, size_t len)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Build the table of keywords to try at each character.  Keywords are grouped by their first
+ * character keeping the order of the syntax file; keywords starting with a wildcard are tried
+ * at any character.
+ */
+
+static void
+compile_keywords (const WEdit * edit, struct context_rule *c)
+{
+    int *bucket = c->keyword_bucket;
+    int count[256];
+    int j, ch, wild = 0;
+
+    memset (count, 0, sizeof (count));
+
+    /* as before, an empty keyword hides the rest of the context */
+    for (j = 1; c->keyword[j] != NULL && c->keyword[j]->first != '\0'; j++)
+    {
+        ch = xx_tolower (edit, c->keyword[j]->first);
+        if (ch < '\005')
+            wild++;
+        else
+            count[ch]++;
+    }
+
+    bucket[0] = 0;
+    for (ch = 0; ch < 256; ch++)
+        bucket[ch + 1] = bucket[ch] + count[ch] + wild;
+
+    c->keyword_list = g_new (int, bucket[256] + 1);
+
+    /* use count[] as fill positions */
+    for (ch = 0; ch < 256; ch++)
+        count[ch] = bucket[ch];
+
+    for (j = 1; c->keyword[j] != NULL && c->keyword[j]->first != '\0'; j++)
+    {
+        ch = xx_tolower (edit, c->keyword[j]->first);
+        if (ch >= '\005')
+            c->keyword_list[count[ch]++] = j;
+        else
+        {
+            int k;
+
+            for (k = 0; k < 256; k++)
+                c->keyword_list[count[k]++] = j;
+        }
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** returns line number on error */
 
@@ -890,10 +1061,8 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
     int num_words = -1, num_contexts = -1;
     int result = 0;
     int argc;
-    int i, j;
-    int alloc_contexts = MAX_CONTEXTS,
-        alloc_words_per_context = MAX_WORDS_PER_CONTEXT,
-        max_alloc_words_per_context = MAX_WORDS_PER_CONTEXT;
+    int i;
+    int alloc_contexts = MAX_CONTEXTS, alloc_words_per_context = MAX_WORDS_PER_CONTEXT;
 
     args[0] = NULL;
     edit->is_case_insensitive = FALSE;
@@ -1144,10 +1313,6 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
                 struct key_word **tmp;
 
                 alloc_words_per_context += 1024;
-
-                if (alloc_words_per_context > max_alloc_words_per_context)
-                    max_alloc_words_per_context = alloc_words_per_context;
-
                 tmp = g_realloc (c->keyword, alloc_words_per_context * sizeof (struct key_word *));
                 c->keyword = tmp;
             }
@@ -1201,25 +1366,11 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
 
     if (result == 0)
     {
-        char *first_chars, *p;
-
         if (num_contexts == -1)
             return line;
 
-        first_chars = g_malloc0 (max_alloc_words_per_context + 2);
-
         for (i = 0; edit->rules[i] != NULL; i++)
-        {
-            c = edit->rules[i];
-            p = first_chars;
-            *p++ = (char) 1;
-            for (j = 1; c->keyword[j] != NULL; j++)
-                *p++ = c->keyword[j]->first;
-            *p = '\0';
-            c->keyword_first_chars = g_strdup (first_chars);
-        }
-
-        g_free (first_chars);
+            compile_keywords (edit, edit->rules[i]);
     }
 
     return result;
@@ -1409,6 +1560,70 @@ edit_get_syntax_color (WEdit * edit, off_t byte_index)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Update highlighting states after the text was changed.
+ *
+ * @param offset position of the change
+ * @param delta number of inserted bytes if positive, number of deleted bytes if negative
+ */
+
+void
+edit_syntax_change (WEdit * edit, off_t offset, off_t delta)
+{
+    GArray *markers = edit->syntax_marker;
+    gboolean dirty;
+    off_t start, end;
+    guint first, last;
+
+    if (edit->rules == NULL)
+        return;
+
+    /* keywords are looked up to the end of line, so whole line is affected */
+    start = edit_bol (edit, offset) - 1;
+    if (edit->last_get_rule >= start)
+        syntax_restart (edit);
+
+    if (markers == NULL || markers->len == 0)
+        return;
+
+    dirty = edit->syntax_marker_valid < markers->len;
+
+    if (delta < 0)
+    {
+        /* forget states inside deleted text */
+        first = syntax_marker_find (edit, offset);
+        last = syntax_marker_find (edit, offset - delta);
+        if (last > first)
+        {
+            g_array_remove_range (markers, first, last - first);
+            if (edit->syntax_marker_shift_from >= last)
+                edit->syntax_marker_shift_from -= last - first;
+            else if (edit->syntax_marker_shift_from > first)
+                edit->syntax_marker_shift_from = first;
+        }
+    }
+
+    first = syntax_marker_find (edit, offset);
+    if (first < markers->len)
+    {
+        if (edit->syntax_marker_shift_from != first)
+            syntax_marker_flush (edit);
+        edit->syntax_marker_shift_from = first;
+        edit->syntax_marker_shift += delta;
+    }
+
+    end = offset + MAX (delta, 0);
+    if (dirty && edit->syntax_marker_dirty_end >= offset)
+        end = MAX (end, MAX (edit->syntax_marker_dirty_end + delta, offset));
+    else if (dirty)
+        end = MAX (end, edit->syntax_marker_dirty_end);
+    edit->syntax_marker_dirty_end = end;
+
+    edit->syntax_marker_valid = MIN (edit->syntax_marker_valid, syntax_marker_find (edit, start));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 void
 edit_free_syntax_rules (WEdit * edit)
 {
@@ -1418,10 +1633,19 @@ edit_free_syntax_rules (WEdit * edit)
         return;
     if (edit->defines)
         destroy_defines (&edit->defines);
+
+    if (edit->syntax_marker != NULL)
+    {
+        g_array_free (edit->syntax_marker, TRUE);
+        edit->syntax_marker = NULL;
+    }
+    edit->syntax_marker_valid = 0;
+    edit->syntax_marker_shift = 0;
+    syntax_restart (edit);
+
     if (!edit->rules)
         return;
 
-    edit_get_rule (edit, -1);
     MC_PTR_FREE (edit->syntax_type);
 
     for (i = 0; edit->rules[i]; i++)
@@ -1441,13 +1665,10 @@ edit_free_syntax_rules (WEdit * edit)
         MC_PTR_FREE (edit->rules[i]->whole_word_chars_left);
         MC_PTR_FREE (edit->rules[i]->whole_word_chars_right);
         MC_PTR_FREE (edit->rules[i]->keyword);
-        MC_PTR_FREE (edit->rules[i]->keyword_first_chars);
+        MC_PTR_FREE (edit->rules[i]->keyword_list);
         MC_PTR_FREE (edit->rules[i]);
     }
 
-    g_slist_foreach (edit->syntax_marker, (GFunc) g_free, NULL);
-    g_slist_free (edit->syntax_marker);
-    edit->syntax_marker = NULL;
     MC_PTR_FREE (edit->rules);
     tty_color_free_all_tmp ();
 }
@@ -36,9 +36,6 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#ifdef HAVE_MMAP
-#include <sys/mman.h>
-#endif
 #ifdef ENABLE_VFS_NET
 #include <netdb.h>
 #endif
@@ -102,9 +99,11 @@ int select_flags = SELECT_MATCH_CASE | SELECT_SHELL_PATTERNS;
 
 /*** file scope macro definitions ****************************************************************/
 
-#ifndef MAP_FILE
-#define MAP_FILE 0
-#endif
+/* size of the blocks read from both files by the thorough directory compare */
+#define COMPARE_CHUNK_SIZE (64 * 1024)
+
+/* maximal number of cached results of the thorough directory compare */
+#define COMPARE_CACHE_MAX 65536
 
 /*** file scope type declarations ****************************************************************/
 
@@ -113,12 +112,25 @@ enum CompareMode
     compare_quick, compare_size_only, compare_thourough
 };
 
+/* identity of a pair of files compared by content */
+typedef struct
+{
+    dev_t dev[2];
+    ino_t ino[2];
+    time_t mtime[2];
+    time_t ctime[2];
+    off_t size;
+} compare_key_t;
+
 /*** file scope variables ************************************************************************/
 
 #ifdef ENABLE_VFS_NET
 static const char *machine_str = N_("Enter machine name (F1 for details):");
 #endif /* ENABLE_VFS_NET */
 
+/* results of the thorough directory compare, compare_key_t -> result + 1 */
+static GHashTable *compare_cache = NULL;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 /**
@@ -288,12 +300,47 @@ select_unselect_cmd (const char *title, const char *history_name, gboolean do_se
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Read up to 'size' bytes, restarting after interrupts and short reads.
+ *
+ * @return number of bytes read, -1 on error
+ */
+
+static ssize_t
+compare_read (int fd, char *buf, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size)
+    {
+        ssize_t n;
+
+        n = read (fd, buf + done, size - done);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1)
+            return -1;
+        if (n == 0)
+            break;
+        done += n;
+    }
+
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare contents of two files block by block, stopping at the first different block.
+ *
+ * @return 0 if files are equal, 1 if they differ, -1 if they cannot be read
+ */
+
 static int
 compare_files (const vfs_path_t * vpath1, const vfs_path_t * vpath2, off_t size)
 {
     int file1, file2;
     char *name;
-    int result = -1;            /* Different by default */
+    int result = -1;
 
     if (size == 0)
         return 0;
@@ -308,34 +355,36 @@ compare_files (const vfs_path_t * vpath1, const vfs_path_t * vpath2, off_t size)
         g_free (name);
         if (file2 >= 0)
         {
-#ifdef HAVE_MMAP
-            char *data1, *data2;
-            /* Ugly if jungle */
-            data1 = mmap (0, size, PROT_READ, MAP_FILE | MAP_PRIVATE, file1, 0);
-            if (data1 != (char *) -1)
+            char *buf1, *buf2;
+            ssize_t n1, n2;
+
+            buf1 = g_malloc (2 * COMPARE_CHUNK_SIZE);
+            buf2 = buf1 + COMPARE_CHUNK_SIZE;
+
+            rotate_dash ();
+            while (TRUE)
             {
-                data2 = mmap (0, size, PROT_READ, MAP_FILE | MAP_PRIVATE, file2, 0);
-                if (data2 != (char *) -1)
+                n1 = compare_read (file1, buf1, COMPARE_CHUNK_SIZE);
+                n2 = compare_read (file2, buf2, COMPARE_CHUNK_SIZE);
+                if (n1 < 0 || n2 < 0)
+                    break;
+
+                if (n1 != n2 || n1 == 0 || memcmp (buf1, buf2, n1) != 0)
                 {
-                    rotate_dash ();
-                    result = memcmp (data1, data2, size);
-                    munmap (data2, size);
+                    result = 1;
+                    break;
+                }
+
+                size -= n1;
+                if (size <= 0)
+                {
+                    /* equal unless the files have grown */
+                    result = size == 0 ? 0 : 1;
+                    break;
                 }
-                munmap (data1, size);
-            }
-#else
-            /* Don't have mmap() :( Even more ugly :) */
-            char buf1[BUFSIZ], buf2[BUFSIZ];
-            int n1, n2;
-            rotate_dash ();
-            do
-            {
-                while ((n1 = read (file1, buf1, BUFSIZ)) == -1 && errno == EINTR);
-                while ((n2 = read (file2, buf2, BUFSIZ)) == -1 && errno == EINTR);
             }
-            while (n1 == n2 && n1 == BUFSIZ && !memcmp (buf1, buf2, BUFSIZ));
-            result = (n1 != n2) || memcmp (buf1, buf2, n1);
-#endif /* !HAVE_MMAP */
+
+            g_free (buf1);
             close (file2);
         }
         close (file1);
@@ -345,20 +394,119 @@ compare_files (const vfs_path_t * vpath1, const vfs_path_t * vpath2, off_t size)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static guint
+compare_key_hash (gconstpointer v)
+{
+    const compare_key_t *key = (const compare_key_t *) v;
+    guint h;
+    int i;
+
+    h = (guint) key->size;
+    for (i = 0; i < 2; i++)
+    {
+        h = h * 31 + (guint) key->ino[i];
+        h = h * 31 + (guint) key->dev[i];
+        h = h * 31 + (guint) key->mtime[i];
+    }
+    return h;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+compare_key_equal (gconstpointer a, gconstpointer b)
+{
+    return (memcmp (a, b, sizeof (compare_key_t)) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare contents of two files of the same size, reusing the result of a previous compare
+ * if neither file was changed since.  Read errors are not cached.
+ *
+ * @return 0 if files are equal, 1 if they differ, -1 if they cannot be read
+ */
+
+static int
+compare_files_cached (const vfs_path_t * vpath1, const struct stat *st1,
+                      const vfs_path_t * vpath2, const struct stat *st2)
+{
+    compare_key_t *key;
+    const struct stat *st[2];
+    gpointer value;
+    int i, result;
+
+    /* the pair is symmetric: order it by identity so both panels share the entry */
+    if (st1->st_dev < st2->st_dev || (st1->st_dev == st2->st_dev && st1->st_ino <= st2->st_ino))
+    {
+        st[0] = st1;
+        st[1] = st2;
+    }
+    else
+    {
+        st[0] = st2;
+        st[1] = st1;
+    }
+
+    key = g_new0 (compare_key_t, 1);
+    for (i = 0; i < 2; i++)
+    {
+        key->dev[i] = st[i]->st_dev;
+        key->ino[i] = st[i]->st_ino;
+        key->mtime[i] = st[i]->st_mtime;
+        key->ctime[i] = st[i]->st_ctime;
+    }
+    key->size = st1->st_size;
+
+    if (compare_cache == NULL)
+        compare_cache = g_hash_table_new_full (compare_key_hash, compare_key_equal, g_free, NULL);
+
+    value = g_hash_table_lookup (compare_cache, key);
+    if (value != NULL)
+    {
+        g_free (key);
+        return GPOINTER_TO_INT (value) - 1;
+    }
+
+    result = compare_files (vpath1, vpath2, st1->st_size);
+    if (result < 0)
+    {
+        g_free (key);
+        return result;
+    }
+
+    if (g_hash_table_size (compare_cache) >= COMPARE_CACHE_MAX)
+        g_hash_table_remove_all (compare_cache);
+    g_hash_table_insert (compare_cache, key, GINT_TO_POINTER (result + 1));
+
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
 compare_dir (WPanel * panel, WPanel * other, enum CompareMode mode)
 {
-    int i, j;
+    GHashTable *targets;
+    int i;
 
     /* No marks by default */
     panel->marked = 0;
     panel->total = 0;
     panel->dirs_marked = 0;
 
+    /* Index the entries of the other panel by name */
+    targets = g_hash_table_new (g_str_hash, g_str_equal);
+    for (i = 0; i < other->count; i++)
+        /* as with a linear search, the first entry of duplicate names is found */
+        if (g_hash_table_lookup (targets, other->dir.list[i].fname) == NULL)
+            g_hash_table_insert (targets, other->dir.list[i].fname, &other->dir.list[i]);
+
     /* Handle all files in the panel */
     for (i = 0; i < panel->count; i++)
     {
         file_entry *source = &panel->dir.list[i];
+        file_entry *target;
 
         /* Default: unmarked */
         file_mark (panel, i, 0);
@@ -368,19 +516,13 @@ compare_dir (WPanel * panel, WPanel * other, enum CompareMode mode)
             continue;
 
         /* Search the corresponding entry from the other panel */
-        for (j = 0; j < other->count; j++)
-        {
-            if (strcmp (source->fname, other->dir.list[j].fname) == 0)
-                break;
-        }
-        if (j >= other->count)
+        target = (file_entry *) g_hash_table_lookup (targets, source->fname);
+        if (target == NULL)
             /* Not found -> mark */
             do_file_mark (panel, i, 1);
         else
         {
             /* Found */
-            file_entry *target = &other->dir.list[j];
-
             if (mode != compare_size_only)
             {
                 /* Older version is not marked */
@@ -415,13 +557,15 @@ compare_dir (WPanel * panel, WPanel * other, enum CompareMode mode)
 
                 src_name = vfs_path_append_new (panel->cwd_vpath, source->fname, NULL);
                 dst_name = vfs_path_append_new (other->cwd_vpath, target->fname, NULL);
-                if (compare_files (src_name, dst_name, source->st.st_size))
+                if (compare_files_cached (src_name, &source->st, dst_name, &target->st))
                     do_file_mark (panel, i, 1);
                 vfs_path_free (src_name);
                 vfs_path_free (dst_name);
             }
         }
     }                           /* for (i ...) */
+
+    g_hash_table_destroy (targets);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -30,6 +30,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include "lib/global.h"
@@ -40,6 +42,9 @@
 #include "lib/strutil.h"
 #include "lib/util.h"
 #include "lib/widget.h"         /* message() */
+#ifdef USE_MAINTAINER_MODE
+#include "lib/logging.h"
+#endif
 
 #include "src/setup.h"          /* panels_options */
 
@@ -56,10 +61,28 @@
         ? 1 \
         : ( (S_ISDIR (x->st.st_mode) || x->f.link_to_dir) ? 2 : 0) )
 
+#ifndef O_DIRECTORY
+#define O_DIRECTORY 0
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
 /*** file scope type declarations ****************************************************************/
 
+typedef struct
+{
+    int reused;                 /* entries taken from the previous listing as is */
+    int refreshed;              /* new or changed entries */
+    gboolean resorted;          /* whether the list had to be sorted again */
+} dir_reload_stats_t;
+
 /*** file scope variables ************************************************************************/
 
+/* Statistics of the last do_reload_dir() call */
+static dir_reload_stats_t dir_reload_stats;
+
 /* Reverse flag */
 static int reverse = 1;
 
@@ -71,6 +94,10 @@ static gboolean exec_first = TRUE;
 
 static dir_list dir_copy = { 0, 0 };
 
+/* Descriptor of the local directory being loaded, or -1 if entries
+   must be stat'ed through the VFS layer */
+static int dir_local_fd = -1;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -116,23 +143,79 @@ key_collate (const char *t1, const char *t2)
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * clear keys, should be call after sorting is finished.
+ * Release sort keys of the entry.
+ */
+
+static void
+release_sort_keys (file_entry * fe)
+{
+    str_release_key (fe->sort_key, fe->f.sort_key_case_sen);
+    fe->sort_key = NULL;
+    str_release_key (fe->second_sort_key, fe->f.sort_key_case_sen);
+    fe->second_sort_key = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop keys created for another case sensitivity, should be called before sorting.
+ * Keys created for the current one are kept between sortings.
  */
 
 static void
-clean_sort_keys (dir_list * list, int start, int count)
+prepare_sort_keys (dir_list * list, int start, int count)
 {
     int i;
 
-    for (i = 0; i < count; i++)
+    for (i = start; i < start + count; i++)
     {
-        str_release_key (list->list[i + start].sort_key, case_sensitive);
-        list->list[i + start].sort_key = NULL;
-        str_release_key (list->list[i + start].second_sort_key, case_sensitive);
-        list->list[i + start].second_sort_key = NULL;
+        file_entry *fe = &list->list[i];
+
+        if ((fe->sort_key != NULL || fe->second_sort_key != NULL)
+            && fe->f.sort_key_case_sen != (unsigned int) case_sensitive)
+            release_sort_keys (fe);
+
+        fe->f.sort_key_case_sen = case_sensitive;
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stable merge sort of the array of entry pointers.
+ *
+ * @param a array to sort
+ * @param tmp temporary array of the same size
+ * @param n number of elements
+ * @param sort compare function
+ */
+
+static void
+merge_sort (file_entry ** a, file_entry ** tmp, size_t n, sortfn * sort)
+{
+    size_t half, i, j, k;
+
+    if (n < 2)
+        return;
+
+    half = n / 2;
+    merge_sort (a, tmp, half, sort);
+    merge_sort (a + half, tmp, n - half, sort);
+
+    /* already in order */
+    if (sort (a[half - 1], a[half]) <= 0)
+        return;
+
+    memcpy (tmp, a, half * sizeof (file_entry *));
+
+    for (i = 0, j = half, k = 0; i < half && j < n; k++)
+        if (sort (a[j], tmp[i]) < 0)
+            a[k] = a[j++];
+        else
+            a[k] = tmp[i++];
+
+    while (i < half)
+        a[k++] = tmp[i++];
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Increase directory list by RESIZE_STEPS
@@ -157,6 +240,109 @@ grow_list (dir_list * list)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open directory for stat'ing its entries by name without going through the VFS layer.
+ * Building and parsing of vfs_path_t for every entry is the most expensive part of
+ * the directory loading on local filesystems.
+ *
+ * @param vpath directory path
+ */
+
+static void
+dir_local_stat_open (const vfs_path_t * vpath)
+{
+#ifdef HAVE_FSTATAT
+    const vfs_path_element_t *path_element;
+
+    dir_local_fd = -1;
+
+    if (vfs_path_elements_count (vpath) != 1 || !vfs_file_is_local (vpath))
+        return;
+
+    path_element = vfs_path_get_by_index (vpath, 0);
+#ifdef HAVE_CHARSET
+    /* entry names are recoded, stat them through VFS */
+    if (path_element->encoding != NULL)
+        return;
+#endif
+    if (path_element->path == NULL || *path_element->path != PATH_SEP)
+        return;
+
+    /* the path may be replaced after the directory was opened: refuse non-directories */
+    dir_local_fd = open (path_element->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    /* do not leak descriptor to subshell and filters */
+    if (O_CLOEXEC == 0 && dir_local_fd != -1)
+        (void) fcntl (dir_local_fd, F_SETFD, FD_CLOEXEC);
+#else
+    (void) vpath;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_local_stat_close (void)
+{
+    if (dir_local_fd != -1)
+    {
+        close (dir_local_fd);
+        dir_local_fd = -1;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get information about the directory entry and the link target if entry is a symlink.
+ *
+ * @param name entry name relative to the directory being loaded
+ * @param buf1 entry info
+ * @param link_to_dir set to 1 if entry is a link to directory
+ * @param stale_link set to 1 if entry is a dangling link
+ * @return FALSE if lstat() failed
+ */
+
+static gboolean
+dir_entry_stat (const char *name, struct stat *buf1, int *link_to_dir, int *stale_link)
+{
+    struct stat buf2;
+    gboolean ret;
+
+    *link_to_dir = 0;
+    *stale_link = 0;
+
+#ifdef HAVE_FSTATAT
+    if (dir_local_fd != -1)
+    {
+        ret = fstatat (dir_local_fd, name, buf1, AT_SYMLINK_NOFOLLOW) == 0;
+        if (ret && S_ISLNK (buf1->st_mode))
+        {
+            if (fstatat (dir_local_fd, name, &buf2, 0) == 0)
+                *link_to_dir = S_ISDIR (buf2.st_mode) != 0;
+            else
+                *stale_link = 1;
+        }
+    }
+    else
+#endif
+    {
+        vfs_path_t *vpath;
+
+        vpath = vfs_path_from_str (name);
+        ret = mc_lstat (vpath, buf1) == 0;
+        if (ret && S_ISLNK (buf1->st_mode))
+        {
+            if (mc_stat (vpath, &buf2) == 0)
+                *link_to_dir = S_ISDIR (buf2.st_mode) != 0;
+            else
+                *stale_link = 1;
+        }
+        vfs_path_free (vpath);
+    }
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * If you change handle_dirent then check also handle_path.
@@ -164,11 +350,9 @@ grow_list (dir_list * list)
  */
 
 static int
-handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
+handle_dirent (dir_list * list, const char *fltr, mc_search_t * fltr_search, struct dirent *dp,
                struct stat *buf1, int next_free, int *link_to_dir, int *stale_link)
 {
-    vfs_path_t *vpath;
-
     if (dp->d_name[0] == '.' && dp->d_name[1] == 0)
         return 0;
     if (dp->d_name[0] == '.' && dp->d_name[1] == '.' && dp->d_name[2] == 0)
@@ -178,8 +362,7 @@ handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
     if (!panels_options.show_backups && dp->d_name[NLENGTH (dp) - 1] == '~')
         return 0;
 
-    vpath = vfs_path_from_str (dp->d_name);
-    if (mc_lstat (vpath, buf1) == -1)
+    if (!dir_entry_stat (dp->d_name, buf1, link_to_dir, stale_link))
     {
         /*
          * lstat() fails - such entries should be identified by
@@ -192,20 +375,8 @@ handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
     if (S_ISDIR (buf1->st_mode))
         tree_store_mark_checked (dp->d_name);
 
-    /* A link to a file or a directory? */
-    *link_to_dir = 0;
-    *stale_link = 0;
-    if (S_ISLNK (buf1->st_mode))
-    {
-        struct stat buf2;
-        if (mc_stat (vpath, &buf2) == 0)
-            *link_to_dir = S_ISDIR (buf2.st_mode) != 0;
-        else
-            *stale_link = 1;
-    }
-    vfs_path_free (vpath);
     if (!(S_ISDIR (buf1->st_mode) || *link_to_dir) && (fltr != NULL)
-        && !mc_search (fltr, dp->d_name, MC_SEARCH_T_GLOB))
+        && !mc_search_match_str (fltr_search, dp->d_name, NLENGTH (dp)))
         return 0;
 
     /* Need to grow the *list? */
@@ -215,6 +386,33 @@ handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
     return 1;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compile panel filter once for all directory entries.
+ *
+ * @param fltr filter glob, can be NULL
+ * @return compiled filter or NULL
+ */
+
+static mc_search_t *
+dir_filter_new (const char *fltr)
+{
+    mc_search_t *search;
+
+    if (fltr == NULL)
+        return NULL;
+
+    search = mc_search_new (fltr, -1);
+    if (search != NULL)
+    {
+        search->search_type = MC_SEARCH_T_GLOB;
+        search->is_case_sensitive = TRUE;
+        search->is_entire_line = TRUE;
+    }
+
+    return search;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** get info about ".." */
 
@@ -263,6 +461,94 @@ alloc_dir_copy (int size)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the directory entry from the previous listing can be reused as is.
+ */
+
+static gboolean
+dir_entry_unchanged (const file_entry * fe, const struct stat *st, int link_to_dir, int stale_link)
+{
+    return (fe->st.st_ino == st->st_ino && fe->st.st_dev == st->st_dev
+            && fe->st.st_mode == st->st_mode && fe->st.st_size == st->st_size
+            && fe->st.st_mtime == st->st_mtime && fe->st.st_ctime == st->st_ctime
+            && fe->st.st_atime == st->st_atime
+            && fe->f.link_to_dir == (unsigned int) link_to_dir
+            && fe->f.stale_link == (unsigned int) stale_link);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put reused entries into the order they had in the previous listing.
+ *
+ * @param list directory list
+ * @param first index of the first entry after ".."
+ * @param last index after the last entry
+ * @param old_order position of each entry in the previous listing
+ * @param count number of entries in the previous listing
+ * @return FALSE if the old order cannot be restored
+ */
+
+static gboolean
+restore_old_order (dir_list * list, int first, int last, const int *old_order, int count)
+{
+    file_entry *tmp;
+    int *pos;
+    int i, n;
+
+    if (last - first < 2)
+        return TRUE;
+
+    /* new position of every entry of the previous listing */
+    pos = g_new (int, count);
+    for (i = 0; i < count; i++)
+        pos[i] = -1;
+    for (i = first; i < last; i++)
+    {
+        if (old_order[i] < 0 || old_order[i] >= count)
+        {
+            g_free (pos);
+            return FALSE;
+        }
+        pos[old_order[i]] = i;
+    }
+
+    tmp = g_new (file_entry, last - first);
+    for (n = 0, i = 0; i < count; i++)
+        if (pos[i] != -1)
+            tmp[n++] = list->list[pos[i]];
+
+    memcpy (&list->list[first], tmp, sizeof (file_entry) * n);
+
+    g_free (tmp);
+    g_free (pos);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check that directory list is already in the requested order.
+ */
+
+static gboolean
+dir_list_is_sorted (dir_list * list, sortfn * sort, int first, int top, gboolean reverse_f,
+                    gboolean case_sensitive_f, gboolean exec_first_f)
+{
+    int i;
+
+    reverse = reverse_f ? -1 : 1;
+    case_sensitive = case_sensitive_f ? 1 : 0;
+    exec_first = exec_first_f;
+
+    prepare_sort_keys (list, first, top + 1 - first);
+
+    for (i = first; i < top; i++)
+        if (sort (&list->list[i], &list->list[i + 1]) > 0)
+            break;
+
+    return (i >= top);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -440,6 +726,9 @@ do_sort (dir_list * list, sortfn * sort, int top, gboolean reverse_f, gboolean c
          gboolean exec_first_f)
 {
     int dot_dot_found = 0;
+    int i, count;
+    file_entry **entries, **tmp;
+    file_entry *sorted;
 
     if (top == 0)
         return;
@@ -452,9 +741,26 @@ do_sort (dir_list * list, sortfn * sort, int top, gboolean reverse_f, gboolean c
     reverse = reverse_f ? -1 : 1;
     case_sensitive = case_sensitive_f ? 1 : 0;
     exec_first = exec_first_f;
-    qsort (&(list->list)[dot_dot_found], top + 1 - dot_dot_found, sizeof (file_entry), sort);
 
-    clean_sort_keys (list, dot_dot_found, top + 1 - dot_dot_found);
+    count = top + 1 - dot_dot_found;
+    prepare_sort_keys (list, dot_dot_found, count);
+
+    /* sort pointers and move the entries once */
+    entries = g_new (file_entry *, count);
+    tmp = g_new (file_entry *, count / 2 + 1);
+    for (i = 0; i < count; i++)
+        entries[i] = &list->list[dot_dot_found + i];
+
+    merge_sort (entries, tmp, count, sort);
+
+    sorted = g_new (file_entry, count);
+    for (i = 0; i < count; i++)
+        sorted[i] = *entries[i];
+    memcpy (&list->list[dot_dot_found], sorted, sizeof (file_entry) * count);
+
+    g_free (sorted);
+    g_free (tmp);
+    g_free (entries);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -465,10 +771,18 @@ clean_dir (dir_list * list, int count)
     int i;
 
     for (i = 0; i < count; i++)
-    {
-        g_free (list->list[i].fname);
-        list->list[i].fname = NULL;
-    }
+        clean_file_entry (&list->list[i]);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Release the name and sort keys of the directory entry */
+
+void
+clean_file_entry (file_entry * fe)
+{
+    release_sort_keys (fe);
+    g_free (fe->fname);
+    fe->fname = NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -505,37 +819,17 @@ int
 handle_path (dir_list * list, const char *path,
              struct stat *buf1, int next_free, int *link_to_dir, int *stale_link)
 {
-    vfs_path_t *vpath;
-
     if (path[0] == '.' && path[1] == 0)
         return 0;
     if (path[0] == '.' && path[1] == '.' && path[2] == 0)
         return 0;
 
-    vpath = vfs_path_from_str (path);
-    if (mc_lstat (vpath, buf1) == -1)
-    {
-        vfs_path_free (vpath);
+    if (!dir_entry_stat (path, buf1, link_to_dir, stale_link))
         return 0;
-    }
 
     if (S_ISDIR (buf1->st_mode))
         tree_store_mark_checked (path);
 
-    /* A link to a file or a directory? */
-    *link_to_dir = 0;
-    *stale_link = 0;
-    if (S_ISLNK (buf1->st_mode))
-    {
-        struct stat buf2;
-        if (mc_stat (vpath, &buf2) == 0)
-            *link_to_dir = S_ISDIR (buf2.st_mode) != 0;
-        else
-            *stale_link = 1;
-    }
-
-    vfs_path_free (vpath);
-
     /* Need to grow the *list? */
     if (next_free == list->size && !grow_list (list))
         return -1;
@@ -555,6 +849,7 @@ do_load_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, gboolean
     int next_free = 0;
     struct stat st;
     char *path;
+    mc_search_t *fltr_search;
 
     /* ".." (if any) must be the first entry in the list */
     if (!set_zero_dir (list))
@@ -572,6 +867,8 @@ do_load_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, gboolean
     }
 
     tree_store_start_check (vpath);
+    dir_local_stat_open (vpath);
+    fltr_search = dir_filter_new (fltr);
 
     /* Do not add a ".." entry to the root directory */
     path = vfs_path_to_str (vpath);
@@ -581,7 +878,8 @@ do_load_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, gboolean
 
     while ((dp = mc_readdir (dirp)) != NULL)
     {
-        status = handle_dirent (list, fltr, dp, &st, next_free, &link_to_dir, &stale_link);
+        status =
+            handle_dirent (list, fltr, fltr_search, dp, &st, next_free, &link_to_dir, &stale_link);
         if (status == 0)
             continue;
         if (status == -1)
@@ -596,6 +894,7 @@ do_load_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, gboolean
         list->list[next_free].st = st;
         list->list[next_free].sort_key = NULL;
         list->list[next_free].second_sort_key = NULL;
+        list->list[next_free].fhl_stamp = 0;
         next_free++;
 
         if ((next_free & 31) == 0)
@@ -606,6 +905,8 @@ do_load_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, gboolean
         do_sort (list, sort, next_free - 1, lc_reverse, lc_case_sensitive, exec_ff);
 
   ret:
+    mc_search_free (fltr_search);
+    dir_local_stat_close ();
     mc_closedir (dirp);
     tree_store_end_check ();
     return next_free;
@@ -634,10 +935,13 @@ do_reload_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, int cou
     DIR *dirp;
     struct dirent *dp;
     int next_free = 0;
+    int first;
     int i, status, link_to_dir, stale_link;
     struct stat st;
-    int marked_cnt;
-    GHashTable *marked_files;
+    GHashTable *old_files;
+    mc_search_t *fltr_search;
+    int *old_order;
+    int old_order_size;
     const char *tmp_path;
 
     dirp = mc_opendir (vpath);
@@ -649,26 +953,28 @@ do_reload_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, int cou
     }
 
     tree_store_start_check (vpath);
+    dir_local_stat_open (vpath);
+
+    dir_reload_stats.reused = 0;
+    dir_reload_stats.refreshed = 0;
+    dir_reload_stats.resorted = FALSE;
 
-    marked_files = g_hash_table_new (g_str_hash, g_str_equal);
+    /* Keep the old entries and index them by name to reuse unchanged ones */
+    old_files = g_hash_table_new (g_str_hash, g_str_equal);
     alloc_dir_copy (list->size);
-    for (marked_cnt = i = 0; i < count; i++)
+    for (i = 0; i < count; i++)
     {
-        dir_copy.list[i].fnamelen = list->list[i].fnamelen;
-        dir_copy.list[i].fname = list->list[i].fname;
-        dir_copy.list[i].f.marked = list->list[i].f.marked;
-        dir_copy.list[i].f.dir_size_computed = list->list[i].f.dir_size_computed;
-        dir_copy.list[i].f.link_to_dir = list->list[i].f.link_to_dir;
-        dir_copy.list[i].f.stale_link = list->list[i].f.stale_link;
-        dir_copy.list[i].sort_key = NULL;
-        dir_copy.list[i].second_sort_key = NULL;
-        if (list->list[i].f.marked)
-        {
-            g_hash_table_insert (marked_files, dir_copy.list[i].fname, &dir_copy.list[i]);
-            marked_cnt++;
-        }
+        dir_copy.list[i] = list->list[i];
+        if (strcmp (dir_copy.list[i].fname, "..") != 0)
+            g_hash_table_insert (old_files, dir_copy.list[i].fname, &dir_copy.list[i]);
     }
 
+    /* Position of every new entry in the old list, -1 for new or changed entries */
+    old_order_size = list->size;
+    old_order = g_new (int, old_order_size);
+
+    fltr_search = dir_filter_new (fltr);
+
     /* Add ".." except to the root directory. The ".." entry
        (if any) must be the first in the list. */
     tmp_path = vfs_path_get_by_index (vpath, 0)->path;
@@ -678,8 +984,12 @@ do_reload_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, int cou
     {
         if (!set_zero_dir (list))
         {
+            dir_local_stat_close ();
             clean_dir (list, count);
             clean_dir (&dir_copy, count);
+            g_hash_table_destroy (old_files);
+            g_free (old_order);
+            mc_search_free (fltr_search);
             return next_free;
         }
 
@@ -689,13 +999,19 @@ do_reload_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, int cou
         next_free++;
     }
 
+    first = next_free;
+
     while ((dp = mc_readdir (dirp)))
     {
-        status = handle_dirent (list, fltr, dp, &st, next_free, &link_to_dir, &stale_link);
+        file_entry *fentry, *old_entry;
+
+        status =
+            handle_dirent (list, fltr, fltr_search, dp, &st, next_free, &link_to_dir, &stale_link);
         if (status == 0)
             continue;
         if (status == -1)
         {
+            dir_local_stat_close ();
             mc_closedir (dirp);
             /* Norbert (Feb 12, 1997):
                Just in case someone finds this memory leak:
@@ -708,45 +1024,76 @@ do_reload_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, int cou
                clean_dir (&dir_copy, count);
              */
             tree_store_end_check ();
-            g_hash_table_destroy (marked_files);
+            g_hash_table_destroy (old_files);
+            g_free (old_order);
+            mc_search_free (fltr_search);
             return next_free;
         }
 
-        list->list[next_free].f.marked = 0;
+        if (next_free >= old_order_size)
+        {
+            old_order_size = list->size;
+            old_order = g_renew (int, old_order, old_order_size);
+        }
 
-        /*
-         * If we have marked files in the copy, scan through the copy
-         * to find matching file.  Decrease number of remaining marks if
-         * we copied one.
-         */
-        if (marked_cnt > 0)
+        fentry = &list->list[next_free];
+        old_entry = (file_entry *) g_hash_table_lookup (old_files, dp->d_name);
+
+        if (old_entry != NULL && dir_entry_unchanged (old_entry, &st, link_to_dir, stale_link))
         {
-            if ((g_hash_table_lookup (marked_files, dp->d_name)))
-            {
-                list->list[next_free].f.marked = 1;
-                marked_cnt--;
-            }
+            /* take the old record over together with its name, sort keys and marks */
+            *fentry = *old_entry;
+            old_entry->fname = NULL;
+            old_entry->sort_key = NULL;
+            old_entry->second_sort_key = NULL;
+            old_order[next_free] = old_entry - dir_copy.list;
+            dir_reload_stats.reused++;
+        }
+        else
+        {
+            fentry->fnamelen = NLENGTH (dp);
+            fentry->fname = g_strndup (dp->d_name, fentry->fnamelen);
+            fentry->f.marked = old_entry != NULL ? old_entry->f.marked : 0;
+            fentry->f.link_to_dir = link_to_dir;
+            fentry->f.stale_link = stale_link;
+            fentry->sort_key = NULL;
+            fentry->second_sort_key = NULL;
+            fentry->fhl_stamp = 0;
+            old_order[next_free] = -1;
+            dir_reload_stats.refreshed++;
         }
 
-        list->list[next_free].fnamelen = NLENGTH (dp);
-        list->list[next_free].fname = g_strndup (dp->d_name, list->list[next_free].fnamelen);
-        list->list[next_free].f.link_to_dir = link_to_dir;
-        list->list[next_free].f.stale_link = stale_link;
-        list->list[next_free].f.dir_size_computed = 0;
-        list->list[next_free].st = st;
-        list->list[next_free].sort_key = NULL;
-        list->list[next_free].second_sort_key = NULL;
+        fentry->f.dir_size_computed = 0;
+        fentry->st = st;
         next_free++;
         if (!(next_free % 16))
             rotate_dash ();
     }
+    dir_local_stat_close ();
     mc_closedir (dirp);
     tree_store_end_check ();
-    g_hash_table_destroy (marked_files);
-    if (next_free)
+    g_hash_table_destroy (old_files);
+    mc_search_free (fltr_search);
+
+    /* If nothing was added or changed, the old order is still valid
+       for the remaining entries: restore it instead of sorting again */
+    if (next_free != 0
+        && (dir_reload_stats.refreshed != 0
+            || !restore_old_order (list, first, next_free, old_order, count)
+            || !dir_list_is_sorted (list, sort, first, next_free - 1, lc_reverse,
+                                    lc_case_sensitive, exec_ff)))
     {
         do_sort (list, sort, next_free - 1, lc_reverse, lc_case_sensitive, exec_ff);
+        dir_reload_stats.resorted = TRUE;
     }
+
+#ifdef USE_MAINTAINER_MODE
+    mc_log ("reload dir: %d entries, %d reused, %d refreshed, %s\n", next_free,
+            dir_reload_stats.reused, dir_reload_stats.refreshed,
+            dir_reload_stats.resorted ? "sorted" : "order kept");
+#endif
+
+    g_free (old_order);
     clean_dir (&dir_copy, count);
     return next_free;
 }
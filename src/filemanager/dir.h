@@ -39,6 +39,7 @@ void do_sort (dir_list * list, sortfn * sort, int top, gboolean reverse,
 int do_reload_dir (const vfs_path_t * vpath, dir_list * list, sortfn * sort, int count,
                    gboolean reverse, gboolean case_sensitive, gboolean exec_ff, const char *fltr);
 void clean_dir (dir_list * list, int count);
+void clean_file_entry (file_entry * fe);
 gboolean set_zero_dir (dir_list * list);
 int handle_path (dir_list * list, const char *path, struct stat *buf1,
                  int next_free, int *link_to_dir, int *stale_link);
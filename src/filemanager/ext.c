@@ -42,6 +42,7 @@
 #include "lib/tty/tty.h"
 #include "lib/search.h"
 #include "lib/fileloc.h"
+#include "lib/filetype.h"
 #include "lib/mcconfig.h"
 #include "lib/util.h"
 #include "lib/vfs/vfs.h"
@@ -80,6 +81,33 @@
 
 typedef char *(*quote_func_t) (const char *name, int quote_percent);
 
+/* keywords of mc.ext sections */
+typedef enum
+{
+    EXT_RULE_REGEX,
+    EXT_RULE_DIRECTORY,
+    EXT_RULE_SHELL,
+    EXT_RULE_TYPE,
+    EXT_RULE_INCLUDE,
+    EXT_RULE_DEFAULT
+} ext_rule_type_t;
+
+/* an action of a section, e.g. "Open=%cd %p/utar://" */
+typedef struct
+{
+    char *name;                 /* name of action */
+    const char *command;        /* command in the mc.ext text, up to the end of line */
+} ext_action_t;
+
+/* a section of mc.ext: the keyword line and the following actions */
+typedef struct
+{
+    ext_rule_type_t type;
+    char *pattern;              /* the rest of the keyword line */
+    mc_search_t *search;        /* compiled pattern of regex/, directory/ and type/ */
+    GArray *actions;            /* ext_action_t */
+} ext_rule_t;
+
 /*** file scope variables ************************************************************************/
 
 /* This variable points to a copy of the mc.ext file in memory
@@ -87,6 +115,15 @@ typedef char *(*quote_func_t) (const char *name, int quote_percent);
  * need it
  */
 static char *data = NULL;
+/* name and modification time of the loaded file */
+static char *data_file_name = NULL;
+static time_t data_file_mtime = 0;
+/* sections of the file, ext_rule_t */
+static GArray *ext_rules = NULL;
+/* names and suffixes of shell/ sections -> GSList of section numbers */
+static GHashTable *ext_shell = NULL;
+static GHashTable *ext_shell_nocase = NULL;
+
 static vfs_path_t *localfilecopy_vpath = NULL;
 static char buffer[BUF_1K];
 
@@ -606,16 +643,36 @@ get_file_encoding_local (const vfs_path_t * filename_vpath, char *buf, int bufle
 #endif /* HAVE_CHARSET */
 
 /* --------------------------------------------------------------------------------------------- */
+#ifdef HAVE_CHARSET
 /**
- * Invoke the "file" command on the file and match its output against PTR.
+ * Switch the viewer and editor to the detected encoding of the file.
+ */
+
+static void
+ext_set_codepage (const char *encoding)
+{
+    int cp_id;
+
+    cp_id = get_codepage_index (encoding);
+    if (cp_id == -1)
+        cp_id = default_source_codepage;
+
+    do_set_codepage (cp_id);
+}
+#endif /* HAVE_CHARSET */
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Determine the type of the file, with the built-in detector or the "file" command,
+ * and match it against SEARCH.
  * have_type is a flag that is set if we already have tried to determine
  * the type of that file.
  * Return 1 for match, 0 for no match, -1 errors.
  */
 
 static gboolean
-regex_check_type (const vfs_path_t * filename_vpath, const char *ptr, int *have_type,
-                  gboolean case_insense, GError ** error)
+regex_check_type (const vfs_path_t * filename_vpath, mc_search_t * search, int *have_type,
+                  GError ** error)
 {
     gboolean found = FALSE;
 
@@ -632,87 +689,113 @@ regex_check_type (const vfs_path_t * filename_vpath, const char *ptr, int *have_
 
     if (*have_type == 0)
     {
-        vfs_path_t *localfile_vpath;
-        const char *realname;   /* name used with "file" */
-
-#ifdef HAVE_CHARSET
-        int got_encoding_data;
-#endif /* HAVE_CHARSET */
+        const char *known_type;
+        gboolean need_type, need_encoding = FALSE;
 
         /* Don't repeate even unsuccessful checks */
         *have_type = 1;
 
-        localfile_vpath = mc_getlocalcopy (filename_vpath);
-        if (localfile_vpath == NULL)
+        /* Try the built-in detector first: it knows common formats and caches the results */
+        known_type = mc_filetype_get (filename_vpath);
+        need_type = (known_type == NULL);
+        if (!need_type)
         {
-            char *filename;
-
-            filename = vfs_path_to_str (filename_vpath);
-            g_propagate_error (error,
-                               g_error_new (MC_ERROR, -1,
-                                            _("Cannot fetch a local copy of %s"), filename));
-            g_free (filename);
-            return FALSE;
+            g_strlcpy (content_string, known_type, sizeof (content_string));
+            content_shift = 0;
+            got_data = 1;
         }
 
-        realname = vfs_path_get_last_path_str (localfile_vpath);
-
 #ifdef HAVE_CHARSET
-        got_encoding_data = is_autodetect_codeset_enabled
-            ? get_file_encoding_local (localfile_vpath, encoding_id, sizeof (encoding_id)) : 0;
+        if (is_autodetect_codeset_enabled)
+        {
+            const char *known_encoding;
+
+            known_encoding = mc_filetype_get_encoding (filename_vpath);
+            need_encoding = (known_encoding == NULL);
+            if (!need_encoding)
+                ext_set_codepage (known_encoding);
+        }
+#endif /* HAVE_CHARSET */
 
-        if (got_encoding_data > 0)
+        if (need_type || need_encoding)
         {
-            char *pp;
-            int cp_id;
+            vfs_path_t *localfile_vpath;
+            const char *realname;       /* name used with "file" */
+
+            localfile_vpath = mc_getlocalcopy (filename_vpath);
+            if (localfile_vpath == NULL)
+            {
+                char *filename;
+
+                filename = vfs_path_to_str (filename_vpath);
+                g_propagate_error (error,
+                                   g_error_new (MC_ERROR, -1,
+                                                _("Cannot fetch a local copy of %s"), filename));
+                g_free (filename);
+                return FALSE;
+            }
 
-            pp = strchr (encoding_id, '\n');
-            if (pp != NULL)
-                *pp = '\0';
+            realname = vfs_path_get_last_path_str (localfile_vpath);
 
-            cp_id = get_codepage_index (encoding_id);
-            if (cp_id == -1)
-                cp_id = default_source_codepage;
+#ifdef HAVE_CHARSET
+            if (need_encoding
+                && get_file_encoding_local (localfile_vpath, encoding_id,
+                                            sizeof (encoding_id)) > 0)
+            {
+                char *pp;
 
-            do_set_codepage (cp_id);
-        }
+                pp = strchr (encoding_id, '\n');
+                if (pp != NULL)
+                    *pp = '\0';
+
+                ext_set_codepage (encoding_id);
+                mc_filetype_set_encoding (filename_vpath, encoding_id);
+            }
 #endif /* HAVE_CHARSET */
 
-        mc_ungetlocalcopy (filename_vpath, localfile_vpath, FALSE);
+            mc_ungetlocalcopy (filename_vpath, localfile_vpath, FALSE);
 
-        got_data = get_file_type_local (localfile_vpath, content_string, sizeof (content_string));
+            if (need_type)
+            {
+                got_data =
+                    get_file_type_local (localfile_vpath, content_string, sizeof (content_string));
 
-        if (got_data > 0)
-        {
-            char *pp;
-            size_t real_len;
+                if (got_data > 0)
+                {
+                    char *pp;
+                    size_t real_len;
 
-            pp = strchr (content_string, '\n');
-            if (pp != NULL)
-                *pp = '\0';
+                    pp = strchr (content_string, '\n');
+                    if (pp != NULL)
+                        *pp = '\0';
 
-            real_len = strlen (realname);
+                    real_len = strlen (realname);
+                    content_shift = 0;
 
-            if (strncmp (content_string, realname, real_len) == 0)
-            {
-                /* Skip "realname: " */
-                content_shift = real_len;
-                if (content_string[content_shift] == ':')
+                    if (strncmp (content_string, realname, real_len) == 0)
+                    {
+                        /* Skip "realname: " */
+                        content_shift = real_len;
+                        if (content_string[content_shift] == ':')
+                        {
+                            /* Solaris' file prints tab(s) after ':' */
+                            for (content_shift++;
+                                 content_string[content_shift] == ' '
+                                 || content_string[content_shift] == '\t'; content_shift++)
+                                ;
+                        }
+                    }
+
+                    mc_filetype_set (filename_vpath, content_string + content_shift);
+                }
+                else
                 {
-                    /* Solaris' file prints tab(s) after ':' */
-                    for (content_shift++;
-                         content_string[content_shift] == ' '
-                         || content_string[content_shift] == '\t'; content_shift++)
-                        ;
+                    /* No data */
+                    content_string[0] = '\0';
                 }
             }
+            vfs_path_free (localfile_vpath);
         }
-        else
-        {
-            /* No data */
-            content_string[0] = '\0';
-        }
-        vfs_path_free (localfile_vpath);
     }
 
     if (got_data == -1)
@@ -723,22 +806,228 @@ regex_check_type (const vfs_path_t * filename_vpath, const char *ptr, int *have_
 
     if (content_string[0] != '\0')
     {
-        mc_search_t *search;
-
-        search = mc_search_new (ptr, -1);
         if (search != NULL)
+            found = mc_search_match_str (search, content_string + content_shift,
+                                         strlen (content_string + content_shift));
+        else
+            g_propagate_error (error, g_error_new (MC_ERROR, -1, _("Regular expression error")));
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_rule_free (ext_rule_t * rule)
+{
+    guint i;
+
+    for (i = 0; i < rule->actions->len; i++)
+        g_free (g_array_index (rule->actions, ext_action_t, i).name);
+    g_array_free (rule->actions, TRUE);
+    mc_search_free (rule->search);
+    g_free (rule->pattern);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+ext_compile_search (const char *pattern, gboolean case_insense)
+{
+    mc_search_t *search;
+
+    search = mc_search_new (pattern, -1);
+    if (search != NULL)
+    {
+        search->search_type = MC_SEARCH_T_REGEX;
+        search->is_case_sensitive = !case_insense;
+    }
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_compile_shell (const char *pattern, gboolean case_insense, guint rule)
+{
+    GHashTable **table;
+    GSList *rules;
+    char *key;
+
+    table = case_insense ? &ext_shell_nocase : &ext_shell;
+    if (*table == NULL)
+        *table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify) g_slist_free);
+
+    key = case_insense ? g_ascii_strdown (pattern, -1) : g_strdup (pattern);
+    rules = (GSList *) g_hash_table_lookup (*table, key);
+    if (rules != NULL)
+    {
+        rules = g_slist_append (rules, GUINT_TO_POINTER (rule));
+        g_free (key);
+    }
+    else
+        g_hash_table_insert (*table, key, g_slist_prepend (NULL, GUINT_TO_POINTER (rule)));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split the text of mc.ext into sections and compile their patterns.
+ *
+ * @param file_name name of the file the text was loaded from, owned by the compiled data
+ */
+
+static void
+ext_compile (char *file_name)
+{
+    struct stat st;
+    ext_rule_t *rule = NULL;
+    const char *p;
+
+    data_file_name = file_name;
+    data_file_mtime = stat (file_name, &st) == 0 ? st.st_mtime : 0;
+
+    ext_rules = g_array_new (FALSE, FALSE, sizeof (ext_rule_t));
+
+    for (p = data; *p != '\0'; p = *p == '\n' ? p + 1 : p)
+    {
+        const char *q, *eol;
+        char *line;
+        gboolean case_insense;
+        ext_rule_t r;
+
+        eol = strchr (p, '\n');
+        if (eol == NULL)
+            eol = strchr (p, '\0');
+
+        for (q = p; *q == ' ' || *q == '\t'; q++)
+            ;
+
+        /* empty line or comment */
+        if (q == eol || *p == '#')
+        {
+            p = eol;
+            continue;
+        }
+
+        if (p != q)
+        {
+            /* action of the current section */
+            const char *eq;
+
+            eq = memchr (q, '=', eol - q);
+            if (rule != NULL && eq != NULL)
+            {
+                ext_action_t action;
+
+                action.name = g_strndup (q, eq - q);
+                action.command = eq + 1;
+                g_array_append_val (rule->actions, action);
+            }
+            p = eol;
+            continue;
+        }
+
+        /* keyword line starts in the first column */
+        line = g_strndup (p, eol - p);
+        p = eol;
+
+        memset (&r, 0, sizeof (r));
+        if (strncmp (line, "regex/", 6) == 0)
+        {
+            r.type = EXT_RULE_REGEX;
+            case_insense = (strncmp (line + 6, "i/", 2) == 0);
+            r.pattern = g_strdup (line + (case_insense ? 8 : 6));
+            r.search = ext_compile_search (r.pattern, case_insense);
+        }
+        else if (strncmp (line, "directory/", 10) == 0)
+        {
+            r.type = EXT_RULE_DIRECTORY;
+            r.pattern = g_strdup (line + 10);
+            r.search = ext_compile_search (r.pattern, FALSE);
+        }
+        else if (strncmp (line, "shell/", 6) == 0)
+        {
+            r.type = EXT_RULE_SHELL;
+            case_insense = (strncmp (line + 6, "i/", 2) == 0);
+            r.pattern = g_strdup (line + (case_insense ? 8 : 6));
+            ext_compile_shell (r.pattern, case_insense, ext_rules->len);
+        }
+        else if (strncmp (line, "type/", 5) == 0)
+        {
+            r.type = EXT_RULE_TYPE;
+            case_insense = (strncmp (line + 5, "i/", 2) == 0);
+            r.pattern = g_strdup (line + (case_insense ? 7 : 5));
+            r.search = ext_compile_search (r.pattern, case_insense);
+        }
+        else if (strncmp (line, "include/", 8) == 0)
         {
-            search->search_type = MC_SEARCH_T_REGEX;
-            search->is_case_sensitive = !case_insense;
-            found = mc_search_run (search, content_string + content_shift, 0, -1, NULL);
-            mc_search_free (search);
+            r.type = EXT_RULE_INCLUDE;
+            r.pattern = g_strdup (line + 8);
         }
+        else if (strncmp (line, "default/", 8) == 0)
+            r.type = EXT_RULE_DEFAULT;
         else
         {
-            g_propagate_error (error, g_error_new (MC_ERROR, -1, _("Regular expression error")));
+            /* unknown keyword: its actions are never used */
+            g_free (line);
+            rule = NULL;
+            continue;
         }
+        g_free (line);
+
+        r.actions = g_array_new (FALSE, FALSE, sizeof (ext_action_t));
+        g_array_append_val (ext_rules, r);
+        rule = &g_array_index (ext_rules, ext_rule_t, ext_rules->len - 1);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_shell_mark (GHashTable * table, const char *key, gboolean * found)
+{
+    GSList *l;
+
+    for (l = (GSList *) g_hash_table_lookup (table, key); l != NULL; l = g_slist_next (l))
+        found[GPOINTER_TO_UINT (l->data)] = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find shell/ sections matching the file name. Patterns starting with a dot are suffixes
+ * of the name, other patterns are whole names.
+ *
+ * @return newly allocated array of flags, one per section
+ */
+
+static gboolean *
+ext_shell_match (const char *filename, size_t file_len)
+{
+    gboolean *found;
+    char *folded = NULL;
+    const char *dot;
+
+    found = g_new0 (gboolean, ext_rules->len);
+
+    if (ext_shell_nocase != NULL)
+        folded = g_ascii_strdown (filename, file_len);
+
+    if (ext_shell != NULL)
+        ext_shell_mark (ext_shell, filename, found);
+    if (folded != NULL)
+        ext_shell_mark (ext_shell_nocase, folded, found);
+
+    for (dot = strchr (filename, '.'); dot != NULL; dot = strchr (dot + 1, '.'))
+    {
+        if (ext_shell != NULL)
+            ext_shell_mark (ext_shell, dot, found);
+        if (folded != NULL)
+            ext_shell_mark (ext_shell_nocase, folded + (dot - filename), found);
     }
 
+    g_free (folded);
     return found;
 }
 
@@ -749,8 +1038,35 @@ regex_check_type (const vfs_path_t * filename_vpath, const char *ptr, int *have_
 void
 flush_extension_file (void)
 {
+    if (ext_rules != NULL)
+    {
+        guint i;
+
+        for (i = 0; i < ext_rules->len; i++)
+            ext_rule_free (&g_array_index (ext_rules, ext_rule_t, i));
+        g_array_free (ext_rules, TRUE);
+        ext_rules = NULL;
+    }
+
+    if (ext_shell != NULL)
+    {
+        g_hash_table_destroy (ext_shell);
+        ext_shell = NULL;
+    }
+
+    if (ext_shell_nocase != NULL)
+    {
+        g_hash_table_destroy (ext_shell_nocase);
+        ext_shell_nocase = NULL;
+    }
+
+    g_free (data_file_name);
+    data_file_name = NULL;
     g_free (data);
     data = NULL;
+
+    /* cached file types are freed together with the rules */
+    mc_filetype_flush ();
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -770,16 +1086,18 @@ flush_extension_file (void)
 int
 regex_command (const vfs_path_t * filename_vpath, const char *action)
 {
-    char *filename, *p, *q, *r, c;
+    char *filename;
     size_t file_len;
-    gboolean found = FALSE;
+    gboolean *shell_found;
     gboolean error_flag = FALSE;
+    gboolean done = FALSE;
     int ret = 0;
     struct stat mystat;
     int view_at_line_number;
-    char *include_target;
-    int include_target_len;
+    const char *include_target;
+    size_t include_target_len;
     int have_type = 0;          /* Flag used by regex_check_type() */
+    guint i;
 
     if (filename_vpath == NULL)
         return 0;
@@ -795,6 +1113,15 @@ regex_command (const vfs_path_t * filename_vpath, const char *action)
         view_at_line_number = 0;
     }
 
+    /* Reload the file if it was changed since it was compiled */
+    if (data != NULL && data_file_name != NULL)
+    {
+        struct stat st;
+
+        if (stat (data_file_name, &st) != 0 || st.st_mtime != data_file_mtime)
+            flush_extension_file ();
+    }
+
     if (data == NULL)
     {
         char *extension_file;
@@ -816,9 +1143,11 @@ regex_command (const vfs_path_t * filename_vpath, const char *action)
         }
 
         g_file_get_contents (extension_file, &data, NULL, NULL);
-        g_free (extension_file);
         if (data == NULL)
+        {
+            g_free (extension_file);
             return 0;
+        }
 
         if (strstr (data, "default/") == NULL)
         {
@@ -827,6 +1156,7 @@ regex_command (const vfs_path_t * filename_vpath, const char *action)
             {
                 g_free (data);
                 data = NULL;
+                g_free (extension_file);
 
                 if (!mc_user_ext)
                 {
@@ -863,6 +1193,8 @@ regex_command (const vfs_path_t * filename_vpath, const char *action)
             g_free (filebind_filename);
             g_free (title);
         }
+
+        ext_compile (extension_file);
     }
 
     mc_stat (filename_vpath, &mystat);
@@ -871,169 +1203,91 @@ regex_command (const vfs_path_t * filename_vpath, const char *action)
     include_target_len = 0;
     filename = vfs_path_to_str (filename_vpath);
     file_len = vfs_path_len (filename_vpath);
+    shell_found = ext_shell_match (filename, file_len);
 
-    for (p = data; *p != '\0'; p++)
+    /* The first section which matches the file and has the action wins */
+    for (i = 0; i < ext_rules->len && !done && !error_flag; i++)
     {
-        for (q = p; *q == ' ' || *q == '\t'; q++)
-            ;
-        if (*q == '\n' || *q == '\0')
-            p = q;              /* empty line */
-        if (*p == '#')          /* comment */
-            while (*p != '\0' && *p != '\n')
-                p++;
-        if (*p == '\n')
-            continue;
-        if (*p == '\0')
-            break;
-        if (p == q)
-        {                       /* i.e. starts in the first column, should be
-                                 * keyword/descNL
-                                 */
-            gboolean case_insense;
-
-            found = FALSE;
-            q = strchr (p, '\n');
-            if (q == NULL)
-                q = strchr (p, '\0');
-            c = *q;
-            *q = '\0';
-            if (include_target)
-            {
-                if ((strncmp (p, "include/", 8) == 0)
-                    && (strncmp (p + 8, include_target, include_target_len) == 0))
-                    found = TRUE;
-            }
-            else if (strncmp (p, "regex/", 6) == 0)
-            {
-                mc_search_t *search;
+        ext_rule_t *rule;
+        gboolean found = FALSE;
+        guint j;
 
-                p += 6;
-                case_insense = (strncmp (p, "i/", 2) == 0);
-                if (case_insense)
-                    p += 2;
+        rule = &g_array_index (ext_rules, ext_rule_t, i);
 
-                search = mc_search_new (p, -1);
-                if (search != NULL)
-                {
-                    search->search_type = MC_SEARCH_T_REGEX;
-                    search->is_case_sensitive = !case_insense;
-                    found = mc_search_run (search, filename, 0, file_len, NULL);
-                    mc_search_free (search);
-                }
-            }
-            else if (strncmp (p, "directory/", 10) == 0)
-            {
-                if (S_ISDIR (mystat.st_mode) && mc_search (p + 10, filename, MC_SEARCH_T_REGEX))
-                    found = TRUE;
-            }
-            else if (strncmp (p, "shell/", 6) == 0)
+        if (include_target != NULL)
+            found = rule->type == EXT_RULE_INCLUDE
+                && strncmp (rule->pattern, include_target, include_target_len) == 0;
+        else
+            switch (rule->type)
             {
-                int (*cmp_func) (const char *s1, const char *s2, size_t n) = strncmp;
-
-                p += 6;
-                case_insense = (strncmp (p, "i/", 2) == 0);
-                if (case_insense)
+            case EXT_RULE_REGEX:
+                found = mc_search_match_str (rule->search, filename, file_len);
+                break;
+            case EXT_RULE_DIRECTORY:
+                found = S_ISDIR (mystat.st_mode)
+                    && mc_search_match_str (rule->search, filename, strlen (filename));
+                break;
+            case EXT_RULE_SHELL:
+                found = shell_found[i];
+                break;
+            case EXT_RULE_TYPE:
                 {
-                    p += 2;
-                    cmp_func = strncasecmp;
-                }
+                    GError *error = NULL;
 
-                if (*p == '.' && file_len >= (size_t) (q - p))
-                {
-                    if (cmp_func (p, filename + file_len - (q - p), q - p) == 0)
-                        found = TRUE;
-                }
-                else
-                {
-                    if ((size_t) (q - p) == file_len && cmp_func (p, filename, q - p) == 0)
-                        found = TRUE;
+                    found = regex_check_type (filename_vpath, rule->search, &have_type, &error);
+                    if (error != NULL)
+                    {
+                        g_error_free (error);
+                        error_flag = TRUE;      /* leave it if file cannot be opened */
+                    }
                 }
+                break;
+            case EXT_RULE_DEFAULT:
+                found = TRUE;
+                break;
+            default:
+                break;
             }
-            else if (strncmp (p, "type/", 5) == 0)
-            {
-                GError *error = NULL;
 
-                p += 5;
+        if (!found || error_flag)
+            continue;
 
-                case_insense = (strncmp (p, "i/", 2) == 0);
-                if (case_insense)
-                    p += 2;
+        for (j = 0; j < rule->actions->len; j++)
+        {
+            const ext_action_t *a;
 
-                found = regex_check_type (filename_vpath, p, &have_type, case_insense, &error);
-                if (error != NULL)
-                {
-                    g_error_free (error);
-                    error_flag = TRUE;  /* leave it if file cannot be opened */
-                }
-            }
-            else if (strncmp (p, "default/", 8) == 0)
-                found = TRUE;
+            a = &g_array_index (rule->actions, ext_action_t, j);
 
-            *q = c;
-            p = q;
-            if (*p == '\0')
-                break;
-        }
-        else
-        {                       /* List of actions */
-            p = q;
-            q = strchr (p, '\n');
-            if (q == NULL)
-                q = strchr (p, '\0');
-            if (found && !error_flag)
+            if (strcmp (a->name, "Include") == 0)
             {
-                r = strchr (p, '=');
-                if (r != NULL)
-                {
-                    c = *r;
-                    *r = '\0';
-                    if (strcmp (p, "Include") == 0)
-                    {
-                        char *t;
-
-                        include_target = p + 8;
-                        t = strchr (include_target, '\n');
-                        if (t != NULL)
-                            *t = '\0';
-                        include_target_len = strlen (include_target);
-                        if (t != NULL)
-                            *t = '\n';
-
-                        *r = c;
-                        p = q;
-                        found = FALSE;
-
-                        if (*p == '\0')
-                            break;
-                        continue;
-                    }
+                /* continue with the include/ sections of this name */
+                include_target = a->command;
+                include_target_len = strcspn (include_target, "\n");
+                break;
+            }
 
-                    if (strcmp (action, p) != 0)
-                        *r = c;
-                    else
-                    {
-                        *r = c;
+            if (strcmp (a->name, action) == 0)
+            {
+                const char *p;
 
-                        for (p = r + 1; *p == ' ' || *p == '\t'; p++)
-                            ;
+                for (p = a->command; *p == ' ' || *p == '\t'; p++)
+                    ;
 
-                        /* Empty commands just stop searching
-                         * through, they don't do anything
-                         */
-                        if (p < q)
-                        {
-                            exec_extension (filename_vpath, r + 1, view_at_line_number);
-                            ret = 1;
-                        }
-                        break;
-                    }
+                /* Empty commands just stop searching
+                 * through, they don't do anything
+                 */
+                if (*p != '\n' && *p != '\0')
+                {
+                    exec_extension (filename_vpath, a->command, view_at_line_number);
+                    ret = 1;
                 }
-            }
-            p = q;
-            if (*p == '\0')
+                done = TRUE;
                 break;
+            }
         }
     }
+
+    g_free (shell_found);
     g_free (filename);
     if (error_flag)
         ret = -1;
@@ -36,6 +36,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include "lib/global.h"
 
@@ -64,6 +65,12 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* Initial size of the buffer for reading files in search_content() */
+#define SEARCH_CONTENT_BUF_SIZE (64 * 1024)
+
+/* Time slice of one do_search() call, in microseconds */
+#define FIND_IDLE_SLICE_USEC 20000
+
 /*** file scope type declarations ****************************************************************/
 
 /* A couple of extra messages we need */
@@ -144,13 +151,14 @@ static char *content_pattern = NULL;    /* pattern to search inside files; if
                                            content_regexp_flag is true, it contains the
                                            regex pattern, else the search string. */
 static unsigned long matches;   /* Number of matches */
+static gboolean matches_shown = TRUE;   /* Found list and counter are up to date */
 static gboolean is_start = FALSE;       /* Status of the start/stop toggle button */
 static char *old_dir = NULL;
 
 /* Where did we stop */
 static int resuming;
 static int last_line;
-static int last_pos;
+static off_t last_pos;
 
 static size_t ignore_count = 0;
 
@@ -922,66 +930,25 @@ find_add_match (const char *dir, const char *file)
     /* Don't scroll */
     if (matches == 0)
         listbox_select_first (find_list);
-    send_message (find_list, NULL, MSG_DRAW, 0, NULL);
 
     matches++;
-    found_num_update ();
+    matches_shown = FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * get_line_at:
- *
- * Returns malloced null-terminated line from file file_fd.
- * Input is buffered in buf_size long buffer.
- * Current pos in buf is stored in pos.
- * n_read - number of read chars.
- * has_newline - is there newline ?
+ * Redraw the found list and counter once for all matches added since last call.
  */
 
-static char *
-get_line_at (int file_fd, char *buf, int buf_size, int *pos, int *n_read, gboolean * has_newline)
+static void
+find_show_matches (void)
 {
-    char *buffer = NULL;
-    int buffer_size = 0;
-    char ch = 0;
-    int i = 0;
-
-    while (TRUE)
+    if (!matches_shown)
     {
-        if (*pos >= *n_read)
-        {
-            *pos = 0;
-            *n_read = mc_read (file_fd, buf, buf_size);
-            if (*n_read <= 0)
-                break;
-        }
-
-        ch = buf[(*pos)++];
-        if (ch == '\0')
-        {
-            /* skip possible leading zero(s) */
-            if (i == 0)
-                continue;
-            break;
-        }
-
-        if (i >= buffer_size - 1)
-            buffer = g_realloc (buffer, buffer_size += 80);
-
-        /* Strip newline */
-        if (ch == '\n')
-            break;
-
-        buffer[i++] = ch;
+        send_message (find_list, NULL, MSG_DRAW, 0, NULL);
+        found_num_update ();
+        matches_shown = TRUE;
     }
-
-    *has_newline = (ch != '\0');
-
-    if (buffer != NULL)
-        buffer[i] = '\0';
-
-    return buffer;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1057,12 +1024,14 @@ search_content (WDialog * h, const char *directory, const char *filename)
 
     {
         int line = 1;
-        int pos = 0;
-        int n_read = 0;
-        gboolean has_newline;
-        char *p = NULL;
+        unsigned int segments = 0;
+        char *buf;
+        size_t buf_size = SEARCH_CONTENT_BUF_SIZE;
+        size_t len = 0;         /* number of bytes in buf */
+        size_t pos = 0;         /* start of the current line in buf */
+        off_t buf_offset = 0;   /* file offset of buf[0] */
+        gboolean eof = FALSE;
         gboolean found = FALSE;
-        gsize found_len;
         char result[BUF_MEDIUM];
 
         if (resuming)
@@ -1070,21 +1039,75 @@ search_content (WDialog * h, const char *directory, const char *filename)
             /* We've been previously suspended, start from the previous position */
             resuming = 0;
             line = last_line;
-            pos = last_pos;
+            buf_offset = mc_lseek (file_fd, last_pos, SEEK_SET);
+            if (buf_offset == -1)
+                buf_offset = 0;
         }
-        while (!ret_val
-               && (p = get_line_at (file_fd, buffer, sizeof (buffer),
-                                    &pos, &n_read, &has_newline)) != NULL)
+
+        buf = g_malloc (buf_size);
+
+        /* Lines are searched in place in the buffer. Like newline, null character terminates
+           the line, but doesn't increase the line number. */
+        while (!ret_val)
         {
+            char *eol, *nul;
+            size_t line_len;
+            gboolean has_newline;
+
+            eol = memchr (buf + pos, '\n', len - pos);
+            nul = memchr (buf + pos, '\0', (eol != NULL ? (size_t) (eol - buf) : len) - pos);
+
+            if (eol == NULL && nul == NULL && !eof)
+            {
+                ssize_t n_read;
+
+                /* move the incomplete line to the beginning of the buffer and read more */
+                if (pos != 0)
+                {
+                    memmove (buf, buf + pos, len - pos);
+                    buf_offset += pos;
+                    len -= pos;
+                    pos = 0;
+                }
+                if (len == buf_size)
+                {
+                    buf_size *= 2;
+                    buf = g_realloc (buf, buf_size);
+                }
+
+                n_read = mc_read (file_fd, buf + len, buf_size - len);
+                if (n_read <= 0)
+                    eof = TRUE;
+                else
+                    len += (size_t) n_read;
+                continue;
+            }
+
+            if (nul != NULL)
+                eol = nul;
+            else if (eol == NULL)
+            {
+                /* the last line without newline */
+                if (pos >= len)
+                    break;
+                eol = buf + len;
+            }
+
+            line_len = eol - (buf + pos);
+            has_newline = (nul == NULL && eol != buf + len);
+
             if (!found          /* Search in binary line once */
-                && mc_search_run (search_content_handle,
-                                  (const void *) p, 0, strlen (p), &found_len))
+                && line_len != 0
+                && mc_search_match_str (search_content_handle, buf + pos, line_len))
             {
                 g_snprintf (result, sizeof (result), "%d:%s", line, filename);
                 find_add_match (directory, result);
                 found = TRUE;
             }
-            g_free (p);
+
+            pos += line_len;
+            if (pos < len)
+                pos++;          /* skip line terminator */
 
             if (found && options.content_first_hit)
                 break;
@@ -1095,9 +1118,11 @@ search_content (WDialog * h, const char *directory, const char *filename)
                 line++;
             }
 
-            if ((line & 0xff) == 0)
+            if ((++segments & 0xff) == 0)
             {
                 FindProgressStatus res;
+
+                find_show_matches ();
                 res = check_find_events (h);
                 switch (res)
                 {
@@ -1108,7 +1133,7 @@ search_content (WDialog * h, const char *directory, const char *filename)
                 case FIND_SUSPEND:
                     resuming = 1;
                     last_line = line;
-                    last_pos = pos;
+                    last_pos = buf_offset + (off_t) pos;
                     ret_val = TRUE;
                     break;
                 default:
@@ -1116,6 +1141,8 @@ search_content (WDialog * h, const char *directory, const char *filename)
                 }
             }
         }
+
+        g_free (buf);
     }
     tty_disable_interrupt_key ();
     mc_close (file_fd);
@@ -1202,6 +1229,53 @@ find_rotate_dash (const WDialog * h, gboolean finish)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether directory entry is a subdirectory to descend into.
+ * The entry type reported by readdir() is used if known, so stat() is called
+ * only for entries of unknown type.
+ *
+ * @return path to the subdirectory (should be freed by caller), NULL if entry is not a directory
+ */
+
+static vfs_path_t *
+find_subdir_vpath (const char *directory, const struct dirent *dp)
+{
+    vfs_path_t *vpath;
+    struct stat st;
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+    if (dp->d_type != DT_UNKNOWN && dp->d_type != DT_DIR)
+        return NULL;
+#endif
+
+    vpath = vfs_path_build_filename (directory, dp->d_name, (char *) NULL);
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+    if (dp->d_type == DT_DIR)
+        return vpath;
+#endif
+
+    if (mc_lstat (vpath, &st) == 0 && S_ISDIR (st.st_mode))
+        return vpath;
+
+    vfs_path_free (vpath);
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+find_slice_expired (const struct timeval *tv_start)
+{
+    struct timeval tv;
+    long usec;
+
+    gettimeofday (&tv, NULL);
+    usec = (tv.tv_sec - tv_start->tv_sec) * G_USEC_PER_SEC + (tv.tv_usec - tv_start->tv_usec);
+    return (usec < 0 || usec >= FIND_IDLE_SLICE_USEC);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -1212,8 +1286,8 @@ do_search (WDialog * h)
     static char *directory = NULL;
     struct stat tmp_stat;
     static int subdirs_left = 0;
-    gsize bytes_found;
-    unsigned short count;
+    struct timeval tv_start;
+    unsigned int count;
 
     if (h == NULL)
     {                           /* someone forces me to close dirp */
@@ -1228,7 +1302,10 @@ do_search (WDialog * h)
         return 1;
     }
 
-    for (count = 0; count < 32; count++)
+    gettimeofday (&tv_start, NULL);
+
+    /* process directory entries until time slice is over, check time every 32 entries */
+    for (count = 1;; count++)
     {
         while (dp == NULL)
         {
@@ -1331,20 +1408,16 @@ do_search (WDialog * h)
                 {
                     vfs_path_t *tmp_vpath;
 
-                    tmp_vpath = vfs_path_build_filename (directory, dp->d_name, (char *) NULL);
-
-                    if (mc_lstat (tmp_vpath, &tmp_stat) == 0 && S_ISDIR (tmp_stat.st_mode))
+                    tmp_vpath = find_subdir_vpath (directory, dp);
+                    if (tmp_vpath != NULL)
                     {
                         push_directory (tmp_vpath);
                         subdirs_left--;
                     }
-                    else
-                        vfs_path_free (tmp_vpath);
                 }
             }
 
-            search_ok = mc_search_run (search_file_handle, dp->d_name,
-                                       0, strlen (dp->d_name), &bytes_found);
+            search_ok = mc_search_match_str (search_file_handle, dp->d_name, NLENGTH (dp));
 
             if (search_ok)
             {
@@ -1358,6 +1431,9 @@ do_search (WDialog * h)
         /* skip invalid filenames */
         while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
             ;
+
+        if (count % 32 == 0 && find_slice_expired (&tv_start))
+            break;
     }                           /* for */
 
     find_rotate_dash (h, FALSE);
@@ -1373,6 +1449,7 @@ init_find_vars (void)
     g_free (old_dir);
     old_dir = NULL;
     matches = 0;
+    matches_shown = TRUE;
     ignore_count = 0;
 
     /* Remove all the items from the stack */
@@ -1494,6 +1571,7 @@ find_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
 
     case MSG_IDLE:
         do_search (h);
+        find_show_matches ();
         return MSG_HANDLED;
 
     default:
@@ -1767,6 +1845,7 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
             list->list[next_free].st = st;
             list->list[next_free].sort_key = NULL;
             list->list[next_free].second_sort_key = NULL;
+            list->list[next_free].fhl_stamp = 0;
             next_free++;
             g_free (name);
             if (!(next_free & 15))
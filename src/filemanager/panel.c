@@ -2485,7 +2485,7 @@ do_search (WPanel * panel, int c_code)
                 break;
             wrapped = TRUE;
         }
-        if (mc_search_run (search, panel->dir.list[i].fname, 0, panel->dir.list[i].fnamelen, NULL))
+        if (mc_search_match_str (search, panel->dir.list[i].fname, panel->dir.list[i].fnamelen))
         {
             sel = i;
             is_found = TRUE;
@@ -3750,7 +3750,7 @@ reload_panelized (WPanel * panel)
         }
         vpath = vfs_path_from_str (list->list[i].fname);
         if (mc_lstat (vpath, &list->list[i].st))
-            g_free (list->list[i].fname);
+            clean_file_entry (&list->list[i]);
         else
         {
             if (list->list[i].f.marked)
@@ -364,6 +364,7 @@ do_external_panelize (char *command)
         list->list[next_free].st = st;
         list->list[next_free].sort_key = NULL;
         list->list[next_free].second_sort_key = NULL;
+        list->list[next_free].fhl_stamp = 0;
         next_free++;
         if (!(next_free & 32))
             rotate_dash ();
@@ -447,8 +448,9 @@ do_panelize_cd (struct WPanel *panel)
         list->list[i].f.dir_size_computed = panelized_panel.list.list[i].f.dir_size_computed;
         list->list[i].f.marked = panelized_panel.list.list[i].f.marked;
         list->list[i].st = panelized_panel.list.list[i].st;
-        list->list[i].sort_key = panelized_panel.list.list[i].sort_key;
-        list->list[i].second_sort_key = panelized_panel.list.list[i].second_sort_key;
+        list->list[i].sort_key = NULL;
+        list->list[i].second_sort_key = NULL;
+        list->list[i].fhl_stamp = 0;
     }
     try_to_select (panel, NULL);
 }
@@ -500,8 +502,9 @@ panelize_save_panel (struct WPanel *panel)
         panelized_panel.list.list[i].f.dir_size_computed = list->list[i].f.dir_size_computed;
         panelized_panel.list.list[i].f.marked = list->list[i].f.marked;
         panelized_panel.list.list[i].st = list->list[i].st;
-        panelized_panel.list.list[i].sort_key = list->list[i].sort_key;
-        panelized_panel.list.list[i].second_sort_key = list->list[i].second_sort_key;
+        panelized_panel.list.list[i].sort_key = NULL;
+        panelized_panel.list.list[i].second_sort_key = NULL;
+        panelized_panel.list.list[i].fhl_stamp = 0;
     }
 }
 
@@ -53,7 +53,6 @@
 #include "lib/mcconfig.h"
 #include "lib/vfs/vfs.h"
 #include "lib/fileloc.h"
-#include "lib/strescape.h"
 #include "lib/hook.h"
 #include "lib/util.h"
 
@@ -65,7 +64,8 @@
 
 /*** file scope macro definitions ****************************************************************/
 
-#define TREE_SIGNATURE "Midnight Commander TreeStore v 2.0"
+#define TREE_SIGNATURE "Midnight Commander TreeStore v 3.0"
+#define TREE_SIGNATURE_TEXT "Midnight Commander TreeStore v 2.0"
 
 /*** file scope type declarations ****************************************************************/
 
@@ -95,21 +95,13 @@ tree_store_dirty (int state)
   */
 
 static size_t
-str_common (const vfs_path_t * s1_vpath, const vfs_path_t * s2_vpath)
+str_common (const char *s1, const char *s2)
 {
     size_t result = 0;
-    char *s1, *fs1;
-    char *s2, *fs2;
-
-    s1 = fs1 = vfs_path_to_str (s1_vpath);
-    s2 = fs2 = vfs_path_to_str (s2_vpath);
 
     while (*s1 != '\0' && *s2 != '\0' && *s1++ == *s2++)
         result++;
 
-    g_free (fs1);
-    g_free (fs2);
-
     return result;
 }
 
@@ -137,37 +129,70 @@ str_common (const vfs_path_t * s1_vpath, const vfs_path_t * s2_vpath)
  */
 
 static int
-pathcmp (const vfs_path_t * p1_vpath, const vfs_path_t * p2_vpath)
+pathcmp (const char *p1, const char *p2)
 {
-    int ret_val;
-    char *p1, *fp1;
-    char *p2, *fp2;
-
-    p1 = fp1 = vfs_path_to_str (p1_vpath);
-    p2 = fp2 = vfs_path_to_str (p2_vpath);
-
     for (; *p1 == *p2; p1++, p2++)
         if (*p1 == '\0')
-        {
-            g_free (fp1);
-            g_free (fp2);
             return 0;
-        }
 
     if (*p1 == '\0')
-        ret_val = -1;
-    else if (*p2 == '\0')
-        ret_val = 1;
-    else if (*p1 == PATH_SEP)
-        ret_val = -1;
-    else if (*p2 == PATH_SEP)
-        ret_val = 1;
-    else
-        ret_val = (*p1 - *p2);
+        return -1;
+    if (*p2 == '\0')
+        return 1;
+    if (*p1 == PATH_SEP)
+        return -1;
+    if (*p2 == PATH_SEP)
+        return 1;
+    return (*p1 - *p2);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search the index for a directory.
+ *
+ * @param name full path of directory
+ * @param pos position of the entry in the index, or the position to insert it at
+ *
+ * @return TRUE if the directory is found, FALSE otherwise
+ */
+
+static gboolean
+tree_store_find (const char *name, guint * pos)
+{
+    guint lo = 0;
+    guint hi;
+
+    hi = ts.index == NULL ? 0 : ts.index->len;
+    while (lo < hi)
+    {
+        guint mid;
+        int flag;
+
+        mid = lo + (hi - lo) / 2;
+        flag = pathcmp (((tree_entry *) g_ptr_array_index (ts.index, mid))->path, name);
+        if (flag == 0)
+        {
+            *pos = mid;
+            return TRUE;
+        }
+        if (flag < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
 
-    g_free (fp1);
-    g_free (fp2);
-    return ret_val;
+    *pos = lo;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Check if the entry is the directory 'base' of length 'len' or one of its subdirectories */
+
+static gboolean
+tree_store_is_child (const tree_entry * entry, const char *base, size_t len)
+{
+    return (strncmp (entry->path, base, len) == 0
+            && (entry->path[len] == '\0' || entry->path[len] == PATH_SEP || len == 1));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -210,106 +235,176 @@ decode (char *buffer)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** Loads the tree store from the specified filename */
+/** Loads the tree store saved in the text format of version 2.0 */
 
-static int
-tree_store_load_from (char *name)
+static void
+tree_store_load_text (FILE * file)
 {
-    FILE *file;
     char buffer[MC_MAXPATHLEN + 20], oldname[MC_MAXPATHLEN];
     char *different;
     int common;
-    int do_load;
 
-    g_return_val_if_fail (name != NULL, FALSE);
+    oldname[0] = 0;
+    while (fgets (buffer, MC_MAXPATHLEN, file))
+    {
+        tree_entry *e;
+        int scanned;
+        char *lc_name;
 
-    if (ts.loaded)
-        return TRUE;
+        /* Skip invalid records */
+        if ((buffer[0] != '0' && buffer[0] != '1'))
+            continue;
 
-    file = fopen (name, "r");
+        if (buffer[1] != ':')
+            continue;
 
-    if (file)
-    {
-        if (fgets (buffer, sizeof (buffer), file) != NULL)
+        scanned = buffer[0] == '1';
+
+        lc_name = decode (buffer + 2);
+        if (lc_name[0] != PATH_SEP)
         {
-            if (strncmp (buffer, TREE_SIGNATURE, strlen (TREE_SIGNATURE)) != 0)
+            /* Clear-text decompression */
+            char *s = strtok (lc_name, " ");
+
+            if (s)
             {
-                fclose (file);
-                do_load = FALSE;
+                common = atoi (s);
+                different = strtok (NULL, "");
+                if (different)
+                {
+                    vfs_path_t *vpath;
+
+                    vpath = vfs_path_from_str (oldname);
+                    strcpy (oldname + common, different);
+                    if (vfs_file_is_local (vpath))
+                    {
+                        vfs_path_t *tmp_vpath;
+
+                        tmp_vpath = vfs_path_from_str (oldname);
+                        e = tree_store_add_entry (tmp_vpath);
+                        vfs_path_free (tmp_vpath);
+                        e->scanned = scanned;
+                    }
+                    vfs_path_free (vpath);
+                }
             }
-            else
-                do_load = TRUE;
         }
         else
-            do_load = FALSE;
+        {
+            vfs_path_t *vpath;
+
+            vpath = vfs_path_from_str (lc_name);
+            if (vfs_file_is_local (vpath))
+            {
+                e = tree_store_add_entry (vpath);
+                e->scanned = scanned;
+            }
+            vfs_path_free (vpath);
+            strcpy (oldname, lc_name);
+        }
+        g_free (lc_name);
     }
-    else
-        do_load = FALSE;
+}
 
-    if (do_load)
+/* --------------------------------------------------------------------------------------------- */
+/** Reads an unsigned number stored in 7-bit groups, least significant first */
+
+static gboolean
+tree_store_read_number (FILE * file, size_t * value)
+{
+    int c;
+    unsigned int shift = 0;
+
+    *value = 0;
+    do
     {
-        ts.loaded = TRUE;
+        c = getc (file);
+        if (c == EOF || shift > 28)
+            return FALSE;
+        *value |= (size_t) (c & 0x7f) << shift;
+        shift += 7;
+    }
+    while ((c & 0x80) != 0);
+
+    return TRUE;
+}
 
-        /* File open -> read contents */
-        oldname[0] = 0;
-        while (fgets (buffer, MC_MAXPATHLEN, file))
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Loads the tree store saved in the binary format.
+ *
+ * Every record is a byte of flags followed by the number of bytes common with the previous
+ * name, the number of remaining bytes and the remaining bytes of the name.
+ */
+
+static void
+tree_store_load_binary (FILE * file)
+{
+    char name[MC_MAXPATHLEN];
+    size_t name_len = 0;
+    int flags;
+
+    while ((flags = getc (file)) != EOF)
+    {
+        size_t common, len;
+        vfs_path_t *vpath;
+
+        if (!tree_store_read_number (file, &common) || !tree_store_read_number (file, &len))
+            break;
+
+        /* Stop at a broken record */
+        if (common > name_len || len >= sizeof (name) - common)
+            break;
+
+        if (fread (name + common, 1, len, file) != len)
+            break;
+
+        name_len = common + len;
+        name[name_len] = '\0';
+
+        vpath = vfs_path_from_str (name);
+        if (vfs_file_is_local (vpath))
         {
             tree_entry *e;
-            int scanned;
-            char *lc_name;
 
-            /* Skip invalid records */
-            if ((buffer[0] != '0' && buffer[0] != '1'))
-                continue;
+            e = tree_store_add_entry (vpath);
+            e->scanned = (flags & 1) != 0;
+        }
+        vfs_path_free (vpath);
+    }
+}
 
-            if (buffer[1] != ':')
-                continue;
+/* --------------------------------------------------------------------------------------------- */
+/** Loads the tree store from the specified filename */
 
-            scanned = buffer[0] == '1';
+static int
+tree_store_load_from (char *name)
+{
+    FILE *file;
+    char buffer[MC_MAXPATHLEN + 20];
 
-            lc_name = decode (buffer + 2);
-            if (lc_name[0] != PATH_SEP)
-            {
-                /* Clear-text decompression */
-                char *s = strtok (lc_name, " ");
+    g_return_val_if_fail (name != NULL, FALSE);
 
-                if (s)
-                {
-                    common = atoi (s);
-                    different = strtok (NULL, "");
-                    if (different)
-                    {
-                        vfs_path_t *vpath;
-
-                        vpath = vfs_path_from_str (oldname);
-                        strcpy (oldname + common, different);
-                        if (vfs_file_is_local (vpath))
-                        {
-                            vfs_path_t *tmp_vpath;
-
-                            tmp_vpath = vfs_path_from_str (oldname);
-                            e = tree_store_add_entry (tmp_vpath);
-                            vfs_path_free (tmp_vpath);
-                            e->scanned = scanned;
-                        }
-                        vfs_path_free (vpath);
-                    }
-                }
+    if (ts.loaded)
+        return TRUE;
+
+    file = fopen (name, "r");
+
+    if (file != NULL)
+    {
+        if (fgets (buffer, sizeof (buffer), file) != NULL)
+        {
+            /* File open -> read contents */
+            if (strncmp (buffer, TREE_SIGNATURE, strlen (TREE_SIGNATURE)) == 0)
+            {
+                ts.loaded = TRUE;
+                tree_store_load_binary (file);
             }
-            else
+            else if (strncmp (buffer, TREE_SIGNATURE_TEXT, strlen (TREE_SIGNATURE_TEXT)) == 0)
             {
-                vfs_path_t *vpath;
-
-                vpath = vfs_path_from_str (lc_name);
-                if (vfs_file_is_local (vpath))
-                {
-                    e = tree_store_add_entry (vpath);
-                    e->scanned = scanned;
-                }
-                vfs_path_free (vpath);
-                strcpy (oldname, lc_name);
+                ts.loaded = TRUE;
+                tree_store_load_text (file);
             }
-            g_free (lc_name);
         }
         fclose (file);
     }
@@ -328,16 +423,17 @@ tree_store_load_from (char *name)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/** Writes an unsigned number in 7-bit groups, least significant first */
 
-static char *
-encode (const vfs_path_t * vpath, size_t offset)
+static void
+tree_store_write_number (FILE * file, size_t value)
 {
-    char *string, *ret_val;
-
-    string = vfs_path_to_str (vpath);
-    ret_val = strutils_escape (string + offset, -1, "\n\\", FALSE);
-    g_free (string);
-    return ret_val;
+    while (value >= 0x80)
+    {
+        putc ((int) (value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    putc ((int) value, file);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -347,6 +443,7 @@ static int
 tree_store_save_to (char *name)
 {
     tree_entry *current;
+    const tree_entry *prev = NULL;
     FILE *file;
 
     file = fopen (name, "w");
@@ -355,38 +452,27 @@ tree_store_save_to (char *name)
 
     fprintf (file, "%s\n", TREE_SIGNATURE);
 
-    current = ts.tree_first;
-    while (current)
-    {
-        int i, common;
-
+    for (current = ts.tree_first; current != NULL; current = current->next)
         if (vfs_file_is_local (current->name))
         {
-            /* Clear-text compression */
-            if (current->prev && (common = str_common (current->prev->name, current->name)) > 2)
-            {
-                char *encoded = encode (current->name, common);
-
-                i = fprintf (file, "%d:%d %s\n", current->scanned, common, encoded);
-                g_free (encoded);
-            }
-            else
-            {
-                char *encoded = encode (current->name, 0);
+            size_t common, len;
 
-                i = fprintf (file, "%d:%s\n", current->scanned, encoded);
-                g_free (encoded);
-            }
+            /* Store only the part which differs from the previous name */
+            common = prev != NULL ? str_common (prev->path, current->path) : 0;
+            len = strlen (current->path + common);
 
-            if (i == EOF)
+            putc (current->scanned ? 1 : 0, file);
+            tree_store_write_number (file, common);
+            tree_store_write_number (file, len);
+            if (fwrite (current->path + common, 1, len, file) != len || ferror (file))
             {
                 fprintf (stderr, _("Cannot write to the %s file:\n%s\n"),
                          name, unix_error_string (errno));
                 break;
             }
+            prev = current;
         }
-        current = current->next;
-    }
+
     tree_store_dirty (FALSE);
     fclose (file);
 
@@ -398,63 +484,48 @@ tree_store_save_to (char *name)
 static tree_entry *
 tree_store_add_entry (const vfs_path_t * name)
 {
-    int flag = -1;
-    tree_entry *current = ts.tree_first;
-    tree_entry *old = NULL;
+    tree_entry *current;
     tree_entry *new;
+    char *path;
+    guint pos;
     int submask = 0;
 
-    if (ts.tree_last && ts.tree_last->next)
-        abort ();
+    path = vfs_path_to_str (name);
 
     /* Search for the correct place */
-    while (current != NULL && (flag = pathcmp (current->name, name)) < 0)
+    if (tree_store_find (path, &pos))
     {
-        old = current;
-        current = current->next;
+        g_free (path);
+        return (tree_entry *) g_ptr_array_index (ts.index, pos);        /* Already in the list */
     }
 
-    if (flag == 0)
-        return current;         /* Already in the list */
-
     /* Not in the list -> add it */
     new = g_new0 (tree_entry, 1);
-    if (!current)
-    {
-        /* Append to the end of the list */
-        if (!ts.tree_first)
-        {
-            /* Empty list */
-            ts.tree_first = new;
-            new->prev = NULL;
-        }
-        else
-        {
-            if (old != NULL)
-                old->next = new;
-            new->prev = old;
-        }
-        new->next = NULL;
-        ts.tree_last = new;
-    }
+    new->path = path;
+
+    if (ts.index == NULL)
+        ts.index = g_ptr_array_new ();
+
+    /* Insert into the index; entries loaded from the file are appended */
+    g_ptr_array_add (ts.index, NULL);
+    memmove (&ts.index->pdata[pos + 1], &ts.index->pdata[pos],
+             (ts.index->len - 1 - pos) * sizeof (gpointer));
+    ts.index->pdata[pos] = new;
+
+    /* Link into the list between the neighbours in the index */
+    new->prev = pos == 0 ? NULL : (tree_entry *) g_ptr_array_index (ts.index, pos - 1);
+    new->next =
+        pos + 1 == ts.index->len ? NULL : (tree_entry *) g_ptr_array_index (ts.index, pos + 1);
+
+    if (new->prev != NULL)
+        new->prev->next = new;
     else
-    {
-        /* Insert in to the middle of the list */
-        new->prev = old;
-        if (old != NULL)
-        {
-            /* Yes, in the middle */
-            new->next = old->next;
-            old->next = new;
-        }
-        else
-        {
-            /* Nope, in the beginning of the list */
-            new->next = ts.tree_first;
-            ts.tree_first = new;
-        }
+        ts.tree_first = new;
+
+    if (new->next != NULL)
         new->next->prev = new;
-    }
+    else
+        ts.tree_last = new;
 
     /* Calculate attributes */
     new->name = vfs_path_clone (name);
@@ -507,6 +578,7 @@ tree_store_notify_remove (tree_entry * entry)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/** Unlink the entry from the list and free it. The caller removes it from the index. */
 
 static tree_entry *
 remove_entry (tree_entry * entry)
@@ -540,7 +612,8 @@ remove_entry (tree_entry * entry)
         ts.tree_last = entry->prev;
 
     /* Free the memory used by the entry */
-    g_free (entry->name);
+    vfs_path_free (entry->name);
+    g_free (entry->path);
     g_free (entry);
 
     return ret;
@@ -612,16 +685,15 @@ should_skip_directory (const vfs_path_t * vpath)
 tree_entry *
 tree_store_whereis (const vfs_path_t * name)
 {
-    tree_entry *current = ts.tree_first;
-    int flag = -1;
+    char *path;
+    guint pos;
+    gboolean found;
 
-    while (current && (flag = pathcmp (current->name, name)) < 0)
-        current = current->next;
+    path = vfs_path_to_str (name);
+    found = tree_store_find (path, &pos);
+    g_free (path);
 
-    if (flag == 0)
-        return current;
-    else
-        return NULL;
+    return found ? (tree_entry *) g_ptr_array_index (ts.index, pos) : NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -703,45 +775,41 @@ tree_store_remove_entry_remove_hook (tree_store_remove_fn callback)
 void
 tree_store_remove_entry (const vfs_path_t * name_vpath)
 {
-    tree_entry *current, *base, *old;
+    tree_entry *base;
+    char *name;
     size_t len;
+    guint pos, end, i;
+    gboolean found;
 
     g_return_if_fail (name_vpath != NULL);
 
+    name = vfs_path_to_str (name_vpath);
+
     /* Miguel Ugly hack */
+    if (name[0] == PATH_SEP && name[1] == '\0')
     {
-        char *name;
-        gboolean is_root;
-
-        name = vfs_path_to_str (name_vpath);
-        is_root = (name[0] == PATH_SEP && name[1] == '\0');
         g_free (name);
-        if (is_root)
-            return;
+        return;
     }
     /* Miguel Ugly hack end */
 
-    base = tree_store_whereis (name_vpath);
-    if (!base)
+    found = tree_store_find (name, &pos);
+    g_free (name);
+    if (!found)
         return;                 /* Doesn't exist */
 
-    len = vfs_path_len (base->name);
-    current = base->next;
-    while (current != NULL && vfs_path_ncmp (current->name, base->name, len) == 0)
-    {
-        char *current_name;
-        gboolean ok;
-
-        current_name = vfs_path_to_str (current->name);
-        ok = (current_name[len] == '\0' || current_name[len] == PATH_SEP);
-        g_free (current_name);
-        if (!ok)
+    /* The subdirectories follow the directory in the index */
+    base = (tree_entry *) g_ptr_array_index (ts.index, pos);
+    len = strlen (base->path);
+    for (end = pos + 1; end < ts.index->len; end++)
+        if (!tree_store_is_child (g_ptr_array_index (ts.index, end), base->path, len))
             break;
-        old = current;
-        current = current->next;
-        remove_entry (old);
-    }
+
+    for (i = pos + 1; i < end; i++)
+        remove_entry ((tree_entry *) g_ptr_array_index (ts.index, i));
     remove_entry (base);
+    g_ptr_array_remove_range (ts.index, pos, end - pos);
+
     tree_store_dirty (TRUE);
 }
 
@@ -754,7 +822,8 @@ tree_store_mark_checked (const char *subname)
     vfs_path_t *name;
     char *check_name;
     tree_entry *current, *base;
-    int flag = 1;
+    guint pos;
+
     if (!ts.loaded)
         return;
 
@@ -773,38 +842,30 @@ tree_store_mark_checked (const char *subname)
     g_free (check_name);
 
     /* Search for the subdirectory */
-    current = ts.check_start;
-    while (current && (flag = pathcmp (current->name, name)) < 0)
-        current = current->next;
-
-    if (flag != 0)
+    check_name = vfs_path_to_str (name);
+    if (tree_store_find (check_name, &pos))
+        base = (tree_entry *) g_ptr_array_index (ts.index, pos);
+    else
     {
         /* Doesn't exist -> add it */
-        current = tree_store_add_entry (name);
+        base = tree_store_add_entry (name);
         ts.add_queue_vpath = g_list_prepend (ts.add_queue_vpath, vfs_path_clone (name));
     }
-    g_free (name);
+    g_free (check_name);
+    vfs_path_free (name);
 
     /* Clear the deletion mark from the subdirectory and its children */
-    base = current;
     if (base)
     {
         size_t len;
 
-        len = vfs_path_len (base->name);
+        len = strlen (base->path);
         base->mark = 0;
-        current = base->next;
-        while (current != NULL && vfs_path_ncmp (current->name, base->name, len) == 0)
+        for (current = base->next; current != NULL; current = current->next)
         {
-            gboolean ok;
-
-            check_name = vfs_path_to_str (current->name);
-            ok = (check_name[len] == '\0' || check_name[len] == PATH_SEP || len == 1);
-            g_free (check_name);
-            if (!ok)
+            if (!tree_store_is_child (current, base->path, len))
                 break;
             current->mark = 0;
-            current = current->next;
         }
     }
 }
@@ -816,6 +877,7 @@ tree_entry *
 tree_store_start_check (const vfs_path_t * vpath)
 {
     tree_entry *current, *retval;
+    char *check_name;
     size_t len;
 
     if (!ts.loaded)
@@ -848,22 +910,16 @@ tree_store_start_check (const vfs_path_t * vpath)
 
     /* Mark old subdirectories for delete */
     ts.check_start = current->next;
-    len = vfs_path_len (ts.check_name);
+    check_name = vfs_path_to_str (ts.check_name);
+    len = strlen (check_name);
 
-    current = ts.check_start;
-    while (current != NULL && vfs_path_ncmp (current->name, ts.check_name, len) == 0)
+    for (current = ts.check_start; current != NULL; current = current->next)
     {
-        char *current_name;
-        gboolean ok;
-
-        current_name = vfs_path_to_str (current->name);
-        ok = (current_name[len] == '\0' || current_name[len] == PATH_SEP || len == 1);
-        g_free (current_name);
-        if (!ok)
+        if (!tree_store_is_child (current, check_name, len))
             break;
         current->mark = 1;
-        current = current->next;
     }
+    g_free (check_name);
 
     return retval;
 }
@@ -874,8 +930,9 @@ tree_store_start_check (const vfs_path_t * vpath)
 void
 tree_store_end_check (void)
 {
-    tree_entry *current, *old;
+    char *check_name;
     size_t len;
+    guint pos;
     GList *the_queue;
 
     if (!ts.loaded)
@@ -884,25 +941,35 @@ tree_store_end_check (void)
     g_return_if_fail (ts.check_name != NULL);
 
     /* Check delete marks and delete if found */
-    len = vfs_path_len (ts.check_name);
+    check_name = vfs_path_to_str (ts.check_name);
+    len = strlen (check_name);
 
-    current = ts.check_start;
-    while (current != NULL && vfs_path_ncmp (current->name, ts.check_name, len) == 0)
+    if (tree_store_find (check_name, &pos))
     {
-        char *current_name;
-        gboolean ok;
+        guint i, j;
 
-        current_name = vfs_path_to_str (current->name);
-        ok = (current_name[len] == '\0' || current_name[len] == PATH_SEP || len == 1);
-        g_free (current_name);
+        /* Subdirectories follow the directory in the index: compact them in one pass */
+        for (i = j = pos + 1; i < ts.index->len; i++)
+        {
+            tree_entry *current;
 
-        if (!ok)
-            break;
-        old = current;
-        current = current->next;
-        if (old->mark)
-            remove_entry (old);
+            current = (tree_entry *) g_ptr_array_index (ts.index, i);
+            if (!tree_store_is_child (current, check_name, len))
+                break;
+            if (current->mark)
+                remove_entry (current);
+            else
+                ts.index->pdata[j++] = current;
+        }
+
+        if (i != j)
+        {
+            memmove (&ts.index->pdata[j], &ts.index->pdata[i],
+                     (ts.index->len - i) * sizeof (gpointer));
+            g_ptr_array_set_size (ts.index, ts.index->len - (i - j));
+        }
     }
+    g_free (check_name);
 
     /* get the stuff in the scan order */
     ts.add_queue_vpath = g_list_reverse (ts.add_queue_vpath);
@@ -22,6 +22,7 @@ typedef void (*tree_store_remove_fn) (struct tree_entry * tree, void *data);
 typedef struct tree_entry
 {
     vfs_path_t *name;           /* The full path of directory */
+    char *path;                 /* The full path as a string, key of the index */
     int sublevel;               /* Number of parent directories (slashes) */
     long submask;               /* Bitmask of existing sublevels after this entry */
     const char *subname;        /* The last part of name (the actual name) */
@@ -35,6 +36,7 @@ struct TreeStore
 {
     tree_entry *tree_first;     /* First entry in the list */
     tree_entry *tree_last;      /* Last entry in the list */
+    GPtrArray *index;           /* All entries in the order of the list */
     tree_entry *check_start;    /* Start of checked subdirectories */
     vfs_path_t *check_name;
     GList *add_queue_vpath;     /* List of vfs_path_t objects of added directories */
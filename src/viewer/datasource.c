@@ -66,13 +66,179 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* files are read by pages */
+#define MCVIEW_FILE_PAGE_SIZE (64 * 1024)
+/* number of pages kept in memory */
+#define MCVIEW_FILE_PAGES_MAX 32
+/* number of pages read at once when the file is read sequentially */
+#define MCVIEW_FILE_READAHEAD 4
+
 /*** file scope type declarations ****************************************************************/
 
+typedef struct
+{
+    off_t offset;
+    size_t len;
+    byte *data;
+} mcview_file_page_t;
+
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static void
+mcview_file_page_free (mcview_file_page_t * page)
+{
+    g_free (page->data);
+    g_free (page);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the cached page at offset and make it the most recently used one.
+ */
+
+static mcview_file_page_t *
+mcview_file_find_page (mcview_t * view, off_t offset)
+{
+    GList *link;
+
+    for (link = view->ds_file_pages->head; link != NULL; link = g_list_next (link))
+    {
+        mcview_file_page_t *page = (mcview_file_page_t *) link->data;
+
+        if (page->offset == offset)
+        {
+            g_queue_unlink (view->ds_file_pages, link);
+            g_queue_push_head_link (view->ds_file_pages, link);
+            return page;
+        }
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the page at offset from the current position of file and cache it.
+ *
+ * @return FALSE on read error
+ */
+
+static gboolean
+mcview_file_read_page (mcview_t * view, off_t offset)
+{
+    mcview_file_page_t *page;
+    size_t size, len = 0;
+
+    size = (size_t) MIN (MCVIEW_FILE_PAGE_SIZE, view->ds_file_filesize - offset);
+
+    page = g_new (mcview_file_page_t, 1);
+    page->offset = offset;
+    page->data = g_malloc (size);
+
+    while (len < size)
+    {
+        ssize_t res;
+
+        res = mc_read (view->ds_file_fd, page->data + len, size - len);
+        if (res == -1)
+        {
+            mcview_file_page_free (page);
+            return FALSE;
+        }
+        if (res == 0)
+            break;
+        len += (size_t) res;
+    }
+
+    page->len = len;
+    g_queue_push_head (view->ds_file_pages, page);
+
+    while (g_queue_get_length (view->ds_file_pages) > MCVIEW_FILE_PAGES_MAX)
+        mcview_file_page_free ((mcview_file_page_t *) g_queue_pop_tail (view->ds_file_pages));
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make the page containing byte_index current. If the previous page was the neighbour one,
+ * the file is read sequentially and some pages in the same direction are read ahead.
+ */
+
+static void
+mcview_file_load_page (mcview_t * view, off_t byte_index)
+{
+    mcview_file_page_t *page;
+    off_t offset, first, last, pos = -1;
+
+    offset = mcview_offset_rounddown (byte_index, MCVIEW_FILE_PAGE_SIZE);
+    first = last = offset;
+
+    page = mcview_file_find_page (view, offset);
+    if (page != NULL && !mcview_already_loaded (page->offset, byte_index, page->len))
+    {
+        /* the file has grown since the page was read */
+        g_queue_remove (view->ds_file_pages, page);
+        mcview_file_page_free (page);
+        page = NULL;
+    }
+
+    if (page == NULL)
+    {
+        off_t readahead = (MCVIEW_FILE_READAHEAD - 1) * MCVIEW_FILE_PAGE_SIZE;
+
+        if (offset == view->ds_file_last_page + MCVIEW_FILE_PAGE_SIZE)
+            last = MIN (offset + readahead,
+                        mcview_offset_rounddown (view->ds_file_filesize - 1,
+                                                 MCVIEW_FILE_PAGE_SIZE));
+        else if (offset == view->ds_file_last_page - MCVIEW_FILE_PAGE_SIZE)
+            first = MAX (offset - readahead, 0);
+
+        /* read the pages which are not cached yet in file order */
+        for (; first <= last; first += MCVIEW_FILE_PAGE_SIZE)
+        {
+            if (first != offset && mcview_file_find_page (view, first) != NULL)
+                continue;
+            if ((pos != first && mc_lseek (view->ds_file_fd, first, SEEK_SET) == -1)
+                || !mcview_file_read_page (view, first))
+                break;
+            pos = first + MCVIEW_FILE_PAGE_SIZE;
+        }
+
+        page = mcview_file_find_page (view, offset);
+    }
+
+    view->ds_file_last_page = offset;
+
+    if (page == NULL)
+    {
+        view->ds_file_datalen = 0;
+        return;
+    }
+
+    view->ds_file_offset = page->offset;
+    view->ds_file_data = page->data;
+    view->ds_file_datalen = page->len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget all loaded data of file.
+ */
+
+static void
+mcview_file_flush (mcview_t * view)
+{
+    view->ds_file_datalen = 0;
+    view->ds_file_last_page = INVALID_OFFSET;
+
+    while (!g_queue_is_empty (view->ds_file_pages))
+        mcview_file_page_free ((mcview_file_page_t *) g_queue_pop_head (view->ds_file_pages));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -129,8 +295,14 @@ mcview_update_filesize (mcview_t * view)
     if (view->datasource == DS_FILE)
     {
         struct stat st;
+
         if (mc_fstat (view->ds_file_fd, &st) != -1)
+        {
+            /* grown file is read further on demand, but data beyond the end must be dropped */
+            if (st.st_size < view->ds_file_filesize)
+                mcview_file_flush (view);
             view->ds_file_filesize = st.st_size;
+        }
     }
 }
 
@@ -143,7 +315,8 @@ mcview_get_ptr_file (mcview_t * view, off_t byte_index)
     assert (view->datasource == DS_FILE);
 #endif
 
-    mcview_file_load_data (view, byte_index);
+    if (!mcview_already_loaded (view->ds_file_offset, byte_index, view->ds_file_datalen))
+        mcview_file_load_data (view, byte_index);
     if (mcview_already_loaded (view->ds_file_offset, byte_index, view->ds_file_datalen))
         return (char *) (view->ds_file_data + (byte_index - view->ds_file_offset));
     return NULL;
@@ -162,6 +335,44 @@ mcview_get_ptr_string (mcview_t * view, off_t byte_index)
     return NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to byte at byte_index and number of bytes which can be read
+ * from it without another datasource access.
+ *
+ * @return pointer to data, NULL if byte_index is beyond the data
+ */
+
+const char *
+mcview_get_chunk (mcview_t * view, off_t byte_index, size_t * len)
+{
+    const char *str = NULL;
+
+    *len = 0;
+
+    switch (view->datasource)
+    {
+    case DS_STDIO_PIPE:
+    case DS_VFS_PIPE:
+        str = mcview_get_chunk_growing_buffer (view, byte_index, len);
+        break;
+    case DS_FILE:
+        str = mcview_get_ptr_file (view, byte_index);
+        if (str != NULL)
+            *len = view->ds_file_datalen - (size_t) (byte_index - view->ds_file_offset);
+        break;
+    case DS_STRING:
+        str = mcview_get_ptr_string (view, byte_index);
+        if (str != NULL)
+            *len = view->ds_string_len - (size_t) byte_index;
+        break;
+    case DS_NONE:
+        break;
+    }
+
+    return str;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
@@ -284,7 +495,8 @@ mcview_set_byte (mcview_t * view, off_t offset, byte b)
     assert (view->datasource == DS_FILE);
 
 #endif
-    view->ds_file_datalen = 0;  /* just force reloading */
+    /* just force reloading */
+    mcview_file_flush (view);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -293,10 +505,6 @@ mcview_set_byte (mcview_t * view, off_t offset, byte b)
 void
 mcview_file_load_data (mcview_t * view, off_t byte_index)
 {
-    off_t blockoffset;
-    ssize_t res;
-    size_t bytes_read;
-
 #ifdef HAVE_ASSERT_H
     assert (view->datasource == DS_FILE);
 #endif
@@ -307,36 +515,7 @@ mcview_file_load_data (mcview_t * view, off_t byte_index)
     if (byte_index >= view->ds_file_filesize)
         return;
 
-    blockoffset = mcview_offset_rounddown (byte_index, view->ds_file_datasize);
-    if (mc_lseek (view->ds_file_fd, blockoffset, SEEK_SET) == -1)
-        goto error;
-
-    bytes_read = 0;
-    while (bytes_read < view->ds_file_datasize)
-    {
-        res =
-            mc_read (view->ds_file_fd, view->ds_file_data + bytes_read,
-                     view->ds_file_datasize - bytes_read);
-        if (res == -1)
-            goto error;
-        if (res == 0)
-            break;
-        bytes_read += (size_t) res;
-    }
-    view->ds_file_offset = blockoffset;
-    if ((off_t) bytes_read > view->ds_file_filesize - view->ds_file_offset)
-    {
-        /* the file has grown in the meantime -- stick to the old size */
-        view->ds_file_datalen = view->ds_file_filesize - view->ds_file_offset;
-    }
-    else
-    {
-        view->ds_file_datalen = bytes_read;
-    }
-    return;
-
-  error:
-    view->ds_file_datalen = 0;
+    mcview_file_load_page (view, byte_index);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -369,7 +548,9 @@ mcview_close_datasource (mcview_t * view)
     case DS_FILE:
         (void) mc_close (view->ds_file_fd);
         view->ds_file_fd = -1;
-        g_free (view->ds_file_data);
+        mcview_file_flush (view);
+        g_queue_free (view->ds_file_pages);
+        view->ds_file_pages = NULL;
         view->ds_file_data = NULL;
         break;
     case DS_STRING:
@@ -394,9 +575,10 @@ mcview_set_datasource_file (mcview_t * view, int fd, const struct stat *st)
     view->ds_file_fd = fd;
     view->ds_file_filesize = st->st_size;
     view->ds_file_offset = 0;
-    view->ds_file_data = g_malloc (4096);
+    view->ds_file_data = NULL;
     view->ds_file_datalen = 0;
-    view->ds_file_datasize = 4096;
+    view->ds_file_pages = g_queue_new ();
+    view->ds_file_last_page = INVALID_OFFSET;
 }
 
 /* --------------------------------------------------------------------------------------------- */
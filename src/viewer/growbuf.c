@@ -36,13 +36,18 @@
 
 #include <config.h>
 #include <errno.h>
+#include <unistd.h>
 
 #include "lib/global.h"
 #include "lib/vfs/vfs.h"
 #include "lib/util.h"
 #include "lib/widget.h"         /* D_NORMAL */
+#ifdef USE_MAINTAINER_MODE
+#include "lib/logging.h"
+#endif
 
 #include "internal.h"
+#include "mcviewer.h"           /* mcview_pipe_memory_limit */
 
 /* Block size for reading files in parts */
 #define VIEW_PAGE_SIZE ((size_t) 8192)
@@ -53,11 +58,219 @@
 
 /*** file scope type declarations ****************************************************************/
 
+typedef struct
+{
+    byte *data;                 /* NULL if the block is not in memory */
+    gboolean spilled;           /* the block is written to the spill file */
+    gboolean referenced;        /* the block was used since the last eviction pass */
+} mcview_growbuf_block_t;
+
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static inline mcview_growbuf_block_t *
+mcview_growbuf_block (mcview_t * view, size_t pageno)
+{
+    return &g_array_index (view->growbuf_blocks, mcview_growbuf_block_t, pageno);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write the block into the spill file at its offset in data. The spill file is created
+ * on first use and is removed from file system at once.
+ */
+
+static gboolean
+mcview_growbuf_spill (mcview_t * view, size_t pageno)
+{
+    mcview_growbuf_block_t *block;
+    size_t written = 0;
+
+    block = mcview_growbuf_block (view, pageno);
+    if (block->spilled)
+        return TRUE;
+
+    if (view->growbuf_spill_fd == -1)
+    {
+        vfs_path_t *spill_vpath;
+
+        view->growbuf_spill_fd = mc_mkstemps (&spill_vpath, "mcview", NULL);
+        if (view->growbuf_spill_fd == -1)
+            return FALSE;
+
+        (void) unlink (vfs_path_get_last_path_str (spill_vpath));
+        vfs_path_free (spill_vpath);
+    }
+
+    if (lseek (view->growbuf_spill_fd, (off_t) pageno * VIEW_PAGE_SIZE, SEEK_SET) == -1)
+        return FALSE;
+
+    while (written < VIEW_PAGE_SIZE)
+    {
+        ssize_t res;
+
+        res = write (view->growbuf_spill_fd, block->data + written, VIEW_PAGE_SIZE - written);
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res <= 0)
+            return FALSE;
+        written += (size_t) res;
+    }
+
+    block->spilled = TRUE;
+    view->growbuf_spills++;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Evict blocks from memory until there is room for one more block. Blocks are chosen by
+ * the clock algorithm: recently used blocks get a second chance. The last block is being
+ * filled and stays in memory.
+ */
+
+static void
+mcview_growbuf_make_room (mcview_t * view)
+{
+    size_t max_resident, full, checked = 0;
+
+    if (mcview_pipe_memory_limit <= 0 || view->growbuf_spill_failed)
+        return;
+
+    max_resident = MAX ((size_t) mcview_pipe_memory_limit * 1024 * 1024 / VIEW_PAGE_SIZE, 2);
+
+    /* all blocks except the last one are full */
+    full = view->growbuf_blocks->len == 0 ? 0 : view->growbuf_blocks->len - 1;
+
+    while (view->growbuf_resident >= max_resident && checked < 2 * full)
+    {
+        mcview_growbuf_block_t *block;
+
+        if (view->growbuf_clock >= full)
+            view->growbuf_clock = 0;
+
+        block = mcview_growbuf_block (view, view->growbuf_clock);
+
+        if (block->data != NULL)
+        {
+            if (block->referenced)
+                block->referenced = FALSE;
+            else
+            {
+                if (!mcview_growbuf_spill (view, view->growbuf_clock))
+                {
+                    /* keep data in memory rather than lose it */
+                    view->growbuf_spill_failed = TRUE;
+                    return;
+                }
+
+                g_free (block->data);
+                block->data = NULL;
+                view->growbuf_resident--;
+            }
+        }
+
+        view->growbuf_clock++;
+        checked++;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get data of the block, reading it back from the spill file if needed.
+ *
+ * @return pointer to data, NULL on error
+ */
+
+static byte *
+mcview_growbuf_load (mcview_t * view, size_t pageno)
+{
+    mcview_growbuf_block_t *block;
+    byte *data;
+    size_t nread = 0;
+
+    block = mcview_growbuf_block (view, pageno);
+    block->referenced = TRUE;
+
+    if (block->data != NULL)
+    {
+        view->growbuf_hits++;
+        return block->data;
+    }
+
+    if (lseek (view->growbuf_spill_fd, (off_t) pageno * VIEW_PAGE_SIZE, SEEK_SET) == -1)
+        return NULL;
+
+    data = g_try_malloc (VIEW_PAGE_SIZE);
+    if (data == NULL)
+        return NULL;
+
+    while (nread < VIEW_PAGE_SIZE)
+    {
+        ssize_t res;
+
+        res = read (view->growbuf_spill_fd, data + nread, VIEW_PAGE_SIZE - nread);
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res <= 0)
+        {
+            g_free (data);
+            return NULL;
+        }
+        nread += (size_t) res;
+    }
+
+    mcview_growbuf_make_room (view);
+
+    block->data = data;
+    view->growbuf_resident++;
+    view->growbuf_loads++;
+
+    return data;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to byte at byte_index and number of bytes following it in the same block.
+ *
+ * @return pointer to data, NULL if byte_index is beyond the data
+ */
+
+static byte *
+mcview_growbuf_get_ptr (mcview_t * view, off_t byte_index, size_t * len)
+{
+    off_t pageno = byte_index / VIEW_PAGE_SIZE;
+    size_t pageindex = (size_t) (byte_index % VIEW_PAGE_SIZE);
+    size_t pagelen = VIEW_PAGE_SIZE;
+    byte *data;
+
+#ifdef HAVE_ASSERT_H
+    assert (view->growbuf_in_use);
+#endif
+
+    if (pageno < 0)
+        return NULL;
+
+    mcview_growbuf_read_until (view, byte_index + 1);
+    if (pageno >= (off_t) view->growbuf_blocks->len)
+        return NULL;
+    if (pageno == (off_t) view->growbuf_blocks->len - 1)
+        pagelen = view->growbuf_lastindex;
+    if (pageindex >= pagelen)
+        return NULL;
+
+    data = mcview_growbuf_load (view, (size_t) pageno);
+    if (data == NULL)
+        return NULL;
+
+    if (len != NULL)
+        *len = pagelen - pageindex;
+    return data + pageindex;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -66,9 +279,16 @@ void
 mcview_growbuf_init (mcview_t * view)
 {
     view->growbuf_in_use = TRUE;
-    view->growbuf_blockptr = g_ptr_array_new ();
+    view->growbuf_blocks = g_array_new (FALSE, FALSE, sizeof (mcview_growbuf_block_t));
     view->growbuf_lastindex = VIEW_PAGE_SIZE;
     view->growbuf_finished = FALSE;
+    view->growbuf_resident = 0;
+    view->growbuf_clock = 0;
+    view->growbuf_spill_fd = -1;
+    view->growbuf_spill_failed = FALSE;
+    view->growbuf_hits = 0;
+    view->growbuf_loads = 0;
+    view->growbuf_spills = 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -76,15 +296,30 @@ mcview_growbuf_init (mcview_t * view)
 void
 mcview_growbuf_free (mcview_t * view)
 {
+    guint i;
+
 #ifdef HAVE_ASSERT_H
     assert (view->growbuf_in_use);
 #endif
 
-    g_ptr_array_foreach (view->growbuf_blockptr, (GFunc) g_free, NULL);
+#ifdef USE_MAINTAINER_MODE
+    mc_log ("mcview: growing buffer of %u blocks: %lu hits, %lu loads, %lu spills\n",
+            view->growbuf_blocks->len, view->growbuf_hits, view->growbuf_loads,
+            view->growbuf_spills);
+#endif
 
-    (void) g_ptr_array_free (view->growbuf_blockptr, TRUE);
+    for (i = 0; i < view->growbuf_blocks->len; i++)
+        g_free (mcview_growbuf_block (view, i)->data);
 
-    view->growbuf_blockptr = NULL;
+    (void) g_array_free (view->growbuf_blocks, TRUE);
+
+    if (view->growbuf_spill_fd != -1)
+    {
+        (void) close (view->growbuf_spill_fd);
+        view->growbuf_spill_fd = -1;
+    }
+
+    view->growbuf_blocks = NULL;
     view->growbuf_in_use = FALSE;
 }
 
@@ -97,10 +332,10 @@ mcview_growbuf_filesize (mcview_t * view)
     assert (view->growbuf_in_use);
 #endif
 
-    if (view->growbuf_blockptr->len == 0)
+    if (view->growbuf_blocks->len == 0)
         return 0;
     else
-        return ((off_t) view->growbuf_blockptr->len - 1) * VIEW_PAGE_SIZE + view->growbuf_lastindex;
+        return ((off_t) view->growbuf_blocks->len - 1) * VIEW_PAGE_SIZE + view->growbuf_lastindex;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -127,21 +362,30 @@ mcview_growbuf_read_until (mcview_t * view, off_t ofs)
     short_read = FALSE;
     while (mcview_growbuf_filesize (view) < ofs || short_read)
     {
+        mcview_growbuf_block_t *block;
+
         if (view->growbuf_lastindex == VIEW_PAGE_SIZE)
         {
             /* Append a new block to the growing buffer */
-            byte *newblock = g_try_malloc (VIEW_PAGE_SIZE);
-            if (newblock == NULL)
+            mcview_growbuf_block_t newblock;
+
+            mcview_growbuf_make_room (view);
+
+            newblock.data = g_try_malloc (VIEW_PAGE_SIZE);
+            if (newblock.data == NULL)
                 return;
+            newblock.spilled = FALSE;
+            newblock.referenced = TRUE;
 
-            g_ptr_array_add (view->growbuf_blockptr, newblock);
+            g_array_append_val (view->growbuf_blocks, newblock);
+            view->growbuf_resident++;
             view->growbuf_lastindex = 0;
         }
-        p = g_ptr_array_index (view->growbuf_blockptr,
-                               view->growbuf_blockptr->len - 1) + view->growbuf_lastindex;
 
-        bytesfree = VIEW_PAGE_SIZE - view->growbuf_lastindex;
+        block = mcview_growbuf_block (view, view->growbuf_blocks->len - 1);
+        p = block->data + view->growbuf_lastindex;
 
+        bytesfree = VIEW_PAGE_SIZE - view->growbuf_lastindex;
         if (view->datasource == DS_STDIO_PIPE)
         {
             nread = fread (p, 1, bytesfree, view->ds_stdio_pipe);
@@ -183,39 +427,14 @@ mcview_growbuf_read_until (mcview_t * view, off_t ofs)
 gboolean
 mcview_get_byte_growing_buffer (mcview_t * view, off_t byte_index, int *retval)
 {
-    off_t pageno;
-    off_t pageindex;
-
-    if (retval != NULL)
-        *retval = -1;
+    byte *p;
 
-    pageno = byte_index / VIEW_PAGE_SIZE;
-    pageindex = byte_index % VIEW_PAGE_SIZE;
+    p = mcview_growbuf_get_ptr (view, byte_index, NULL);
 
-#ifdef HAVE_ASSERT_H
-    assert (view->growbuf_in_use);
-#endif
-
-    if (pageno < 0)
-        return FALSE;
+    if (retval != NULL)
+        *retval = p == NULL ? -1 : *p;
 
-    mcview_growbuf_read_until (view, byte_index + 1);
-    if (view->growbuf_blockptr->len == 0)
-        return FALSE;
-    if (pageno < (off_t) view->growbuf_blockptr->len - 1)
-    {
-        if (retval != NULL)
-            *retval = *((byte *) (g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex));
-        return TRUE;
-    }
-    if (pageno == (off_t) view->growbuf_blockptr->len - 1
-        && pageindex < (off_t) view->growbuf_lastindex)
-    {
-        if (retval != NULL)
-            *retval = *((byte *) (g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex));
-        return TRUE;
-    }
-    return FALSE;
+    return (p != NULL);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -223,25 +442,24 @@ mcview_get_byte_growing_buffer (mcview_t * view, off_t byte_index, int *retval)
 char *
 mcview_get_ptr_growing_buffer (mcview_t * view, off_t byte_index)
 {
-    off_t pageno = byte_index / VIEW_PAGE_SIZE;
-    off_t pageindex = byte_index % VIEW_PAGE_SIZE;
+    return (char *) mcview_growbuf_get_ptr (view, byte_index, NULL);
+}
 
-#ifdef HAVE_ASSERT_H
-    assert (view->growbuf_in_use);
-#endif
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to byte at offset p and number of bytes following it in the same page.
+ */
 
-    if (pageno < 0)
-        return NULL;
+char *
+mcview_get_chunk_growing_buffer (mcview_t * view, off_t p, size_t * len)
+{
+    char *ptr;
 
-    mcview_growbuf_read_until (view, byte_index + 1);
-    if (view->growbuf_blockptr->len == 0)
-        return NULL;
-    if (pageno < (off_t) view->growbuf_blockptr->len - 1)
-        return (char *) (g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex);
-    if (pageno == (off_t) view->growbuf_blockptr->len - 1
-        && pageindex < (off_t) view->growbuf_lastindex)
-        return (char *) (g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex);
-    return NULL;
+    ptr = (char *) mcview_growbuf_get_ptr (view, p, len);
+    if (ptr == NULL)
+        *len = 0;
+
+    return ptr;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -88,7 +88,8 @@ mcview_get_byte_file (mcview_t * view, off_t byte_index, int *retval)
     assert (view->datasource == DS_FILE);
 #endif
 
-    mcview_file_load_data (view, byte_index);
+    if (!mcview_already_loaded (view->ds_file_offset, byte_index, view->ds_file_datalen))
+        mcview_file_load_data (view, byte_index);
     if (mcview_already_loaded (view->ds_file_offset, byte_index, view->ds_file_datalen))
     {
         if (retval)
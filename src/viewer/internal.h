@@ -109,7 +109,8 @@ typedef struct mcview_struct
     off_t ds_file_offset;       /* Offset of the currently loaded data */
     byte *ds_file_data;         /* Currently loaded data */
     size_t ds_file_datalen;     /* Number of valid bytes in file_data */
-    size_t ds_file_datasize;    /* Number of allocated bytes in file_data */
+    GQueue *ds_file_pages;      /* Pages read from the file, most recently used first */
+    off_t ds_file_last_page;    /* Offset of the last used page: direction of read-ahead */
 
     /* string data source */
     byte *ds_string_data;       /* The characters of the string */
@@ -117,10 +118,17 @@ typedef struct mcview_struct
 
     /* Growing buffers information */
     gboolean growbuf_in_use;    /* Use the growing buffers? */
-    GPtrArray *growbuf_blockptr;        /* Pointer to the block pointers */
+    GArray *growbuf_blocks;     /* Blocks of data, in memory or in the spill file */
     size_t growbuf_lastindex;   /* Number of bytes in the last page of the
                                    growing buffer */
     gboolean growbuf_finished;  /* TRUE when all data has been read. */
+    size_t growbuf_resident;    /* Number of blocks in memory */
+    size_t growbuf_clock;       /* Next block to check for eviction */
+    int growbuf_spill_fd;       /* Temporary file for blocks evicted from memory */
+    gboolean growbuf_spill_failed;      /* Spill file cannot be used, keep all in memory */
+    gulong growbuf_hits;        /* Number of block accesses served from memory */
+    gulong growbuf_loads;       /* Number of blocks read back from the spill file */
+    gulong growbuf_spills;      /* Number of blocks written to the spill file */
 
     /* Editor modes */
     gboolean hex_mode;          /* Hexview or Hexedit */
@@ -235,6 +243,7 @@ off_t mcview_get_filesize (mcview_t *);
 void mcview_update_filesize (mcview_t * view);
 char *mcview_get_ptr_file (mcview_t *, off_t);
 char *mcview_get_ptr_string (mcview_t *, off_t);
+const char *mcview_get_chunk (mcview_t * view, off_t byte_index, size_t * len);
 int mcview_get_utf (mcview_t *, off_t, int *, gboolean *);
 gboolean mcview_get_byte_string (mcview_t *, off_t, int *);
 gboolean mcview_get_byte_none (mcview_t *, off_t, int *);
@@ -267,6 +276,7 @@ off_t mcview_growbuf_filesize (mcview_t * view);
 void mcview_growbuf_read_until (mcview_t * view, off_t p);
 gboolean mcview_get_byte_growing_buffer (mcview_t * view, off_t p, int *);
 char *mcview_get_ptr_growing_buffer (mcview_t * view, off_t p);
+char *mcview_get_chunk_growing_buffer (mcview_t * view, off_t p, size_t * len);
 
 /* hex.c: */
 void mcview_display_hex (mcview_t * view);
@@ -325,6 +335,7 @@ void mcview_display_text (mcview_t *);
 /* search.c: */
 mc_search_cbret_t mcview_search_cmd_callback (const void *user_data, gsize char_offset,
                                               int *current_char);
+const char *mcview_search_cmd_get_buf (const void *user_data, gsize char_offset, gsize * len);
 int mcview_search_update_cmd_callback (const void *, gsize);
 void mcview_do_search (mcview_t * view);
 
@@ -71,6 +71,9 @@ int mcview_max_dirt_limit = 10;
 /* Scrolling is done in pages or line increments */
 int mcview_mouse_move_pages = 1;
 
+/* Memory for output of commands and for uncompressed files in megabytes, 0 is unlimited */
+int mcview_pipe_memory_limit = 64;
+
 /* end of file will be showen from mcview_show_eof */
 char *mcview_show_eof = NULL;
 
@@ -82,6 +82,14 @@ mcview_find (mcview_t * view, off_t search_start, gsize * len)
     view->search_numNeedSkipChar = 0;
     search_cb_char_curr_index = -1;
 
+    /* nroff sequences are decoded char by char, plain data is matched by blocks */
+    view->search->search_buf_fn = view->text_nroff_mode ? NULL : mcview_search_cmd_get_buf;
+
+    if (mcview_search_options.backwards && !view->text_nroff_mode)
+        return mc_search_run_backward (view->search, (void *) view, search_start,
+                                       mcview_get_filesize (view), len);
+
+    /* nroff sequences must be decoded from the start of occurrence, so try each position */
     if (mcview_search_options.backwards)
     {
         search_end = mcview_get_filesize (view);
@@ -97,8 +105,7 @@ mcview_find (mcview_t * view, off_t search_start, gsize * len)
             if (mc_search_run (view->search, (void *) view, search_start, search_end, len)
                 && view->search->normal_offset == search_start)
             {
-                if (view->text_nroff_mode)
-                    view->search->normal_offset++;
+                view->search->normal_offset++;
                 return TRUE;
             }
 
@@ -213,14 +220,32 @@ mcview_search_cmd_callback (const void *user_data, gsize char_offset, int *curre
 
 /* --------------------------------------------------------------------------------------------- */
 
+const char *
+mcview_search_cmd_get_buf (const void *user_data, gsize char_offset, gsize * len)
+{
+    const char *chunk;
+    size_t chunk_len;
+
+    chunk = mcview_get_chunk ((mcview_t *) user_data, (off_t) char_offset, &chunk_len);
+    *len = chunk_len;
+    return chunk;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 int
 mcview_search_update_cmd_callback (const void *user_data, gsize char_offset)
 {
     mcview_t *view = (mcview_t *) user_data;
 
-    if ((off_t) char_offset >= view->update_activate)
+    /* backward search goes to the start of data */
+    if (mcview_search_options.backwards ? (off_t) char_offset <= view->update_activate
+        : (off_t) char_offset >= view->update_activate)
     {
-        view->update_activate += view->update_steps;
+        if (mcview_search_options.backwards)
+            view->update_activate -= view->update_steps;
+        else
+            view->update_activate += view->update_steps;
         if (verbose)
         {
             mcview_percent (view, char_offset);
@@ -288,7 +313,7 @@ mcview_do_search (mcview_t * view)
 
     /* Compute the percent steps */
     mcview_search_update_steps (view);
-    view->update_activate = 0;
+    view->update_activate = mcview_search_options.backwards ? search_start : 0;
 
     tty_enable_interrupt_key ();
 
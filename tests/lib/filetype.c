@@ -0,0 +1,220 @@
+/*
+   lib - built-in file type detection testing
+
+   Copyright (C) 2012
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "/lib"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "lib/global.h"
+#include "lib/filetype.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_str_equal (const char *result, const char *etalon)
+{
+    if (result == NULL || etalon == NULL)
+        return (result == etalon);
+
+    return (strcmp (result, etalon) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define check_sniff(buf, len, whole, etalon) \
+{ \
+    const char *result; \
+    result = mc_filetype_sniff ((const unsigned char *) (buf), (len), (whole)); \
+    fail_unless (test_str_equal (result, (etalon)), \
+                 "\nline %d: type (%s) not equal to\netalon (%s)", __LINE__, \
+                 result != NULL ? result : "NULL", (etalon) != NULL ? (etalon) : "NULL"); \
+}
+
+#define check_encoding(buf, len, whole, etalon) \
+{ \
+    const char *result; \
+    result = mc_filetype_sniff_encoding ((const unsigned char *) (buf), (len), (whole)); \
+    fail_unless (test_str_equal (result, (etalon)), \
+                 "\nline %d: encoding (%s) not equal to\netalon (%s)", __LINE__, \
+                 result != NULL ? result : "NULL", (etalon) != NULL ? (etalon) : "NULL"); \
+}
+
+/* data given by a string literal, without the terminating zero */
+#define check_sniff_str(str, whole, etalon) check_sniff (str, sizeof (str) - 1, whole, etalon)
+#define check_encoding_str(str, whole, etalon) check_encoding (str, sizeof (str) - 1, whole, etalon)
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_filetype_magic)
+{
+    unsigned char tar[512];
+    static const char elf[] =
+        "\x7f" "ELF\x02\x01\x01\0\0\0\0\0\0\0\0\0\x02\0\x3e\0\x01\0\0\0";
+    static const char png[] =
+        "\x89PNG\r\n\x1a\n\0\0\0\x0dIHDR\0\0\x01\x00\0\0\0\x40\x08\x06\0\0\0";
+    static const char zip[] = "PK\003\004\x14\0\0\0\x08\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"
+        "\x08\0\0\0" "data.txt";
+    static const char docx[] = "PK\003\004\x14\0\0\0\x08\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"
+        "\x13\0\0\0" "[Content_Types].xml";
+
+    check_sniff_str ("\xff\xd8\xff\xe0\0\x10JFIF", FALSE, "JPEG image data");
+    check_sniff_str ("\x1f\x8b\x08\0\0\0\0\0", FALSE, "gzip compressed data");
+    check_sniff_str ("BZh91AY&SY", FALSE, "bzip2 compressed data");
+    check_sniff_str ("\xfd" "7zXZ\0\0\x04", FALSE, "XZ compressed data");
+    check_sniff_str ("%PDF-1.4\n%\xe2\xe3\xcf\xd3\n", FALSE, "PDF document, version 1.4");
+    check_sniff_str ("GIF89a\x40\x01\xf0\x00", FALSE, "GIF image data, version 89a, 320 x 240");
+    check_sniff_str (png, FALSE, "PNG image data, 256 x 64");
+    check_sniff_str (elf, FALSE, "ELF 64-bit LSB executable");
+    check_sniff_str ("P6\n640 480\n255\n", FALSE, "Netpbm image data, rawbits, pixmap");
+    check_sniff_str (zip, FALSE, "Zip archive data");
+    /* office documents are left to file(1) */
+    check_sniff_str (docx, FALSE, NULL);
+
+    memset (tar, 0, sizeof (tar));
+    memcpy (tar, "file.txt", 8);
+    memcpy (tar + 257, "ustar  \0", 8);
+    check_sniff (tar, sizeof (tar), FALSE, "POSIX tar archive (GNU)");
+    memcpy (tar + 257, "ustar\0" "00", 8);
+    check_sniff (tar, sizeof (tar), FALSE, "POSIX tar archive");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_filetype_text)
+{
+    check_sniff_str ("Hello, world!\n\tSecond line\r\n", TRUE, "ASCII text");
+    check_encoding_str ("Hello, world!\n\tSecond line\r\n", TRUE, "ASCII");
+
+    /* escape sequences do not make text non-ASCII */
+    check_sniff_str ("\x1b[1mbold\x1b[0m text\n", TRUE, "ASCII text");
+    /* but ESC may start ISO-2022 shifts */
+    check_encoding_str ("\x1b$B$3$s$K$A$O\x1b(B\n", TRUE, NULL);
+
+    /* control characters */
+    check_sniff_str ("text\0with zero\n", TRUE, NULL);
+    check_encoding_str ("text\0with zero\n", TRUE, NULL);
+    check_sniff_str ("\x01\x02\x03\x04", TRUE, NULL);
+
+    /* file(1) tells more about these */
+    check_sniff_str ("#!/bin/sh\necho hello\n", TRUE, NULL);
+    check_sniff_str ("<html><body></body></html>\n", TRUE, NULL);
+    check_sniff_str ("From user@example.com Mon Jan  2 00:00:00 2012\n", TRUE, NULL);
+    check_sniff_str ("Return-Path: <user@example.com>\nSubject: hello\n\nbody\n", TRUE, NULL);
+    check_sniff_str ("Received: from mail.example.com by localhost\n", TRUE, NULL);
+    check_sniff_str ("Delivered-To: user@example.com\n", TRUE, NULL);
+    /* any header-like first line is deferred, a field name has no spaces */
+    check_sniff_str ("Hello: world\n", TRUE, NULL);
+    check_sniff_str ("Hello world: text\n", TRUE, "ASCII text");
+    check_sniff_str (":colon first\n", TRUE, "ASCII text");
+
+    /* empty file */
+    check_sniff ("", 0, TRUE, "empty");
+    check_sniff ("", 0, FALSE, NULL);
+    check_encoding ("", 0, TRUE, NULL);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_filetype_utf8)
+{
+    /* "Привет, мир!" */
+    static const char utf8[] =
+        "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, \xd0\xbc\xd0\xb8\xd1\x80!\n";
+    /* "café au lait" in ISO-8859-1 */
+    static const char latin1[] = "caf\xe9 au lait\n";
+
+    check_sniff_str (utf8, TRUE, "UTF-8 Unicode text");
+    check_encoding_str (utf8, TRUE, "UTF-8");
+
+    /* 8-bit text is left to enca */
+    check_sniff_str (latin1, TRUE, NULL);
+    check_encoding_str (latin1, TRUE, NULL);
+
+    /* overlong encoding */
+    check_sniff_str ("slash \xc0\xaf\n", TRUE, NULL);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_filetype_truncated)
+{
+    /* "Привет" cut in the middle of the last character */
+    static const char utf8[] = "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1";
+    static const char elf[] = "\x7f" "ELF\x02\x01\x01\0\0\0\0\0";
+    static const char png[] = "\x89PNG\r\n\x1a\n\0\0";
+
+    /* a multibyte character may be cut at the end of the first block only */
+    check_sniff_str (utf8, FALSE, "UTF-8 Unicode text");
+    check_encoding_str (utf8, FALSE, "UTF-8");
+    check_sniff_str (utf8, TRUE, NULL);
+    check_encoding_str (utf8, TRUE, NULL);
+
+    /* headers shorter than needed */
+    check_sniff_str (elf, FALSE, NULL);
+    check_sniff_str (png, FALSE, "PNG image data");
+    check_sniff_str ("GIF89a\x40\x01", FALSE, NULL);
+    check_sniff_str ("PK\003\004\x14\0\0\0", FALSE, NULL);
+    check_sniff_str ("\xff\xd8", FALSE, NULL);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_filetype_magic);
+    tcase_add_test (tc_core, test_filetype_text);
+    tcase_add_test (tc_core, test_filetype_utf8);
+    tcase_add_test (tc_core, test_filetype_truncated);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "filetype.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
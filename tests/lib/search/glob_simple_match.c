@@ -0,0 +1,151 @@
+/*
+   libmc - checks for matching simple globs without regex
+
+   Copyright (C) 2012
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "lib/search/glob"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "glob.c" /* for testing static functions */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_helper_check_kind (const char *glob, gboolean case_sensitive,
+                        mc_search__glob_simple_t etalon_kind, const char *etalon_literal)
+{
+    mc_search_t search;
+    mc_search_cond_t cond;
+
+    memset (&search, 0, sizeof (search));
+    memset (&cond, 0, sizeof (cond));
+    search.is_entire_line = TRUE;
+    search.is_case_sensitive = case_sensitive;
+    cond.str = g_string_new (glob);
+
+    mc_search__glob_simple_init (&search, &cond);
+
+    fail_unless (cond.glob_simple == etalon_kind, "glob (%s): kind (%d) != %d", glob,
+                 cond.glob_simple, etalon_kind);
+    if (etalon_literal != NULL)
+        fail_unless (cond.glob_literal != NULL && strcmp (cond.glob_literal->str, etalon_literal) == 0,
+                     "glob (%s): literal (%s) != %s", glob,
+                     cond.glob_literal != NULL ? cond.glob_literal->str : "NULL", etalon_literal);
+
+    if (cond.glob_literal != NULL)
+        g_string_free (cond.glob_literal, TRUE);
+    g_string_free (cond.str, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_helper_check_match (const char *glob, gboolean case_sensitive, const char *str,
+                         gboolean etalon)
+{
+    mc_search_t search;
+    mc_search_cond_t cond;
+    gboolean result;
+
+    memset (&search, 0, sizeof (search));
+    memset (&cond, 0, sizeof (cond));
+    search.is_entire_line = TRUE;
+    search.is_case_sensitive = case_sensitive;
+    cond.str = g_string_new (glob);
+
+    mc_search__glob_simple_init (&search, &cond);
+    result = mc_search__glob_simple_match (&search, &cond, str, strlen (str));
+
+    fail_unless (result == etalon, "glob (%s) matches (%s): %d != %d", glob, str, result, etalon);
+
+    if (cond.glob_literal != NULL)
+        g_string_free (cond.glob_literal, TRUE);
+    g_string_free (cond.str, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_glob_simple_kind)
+{
+    test_helper_check_kind ("file.c", TRUE, GLOB__EXACT, "file.c");
+    test_helper_check_kind ("*.c", TRUE, GLOB__SUFFIX, ".c");
+    test_helper_check_kind ("Make*", TRUE, GLOB__PREFIX, "Make");
+    test_helper_check_kind ("*tmp*", TRUE, GLOB__SUBSTR, "tmp");
+    test_helper_check_kind ("*", TRUE, GLOB__SUFFIX, "");
+    test_helper_check_kind ("a\\[1\\]*", TRUE, GLOB__PREFIX, "a[1]");
+    test_helper_check_kind ("a*b", TRUE, GLOB__NOT_SIMPLE, NULL);
+    test_helper_check_kind ("a?", TRUE, GLOB__NOT_SIMPLE, NULL);
+    test_helper_check_kind ("*.{c,h}", TRUE, GLOB__NOT_SIMPLE, NULL);
+    test_helper_check_kind ("[ab]*", TRUE, GLOB__NOT_SIMPLE, NULL);
+    test_helper_check_kind ("a\\,b*", TRUE, GLOB__NOT_SIMPLE, NULL);
+    test_helper_check_kind ("\\d*", TRUE, GLOB__NOT_SIMPLE, NULL);
+    test_helper_check_kind ("\xd0\xb0*", TRUE, GLOB__PREFIX, "\xd0\xb0");
+    test_helper_check_kind ("\xd0\xb0*", FALSE, GLOB__NOT_SIMPLE, NULL);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_glob_simple_match)
+{
+    test_helper_check_match ("*.c", TRUE, "file.c", TRUE);
+    test_helper_check_match ("*.c", TRUE, "file.C", FALSE);
+    test_helper_check_match ("*.c", FALSE, "file.C", TRUE);
+    test_helper_check_match ("*.c", TRUE, "file.cc", FALSE);
+    test_helper_check_match ("*.c", TRUE, "c", FALSE);
+    test_helper_check_match ("Make*", TRUE, "Makefile.am", TRUE);
+    test_helper_check_match ("Make*", TRUE, "make", FALSE);
+    test_helper_check_match ("*tmp*", TRUE, "a.tmp.b", TRUE);
+    test_helper_check_match ("*tmp*", TRUE, "tmp", TRUE);
+    test_helper_check_match ("*tmp*", TRUE, "tm", FALSE);
+    test_helper_check_match ("file.c", TRUE, "file.c", TRUE);
+    test_helper_check_match ("file.c", TRUE, "file.cc", FALSE);
+    test_helper_check_match ("*", TRUE, "", TRUE);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_glob_simple_kind);
+    tcase_add_test (tc_core, test_glob_simple_match);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
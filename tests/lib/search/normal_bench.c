@@ -0,0 +1,188 @@
+/*
+   libmc - throughput of plain search
+
+   Copyright (C) 2013
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   This is not a part of the test suite. Build and run it by hand:
+
+   make -C tests/lib/search normal_bench
+   tests/lib/search/normal_bench
+
+   A plain string is searched in 64 MB of text where it occurs only at the end. The search
+   without regex is compared against the string translated to regex and matched line by line,
+   as the plain search did before. Data is given by blocks, like the editor and viewer do, and
+   as one string, like the diff viewer does.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include "lib/search/normal.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define BENCH_DATA_LEN (64 * 1024 * 1024)
+#define BENCH_BLOCK_SIZE 8192
+#define BENCH_NEEDLE "needle"
+
+static char *bench_data = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+bench_get_buf (const void *user_data, gsize offset, gsize * len)
+{
+    const char *data = (const char *) user_data;
+
+    if (offset >= BENCH_DATA_LEN)
+        return NULL;
+
+    *len = MIN (BENCH_BLOCK_SIZE, BENCH_DATA_LEN - offset);
+    return data + offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_make_data (void)
+{
+    /* without 'd' the needle cannot occur by chance */
+    static const char alphabet[] = "abcefghijklmnopqrstuvwxyz          \n";
+    GRand *rand;
+    gsize i;
+
+    bench_data = g_malloc (BENCH_DATA_LEN + 1);
+
+    rand = g_rand_new_with_seed (BENCH_DATA_LEN);
+    for (i = 0; i < BENCH_DATA_LEN; i++)
+        bench_data[i] = alphabet[g_rand_int_range (rand, 0, sizeof (alphabet) - 1)];
+    bench_data[BENCH_DATA_LEN] = '\0';
+    g_rand_free (rand);
+
+    memcpy (bench_data + BENCH_DATA_LEN - sizeof (BENCH_NEEDLE), BENCH_NEEDLE,
+            sizeof (BENCH_NEEDLE) - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search the needle in the whole data.
+ *
+ * @param use_regex TRUE to hide the literal so that the regex is used
+ *
+ * @return search time in seconds, negative if the needle was not found at its place
+ */
+
+static double
+bench_search (mc_search_t * search, gboolean use_regex)
+{
+    mc_search_cond_t *mc_search_cond;
+    GString *literal;
+    GTimer *timer;
+    gboolean found;
+    double elapsed;
+
+    mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (search->conditions, 0);
+    literal = mc_search_cond->normal_literal;
+    if (use_regex)
+        mc_search_cond->normal_literal = NULL;
+
+    timer = g_timer_new ();
+    found = mc_search_run (search, bench_data, 0, BENCH_DATA_LEN - 1, NULL);
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    mc_search_cond->normal_literal = literal;
+
+    if (!found || search->normal_offset != BENCH_DATA_LEN - sizeof (BENCH_NEEDLE))
+        return -1.0;
+
+    return MAX (elapsed, 1e-6);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    static const struct
+    {
+        const char *pattern;
+        gboolean case_sensitive;
+        gboolean by_blocks;
+    } runs[] =
+    {
+        /* *INDENT-OFF* */
+        { BENCH_NEEDLE, TRUE, TRUE },
+        { "NeEdLe", FALSE, TRUE },
+        { BENCH_NEEDLE, TRUE, FALSE },
+        { "NeEdLe", FALSE, FALSE }
+        /* *INDENT-ON* */
+    };
+    size_t i;
+    int ret = 0;
+
+    str_init_strings (NULL);
+    bench_make_data ();
+
+    for (i = 0; i < G_N_ELEMENTS (runs); i++)
+    {
+        mc_search_t *search;
+        double literal, regex;
+
+        search = mc_search_new (runs[i].pattern, -1);
+        search->search_type = MC_SEARCH_T_NORMAL;
+        search->is_case_sensitive = runs[i].case_sensitive;
+        if (runs[i].by_blocks)
+            search->search_buf_fn = bench_get_buf;
+
+        if (!mc_search_prepare (search))
+        {
+            fprintf (stderr, "%s: cannot prepare the search\n", runs[i].pattern);
+            ret = 1;
+        }
+        else
+        {
+            literal = bench_search (search, FALSE);
+            regex = bench_search (search, TRUE);
+
+            if (literal < 0 || regex < 0)
+            {
+                fprintf (stderr, "%s: needle not found at its place\n", runs[i].pattern);
+                ret = 1;
+            }
+            else
+                printf ("%s, %s, %s: literal %.1f MB/s, regex %.1f MB/s\n", runs[i].pattern,
+                        runs[i].case_sensitive ? "case sensitive" : "case insensitive",
+                        runs[i].by_blocks ? "blocks" : "string",
+                        BENCH_DATA_LEN / 1e6 / literal, BENCH_DATA_LEN / 1e6 / regex);
+        }
+
+        mc_search_free (search);
+    }
+
+    g_free (bench_data);
+    str_uninit_strings ();
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
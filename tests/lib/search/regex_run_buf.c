@@ -0,0 +1,183 @@
+/*
+   libmc - checks for searching in data fetched by blocks
+
+   Copyright (C) 2012
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "lib/search/regex"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *test_data = "first line\nsecond line with needle\nneeeedle\nlast";
+static gsize test_block_size;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+test_get_buf (const void *user_data, gsize offset, gsize * len)
+{
+    const char *data = (const char *) user_data;
+    gsize data_len;
+
+    data_len = strlen (data);
+    if (offset >= data_len)
+        return NULL;
+
+    *len = MIN (test_block_size, data_len - offset);
+    return data + offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_helper_check (mc_search_type_t type, const char *pattern, gboolean case_sensitive,
+                   gsize start, gsize end, gboolean etalon_found, off_t etalon_offset,
+                   gsize etalon_len)
+{
+    static const gsize block_sizes[] = { 1, 2, 3, 7, 4096 };
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS (block_sizes); i++)
+    {
+        mc_search_t *search;
+        gboolean found;
+        gsize found_len = 0;
+
+        test_block_size = block_sizes[i];
+
+        search = mc_search_new (pattern, -1);
+        search->search_type = type;
+        search->is_case_sensitive = case_sensitive;
+        search->search_buf_fn = test_get_buf;
+
+        found = mc_search_run (search, test_data, start, end, &found_len);
+
+        fail_unless (found == etalon_found, "(%s) block %zu: found %d != %d", pattern,
+                     test_block_size, found, etalon_found);
+        if (etalon_found)
+        {
+            fail_unless (search->normal_offset == etalon_offset,
+                         "(%s) block %zu: offset %ld != %ld", pattern, test_block_size,
+                         (long) search->normal_offset, (long) etalon_offset);
+            fail_unless (found_len == etalon_len, "(%s) block %zu: length %zu != %zu", pattern,
+                         test_block_size, found_len, etalon_len);
+        }
+        else
+            fail_unless (search->error == MC_SEARCH_E_NOTFOUND && search->error_str != NULL,
+                         "(%s) block %zu: search is not finished as not found", pattern,
+                         test_block_size);
+
+        mc_search_free (search);
+    }
+
+    /* same search in string */
+    {
+        mc_search_t *search;
+        gboolean found;
+        gsize found_len = 0;
+
+        search = mc_search_new (pattern, -1);
+        search->search_type = type;
+        search->is_case_sensitive = case_sensitive;
+
+        found = mc_search_run (search, test_data, start, end, &found_len);
+
+        fail_unless (found == etalon_found, "(%s) string: found %d != %d", pattern, found,
+                     etalon_found);
+        if (etalon_found)
+            fail_unless (search->normal_offset == etalon_offset && found_len == etalon_len,
+                         "(%s) string: offset %ld, length %zu != %ld, %zu", pattern,
+                         (long) search->normal_offset, found_len, (long) etalon_offset,
+                         etalon_len);
+
+        mc_search_free (search);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_regex_run_buf)
+{
+    gsize len;
+
+    len = strlen (test_data);
+
+    /* match inside one line */
+    test_helper_check (MC_SEARCH_T_NORMAL, "needle", TRUE, 0, len, TRUE, 28, 6);
+    test_helper_check (MC_SEARCH_T_NORMAL, "needle", TRUE, 29, len, FALSE, 0, 0);
+    /* end of search cuts the match */
+    test_helper_check (MC_SEARCH_T_NORMAL, "needle", TRUE, 0, 30, FALSE, 0, 0);
+    /* lines are matched separately */
+    test_helper_check (MC_SEARCH_T_NORMAL, "line\nsec", TRUE, 0, len, FALSE, 0, 0);
+    test_helper_check (MC_SEARCH_T_REGEX, "ne+dle$", TRUE, 0, len, TRUE, 28, 6);
+    test_helper_check (MC_SEARCH_T_REGEX, "ne{3,}dle", TRUE, 0, len, TRUE, 35, 8);
+    /* last line without newline */
+    test_helper_check (MC_SEARCH_T_REGEX, "^last", TRUE, 0, len, TRUE, 44, 4);
+    test_helper_check (MC_SEARCH_T_REGEX, "t$", TRUE, 40, len, TRUE, 47, 1);
+
+    /* normal search without regex */
+    test_helper_check (MC_SEARCH_T_NORMAL, "NeEdLe", FALSE, 0, len, TRUE, 28, 6);
+    test_helper_check (MC_SEARCH_T_NORMAL, "NeEdLe", TRUE, 0, len, FALSE, 0, 0);
+    test_helper_check (MC_SEARCH_T_NORMAL, "EEEE", FALSE, 0, len, TRUE, 36, 4);
+    test_helper_check (MC_SEARCH_T_NORMAL, "e", TRUE, 36, 38, TRUE, 36, 1);
+    test_helper_check (MC_SEARCH_T_NORMAL, "last", TRUE, 0, len, TRUE, 44, 4);
+    test_helper_check (MC_SEARCH_T_NORMAL, "ast", TRUE, 0, 46, FALSE, 0, 0);
+    test_helper_check (MC_SEARCH_T_NORMAL, "lastt", TRUE, 0, len, FALSE, 0, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    str_init_strings (NULL);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_regex_run_buf);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+
+    str_uninit_strings ();
+
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,336 @@
+/*
+   libmc - checks for backward search
+
+   Copyright (C) 2012
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "lib/search/backward"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define TEST_DATA_LEN 20000
+
+static char *test_data = NULL;
+static gsize test_data_len;
+static gsize test_block_size;
+
+/* check whether occurrence of anchored pattern may start at pos */
+typedef gboolean (*test_anchor_fn) (gsize pos);
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+test_get_buf (const void *user_data, gsize offset, gsize * len)
+{
+    const char *data = (const char *) user_data;
+
+    if (offset >= test_data_len)
+        return NULL;
+
+    *len = MIN (test_block_size, test_data_len - offset);
+    return data + offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_make_data (gsize len, const char *alphabet)
+{
+    GRand *rand;
+    gsize i, n;
+
+    g_free (test_data);
+    test_data = g_malloc (len + 1);
+    test_data_len = len;
+
+    rand = g_rand_new_with_seed (len);
+    n = strlen (alphabet);
+    for (i = 0; i < len; i++)
+        test_data[i] = alphabet[g_rand_int_range (rand, 0, n)];
+    test_data[len] = '\0';
+    g_rand_free (rand);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_set_data (const char *str)
+{
+    g_free (test_data);
+    test_data = g_strdup (str);
+    test_data_len = strlen (str);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_at_line_start (gsize pos)
+{
+    return (pos == 0 || test_data[pos - 1] == '\n');
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_at_line_end (gsize pos)
+{
+    return (pos + 1 == test_data_len || test_data[pos + 1] == '\n');
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_at_word_start (gsize pos)
+{
+    return (pos == 0 || !(g_ascii_isalnum (test_data[pos - 1]) || test_data[pos - 1] == '_'));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+test_search_new (mc_search_type_t type, const char *pattern, gboolean case_sensitive)
+{
+    mc_search_t *search;
+
+    search = mc_search_new (pattern, -1);
+    search->search_type = type;
+    search->is_case_sensitive = case_sensitive;
+    search->search_buf_fn = test_get_buf;
+
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Reference backward search: look for occurrence starting exactly at each position.
+ */
+
+static gboolean
+test_run_backward_by_pos (mc_search_t * search, gsize start, gsize * offset, gsize * found_len)
+{
+    gsize pos;
+
+    for (pos = start + 1; pos-- > 0;)
+    {
+        gsize end = test_data_len;
+
+        if (mc_search_is_fixed_search_str (search))
+            end = MIN (end, pos + search->original_len);
+
+        if (mc_search_run (search, test_data, pos, end, found_len)
+            && (gsize) search->normal_offset == pos)
+        {
+            *offset = pos;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_helper_check (mc_search_type_t type, const char *pattern, gboolean case_sensitive)
+{
+    static const gsize block_sizes[] = { 1, 7, 4096, G_MAXSIZE };
+    static const gsize starts[] = { 0, 1, 100, 4095, 4096, 12345, TEST_DATA_LEN - 1 };
+    size_t i, j;
+
+    for (i = 0; i < G_N_ELEMENTS (block_sizes); i++)
+    {
+        test_block_size = block_sizes[i];
+
+        for (j = 0; j < G_N_ELEMENTS (starts); j++)
+        {
+            mc_search_t *search, *etalon;
+            gboolean found, etalon_found;
+            gsize found_len = 0, etalon_offset = 0, etalon_len = 0;
+
+            search = test_search_new (type, pattern, case_sensitive);
+            etalon = test_search_new (type, pattern, case_sensitive);
+
+            found = mc_search_run_backward (search, test_data, starts[j], test_data_len,
+                                            &found_len);
+            etalon_found = test_run_backward_by_pos (etalon, starts[j], &etalon_offset,
+                                                     &etalon_len);
+
+            fail_unless (found == etalon_found, "(%s) block %zu, start %zu: found %d != %d",
+                         pattern, test_block_size, starts[j], found, etalon_found);
+            if (etalon_found)
+                fail_unless ((gsize) search->normal_offset == etalon_offset
+                             && found_len == etalon_len,
+                             "(%s) block %zu, start %zu: offset %ld, length %zu != %zu, %zu",
+                             pattern, test_block_size, starts[j], (long) search->normal_offset,
+                             found_len, etalon_offset, etalon_len);
+            else
+                fail_unless (search->error == MC_SEARCH_E_NOTFOUND && search->error_str != NULL,
+                             "(%s) block %zu, start %zu: search is not finished as not found",
+                             pattern, test_block_size, starts[j]);
+
+            mc_search_free (etalon);
+            mc_search_free (search);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check regex of one "a" with anchor. Occurrences found at each position cannot be the
+ * reference: the search started at the position takes it as the line start.
+ */
+
+static void
+test_helper_check_anchored (const char *pattern, test_anchor_fn anchor, gsize start)
+{
+    static const gsize block_sizes[] = { 1, 7, 4096, G_MAXSIZE };
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS (block_sizes); i++)
+    {
+        mc_search_t *search;
+        gboolean found, etalon_found = FALSE;
+        gsize pos, found_len = 0;
+
+        test_block_size = block_sizes[i];
+
+        for (pos = start + 1; pos-- > 0;)
+            if (test_data[pos] == 'a' && anchor (pos))
+            {
+                etalon_found = TRUE;
+                break;
+            }
+
+        search = test_search_new (MC_SEARCH_T_REGEX, pattern, TRUE);
+        found = mc_search_run_backward (search, test_data, start, test_data_len, &found_len);
+
+        fail_unless (found == etalon_found, "(%s) block %zu, start %zu: found %d != %d",
+                     pattern, test_block_size, start, found, etalon_found);
+        if (etalon_found)
+            fail_unless ((gsize) search->normal_offset == pos && found_len == 1,
+                         "(%s) block %zu, start %zu: offset %ld, length %zu != %zu, 1",
+                         pattern, test_block_size, start, (long) search->normal_offset,
+                         found_len, pos);
+
+        mc_search_free (search);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_run_backward)
+{
+    test_make_data (TEST_DATA_LEN, "abcdeeeeeeeeee\n");
+
+    test_helper_check (MC_SEARCH_T_NORMAL, "abc", TRUE);
+    test_helper_check (MC_SEARCH_T_NORMAL, "eEe", FALSE);
+    test_helper_check (MC_SEARCH_T_NORMAL, "abcdab", TRUE);
+    test_helper_check (MC_SEARCH_T_NORMAL, "xyz", TRUE);
+    test_helper_check (MC_SEARCH_T_REGEX, "ab+c", TRUE);
+    test_helper_check (MC_SEARCH_T_REGEX, "d[ab]+c", TRUE);
+    test_helper_check (MC_SEARCH_T_REGEX, "cd\n", TRUE);
+    test_helper_check (MC_SEARCH_T_HEX, "61 62 63 64", TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_run_backward_anchored)
+{
+    static const char *const alphabets[] = {
+        "aab \n",
+        /* lines are longer than the first block */
+        "aab b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b"
+            "b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b"
+            "b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b b\n"
+    };
+    static const gsize starts[] = { 0, 1, 100, 4095, 4096, 4097, 12345, TEST_DATA_LEN - 1 };
+    size_t i, j;
+
+    /* "^" does not match in the middle of the line */
+    test_set_data ("ab");
+    test_helper_check_anchored ("^a", test_at_line_start, 1);
+    test_set_data ("bab");
+    test_helper_check_anchored ("^a", test_at_line_start, 2);
+    test_set_data ("aaa");
+    test_helper_check_anchored ("^a", test_at_line_start, 2);
+    test_set_data ("a\naa");
+    test_helper_check_anchored ("^a", test_at_line_start, 3);
+    test_set_data ("aaa");
+    test_helper_check_anchored ("a$", test_at_line_end, 1);
+    test_helper_check_anchored ("\\ba", test_at_word_start, 2);
+
+    for (i = 0; i < G_N_ELEMENTS (alphabets); i++)
+    {
+        test_make_data (TEST_DATA_LEN, alphabets[i]);
+
+        /* block boundaries are at 4096 and 8192 bytes before start */
+        for (j = 0; j < G_N_ELEMENTS (starts); j++)
+        {
+            test_helper_check_anchored ("^a", test_at_line_start, starts[j]);
+            test_helper_check_anchored ("a$", test_at_line_end, starts[j]);
+            test_helper_check_anchored ("\\ba", test_at_word_start, starts[j]);
+        }
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    str_init_strings (NULL);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_run_backward);
+    tcase_add_test (tc_core, test_run_backward_anchored);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+
+    str_uninit_strings ();
+    g_free (test_data);
+
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,143 @@
+/*
+   libmc - throughput of backward search
+
+   Copyright (C) 2012
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   This is not a part of the test suite. Build and run it by hand:
+
+   make -C tests/lib/search run_backward_bench
+   tests/lib/search/run_backward_bench
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define BENCH_DATA_LEN (16 * 1024 * 1024)
+#define BENCH_BLOCK_SIZE 8192
+
+static char *bench_data = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+bench_get_buf (const void *user_data, gsize offset, gsize * len)
+{
+    const char *data = (const char *) user_data;
+
+    if (offset >= BENCH_DATA_LEN)
+        return NULL;
+
+    *len = MIN (BENCH_BLOCK_SIZE, BENCH_DATA_LEN - offset);
+    return data + offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_make_data (const char *alphabet)
+{
+    GRand *rand;
+    gsize i, n;
+
+    bench_data = g_malloc (BENCH_DATA_LEN + 1);
+
+    rand = g_rand_new_with_seed (BENCH_DATA_LEN);
+    n = strlen (alphabet);
+    for (i = 0; i < BENCH_DATA_LEN; i++)
+        bench_data[i] = alphabet[g_rand_int_range (rand, 0, n)];
+    bench_data[BENCH_DATA_LEN] = '\0';
+    g_rand_free (rand);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare throughput of forward and backward search over data without occurrences.
+ */
+
+int
+main (void)
+{
+    static const struct
+    {
+        mc_search_type_t type;
+        const char *pattern;
+    } patterns[] =
+    {
+        {MC_SEARCH_T_NORMAL, "needle1"},
+        {MC_SEARCH_T_REGEX, "ne+dle[0-9]"}
+    };
+    size_t i;
+    int ret = 0;
+
+    str_init_strings (NULL);
+    bench_make_data ("abcdefghijklmnopqrstuvwxyz          \n");
+
+    for (i = 0; i < G_N_ELEMENTS (patterns); i++)
+    {
+        mc_search_t *search;
+        GTimer *timer;
+        double forward, backward;
+        gboolean found_forward, found_backward;
+
+        search = mc_search_new (patterns[i].pattern, -1);
+        search->search_type = patterns[i].type;
+        search->is_case_sensitive = TRUE;
+        search->search_buf_fn = bench_get_buf;
+
+        timer = g_timer_new ();
+
+        found_forward = mc_search_run (search, bench_data, 0, BENCH_DATA_LEN, NULL);
+        forward = g_timer_elapsed (timer, NULL);
+
+        g_timer_start (timer);
+        found_backward = mc_search_run_backward (search, bench_data, BENCH_DATA_LEN - 1,
+                                                 BENCH_DATA_LEN, NULL);
+        backward = g_timer_elapsed (timer, NULL);
+
+        if (found_forward || found_backward)
+        {
+            fprintf (stderr, "%s: unexpected occurrence at %ld\n", patterns[i].pattern,
+                     (long) search->normal_offset);
+            ret = 1;
+        }
+        else
+            printf ("%s: forward %.1f MB/s, backward %.1f MB/s\n", patterns[i].pattern,
+                    BENCH_DATA_LEN / 1e6 / MAX (forward, 1e-6),
+                    BENCH_DATA_LEN / 1e6 / MAX (backward, 1e-6));
+
+        g_timer_destroy (timer);
+        mc_search_free (search);
+    }
+
+    g_free (bench_data);
+    str_uninit_strings ();
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,291 @@
+/*
+   src/diffviewer - comparison of files benchmark
+
+   Copyright (C) 2013
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   This is not a part of the test suite. Build and run it by hand:
+
+   make -C tests/src/diffviewer ydiff_bench
+   tests/src/diffviewer/ydiff_bench
+
+   Two files of 300000 lines which differ in 3000 places are compared by the built-in diff
+   and by diff(1) run through popen() as the diff viewer did before. Both ways end with
+   the lines prepared for display.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include "src/diffviewer/ydiff.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define BENCH_LINES 300000
+#define BENCH_EDITS 3000
+#define BENCH_RUNS 5
+
+static char *bench_file[DIFF_COUNT];
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_append_line (GString * text, GRand * rand)
+{
+    int n;
+
+    n = g_rand_int_range (rand, 0, BENCH_LINES);
+    g_string_append_printf (text, "line %d", n);
+    /* lines of different length, some of them repeat */
+    for (n %= 4; n > 0; n--)
+        g_string_append_printf (text, " word%d", g_rand_int_range (rand, 0, 100));
+    g_string_append_c (text, '\n');
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+bench_make_files (void)
+{
+    GString *text[DIFF_COUNT];
+    GRand *rand;
+    gboolean ok = TRUE;
+    int i, ord;
+
+    rand = g_rand_new_with_seed (BENCH_LINES);
+    text[DIFF_LEFT] = g_string_sized_new (BENCH_LINES * 32);
+    text[DIFF_RIGHT] = g_string_sized_new (BENCH_LINES * 32);
+
+    for (i = 0; i < BENCH_LINES; i++)
+    {
+        gsize len = text[DIFF_LEFT]->len;
+
+        bench_append_line (text[DIFF_LEFT], rand);
+
+        /* the line is deleted, changed, has a new line before it or is kept */
+        switch (g_rand_int_range (rand, 0, BENCH_LINES / BENCH_EDITS * 3))
+        {
+        case 0:
+            break;
+        case 1:
+            bench_append_line (text[DIFF_RIGHT], rand);
+            break;
+        case 2:
+            bench_append_line (text[DIFF_RIGHT], rand);
+            /* fall through */
+        default:
+            g_string_append_len (text[DIFF_RIGHT], text[DIFF_LEFT]->str + len,
+                                 text[DIFF_LEFT]->len - len);
+            break;
+        }
+    }
+
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+    {
+        char name[32];
+
+        g_snprintf (name, sizeof (name), "mc-ydiff-bench-%d", ord + 1);
+        bench_file[ord] = g_build_filename (g_get_tmp_dir (), name, (char *) NULL);
+        ok = ok && g_file_set_contents (bench_file[ord], text[ord]->str, text[ord]->len, NULL);
+        g_string_free (text[ord], TRUE);
+    }
+
+    g_rand_free (rand);
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_free_lines (WDiff * dview)
+{
+    int ord;
+
+    destroy_hdiff (dview);
+
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT; ord++)
+    {
+        g_array_foreach (dview->a[ord], DIFFLN, cc_free_elt);
+        g_array_set_size (dview->a[ord], 0);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Parse a line of diff(1) output like the diff viewer did: "NUM[,NUM]{a|c|d}NUM[,NUM]" */
+
+static gboolean
+bench_scan_line (const char *p, GArray * ops)
+{
+    DIFFCMD op;
+
+    if (scan_deci (&p, &op.a[0][0]) != 0)
+        return FALSE;
+    op.a[0][1] = op.a[0][0];
+    if (*p == ',' && (p++, scan_deci (&p, &op.a[0][1]) != 0))
+        return FALSE;
+
+    op.cmd = *p++;
+
+    if (scan_deci (&p, &op.a[1][0]) != 0)
+        return FALSE;
+    op.a[1][1] = op.a[1][0];
+    if (*p == ',' && (p++, scan_deci (&p, &op.a[1][1]) != 0))
+        return FALSE;
+
+    g_array_append_val (ops, op);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare files by diff(1) and reread them for display.
+ *
+ * @return number of hunks, negative on error
+ */
+
+static int
+bench_external (WDiff * dview)
+{
+    static const char *opt =
+        " --old-group-format='%df%(f=l?:,%dl)d%dE\n'"
+        " --new-group-format='%dea%dF%(F=L?:,%dL)\n'"
+        " --changed-group-format='%df%(f=l?:,%dl)c%dF%(F=L?:,%dL)\n'"
+        " --unchanged-group-format=''";
+    PRINTER_CTX ctx;
+    GArray *ops;
+    FILE *f;
+    char *cmd;
+    char buf[BUFSIZ];
+    int ord, rv = 0;
+
+    cmd = g_strdup_printf ("diff %s '%s' '%s'", opt, bench_file[DIFF_LEFT],
+                           bench_file[DIFF_RIGHT]);
+    f = popen (cmd, "r");
+    g_free (cmd);
+    if (f == NULL)
+        return -1;
+
+    ops = g_array_new (FALSE, FALSE, sizeof (DIFFCMD));
+    while (fgets (buf, sizeof (buf), f) != NULL)
+        if (!bench_scan_line (buf, ops))
+            rv = -1;
+    if (pclose (f) == -1)
+        rv = -1;
+
+    ctx.dsrc = DATA_SRC_MEM;
+    ctx.f = NULL;
+
+    for (ord = DIFF_LEFT; ord < DIFF_COUNT && rv == 0; ord++)
+    {
+        char *text;
+        gsize size;
+
+        if (!g_file_get_contents (dview->file[ord], &text, &size, NULL))
+            rv = -1;
+        else
+        {
+            ctx.a = dview->a[ord];
+            rv = dff_reparse (ord, text, size, ops, printer, &ctx);
+            g_free (text);
+        }
+    }
+
+    if (rv == 0)
+        rv = ops->len;
+    g_array_free (ops, TRUE);
+
+    return rv;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_report (const char *what, GTimer * timer, int ndiff, guint nlines)
+{
+    double elapsed;
+
+    elapsed = g_timer_elapsed (timer, NULL);
+    printf ("%-24s %9.1f ms per run, %d hunks, %u lines\n", what,
+            elapsed * 1000.0 / BENCH_RUNS, ndiff, nlines);
+    g_timer_start (timer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    WDiff *dview;
+    GTimer *timer;
+    guint nlines = 0;
+    int i, ndiff = 0, ret = 0;
+
+    if (!bench_make_files ())
+    {
+        fprintf (stderr, "cannot write files to %s\n", g_get_tmp_dir ());
+        return 1;
+    }
+
+    dview = g_new0 (WDiff, 1);
+    dview->file[DIFF_LEFT] = bench_file[DIFF_LEFT];
+    dview->file[DIFF_RIGHT] = bench_file[DIFF_RIGHT];
+    dview->dsrc = DATA_SRC_MEM;
+    dview->a[DIFF_LEFT] = g_array_new (FALSE, FALSE, sizeof (DIFFLN));
+    dview->a[DIFF_RIGHT] = g_array_new (FALSE, FALSE, sizeof (DIFFLN));
+
+    printf ("%d lines, about %d edits\n", BENCH_LINES, BENCH_EDITS);
+    timer = g_timer_new ();
+
+    for (i = 0; i < BENCH_RUNS && ndiff >= 0; i++)
+    {
+        bench_free_lines (dview);
+        ndiff = redo_diff (dview);
+        nlines = dview->a[DIFF_LEFT]->len;
+    }
+    bench_report ("built-in diff", timer, ndiff, nlines);
+    ret |= ndiff < 0 ? 1 : 0;
+
+    for (i = 0; i < BENCH_RUNS && ndiff >= 0; i++)
+    {
+        bench_free_lines (dview);
+        ndiff = bench_external (dview);
+        nlines = dview->a[DIFF_LEFT]->len;
+    }
+    bench_report ("diff(1) through popen()", timer, ndiff, nlines);
+    ret |= ndiff < 0 ? 1 : 0;
+
+    g_timer_destroy (timer);
+    bench_free_lines (dview);
+    g_array_free (dview->a[DIFF_LEFT], TRUE);
+    g_array_free (dview->a[DIFF_RIGHT], TRUE);
+    g_free (dview);
+
+    for (i = DIFF_LEFT; i < DIFF_COUNT; i++)
+    {
+        (void) unlink (bench_file[i]);
+        g_free (bench_file[i]);
+    }
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,257 @@
+/*
+   src/editor - block insert and write benchmark
+
+   Copyright (C) 2013
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   This is not a part of the test suite. Build and run it by hand:
+
+   make -C tests/src/editor edit_bench
+   tests/src/editor/edit_bench
+
+   50 MB of text is inserted into the editor and written to a file. edit_insert_chunk() and
+   edit_write_stream() are compared against edit_insert() and fputc() called for every byte,
+   as inserting and saving files did before.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include "src/editor/edit.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define BENCH_TEXT_LEN (50 * 1024 * 1024)
+
+static char *bench_text = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+int
+lock_file (const vfs_path_t * fname_vpath)
+{
+    (void) fname_vpath;
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_make_text (void)
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz     \t\n";
+    GRand *rand;
+    gsize i;
+
+    bench_text = g_malloc (BENCH_TEXT_LEN);
+
+    rand = g_rand_new_with_seed (BENCH_TEXT_LEN);
+    for (i = 0; i < BENCH_TEXT_LEN; i++)
+        bench_text[i] = alphabet[g_rand_int_range (rand, 0, sizeof (alphabet) - 1)];
+    g_rand_free (rand);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Create empty editor like edit_init() does for a new file */
+
+static WEdit *
+bench_edit_new (void)
+{
+    WEdit *edit;
+
+    edit = g_new0 (WEdit, 1);
+    edit_journal_init (&edit->undo_journal);
+    edit_journal_init (&edit->redo_journal);
+    edit_init_buffers (edit);
+    edit->total_lines = 0;
+    edit->loading_done = 1;
+    edit->lb = LB_ASIS;
+
+    /* text is inserted by one key press */
+    edit_push_undo_offset (edit, KEY_PRESS, 0);
+
+    return edit;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_edit_free (WEdit * edit)
+{
+    edit_free_buffers (edit->buffers1);
+    edit_free_buffers (edit->buffers2);
+    edit_line_index_free (edit);
+    edit_journal_free (&edit->undo_journal);
+    edit_journal_free (&edit->redo_journal);
+    g_free (edit);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Write the text like edit_write_stream() did before: fputc() for every byte */
+
+static off_t
+bench_write_bytes (WEdit * edit, FILE * f)
+{
+    off_t i;
+
+    for (i = 0; i < edit->last_byte; i++)
+    {
+        unsigned char c = edit_get_byte (edit, i);
+
+        if (edit->lb == LB_ASIS || !(c == '\n' || c == '\r'))
+        {
+            if (fputc (c, f) < 0)
+                return i;
+        }
+        else
+        {
+            /* replace '\n' or '\r' to "\r\n" */
+            if (fputc ('\r', f) < 0 || fputc ('\n', f) < 0)
+                return i;
+            if (c == '\r' && edit_get_byte (edit, i + 1) == '\n')
+                i++;
+        }
+    }
+
+    return i;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write the text to the file and read it back.
+ *
+ * @return contents of the file, NULL on error
+ */
+
+static char *
+bench_write (WEdit * edit, LineBreaks lb, gboolean by_bytes, const char *filename, GTimer * timer,
+             gsize * len)
+{
+    FILE *f;
+    char *text = NULL;
+    off_t written;
+
+    f = fopen (filename, "w");
+    if (f == NULL)
+        return NULL;
+
+    edit->lb = lb;
+    g_timer_start (timer);
+    written = by_bytes ? bench_write_bytes (edit, f) : edit_write_stream (edit, f);
+    if (fclose (f) == 0 && written == edit->last_byte)
+        printf ("    %-28s %9.1f ms\n", by_bytes ? "fputc() for every byte" : "edit_write_stream()",
+                g_timer_elapsed (timer, NULL) * 1000.0);
+    else
+        written = -1;
+
+    if (written != -1 && !g_file_get_contents (filename, &text, len, NULL))
+        text = NULL;
+
+    return text;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write the text by bytes and by blocks.
+ *
+ * @return TRUE if both ways gave the same file
+ */
+
+static gboolean
+bench_write_both (WEdit * edit, LineBreaks lb, const char *filename, GTimer * timer)
+{
+    char *old_text, *new_text;
+    gsize old_len = 0, new_len = 0;
+    gboolean same;
+
+    printf ("write, %s\n", lb == LB_ASIS ? "line breaks as is" : "line breaks to CR LF");
+
+    old_text = bench_write (edit, lb, TRUE, filename, timer, &old_len);
+    new_text = bench_write (edit, lb, FALSE, filename, timer, &new_len);
+
+    same = old_text != NULL && new_text != NULL && old_len == new_len
+        && memcmp (old_text, new_text, old_len) == 0;
+
+    g_free (old_text);
+    g_free (new_text);
+
+    return same;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    WEdit *old_edit, *new_edit;
+    GTimer *timer;
+    char *filename;
+    off_t i;
+    int ret = 0;
+
+    bench_make_text ();
+    printf ("%d bytes\n", BENCH_TEXT_LEN);
+    timer = g_timer_new ();
+
+    printf ("insert\n");
+
+    old_edit = bench_edit_new ();
+    g_timer_start (timer);
+    for (i = 0; i < BENCH_TEXT_LEN; i++)
+        edit_insert (old_edit, bench_text[i]);
+    printf ("    %-28s %9.1f ms\n", "edit_insert() for every byte",
+            g_timer_elapsed (timer, NULL) * 1000.0);
+
+    /* the same blocks as edit_insert_file() reads */
+    new_edit = bench_edit_new ();
+    g_timer_start (timer);
+    for (i = 0; i < BENCH_TEXT_LEN; i += EDIT_BUF_SIZE)
+        edit_insert_chunk (new_edit, bench_text + i, MIN (EDIT_BUF_SIZE, BENCH_TEXT_LEN - i));
+    printf ("    %-28s %9.1f ms\n", "edit_insert_chunk()", g_timer_elapsed (timer, NULL) * 1000.0);
+
+    if (old_edit->last_byte != new_edit->last_byte
+        || old_edit->total_lines != new_edit->total_lines
+        || old_edit->undo_journal.records->len != new_edit->undo_journal.records->len)
+    {
+        fprintf (stderr, "insert: editors differ\n");
+        ret = 1;
+    }
+    bench_edit_free (old_edit);
+
+    filename = g_build_filename (g_get_tmp_dir (), "mc-edit-bench", (char *) NULL);
+    if (!bench_write_both (new_edit, LB_ASIS, filename, timer)
+        || !bench_write_both (new_edit, LB_WIN, filename, timer))
+    {
+        fprintf (stderr, "write: files differ\n");
+        ret = 1;
+    }
+    (void) unlink (filename);
+    g_free (filename);
+
+    g_timer_destroy (timer);
+    bench_edit_free (new_edit);
+    g_free (bench_text);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,350 @@
+/*
+   src/editor - syntax highlighting redraw benchmark
+
+   Copyright (C) 2013
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   This is not a part of the test suite. Build and run it by hand:
+
+   make -C tests/src/editor syntax_bench
+   tests/src/editor/syntax_bench
+
+   A C file of 200000 lines is highlighted with misc/syntax/c.syntax the way the editor
+   redraws its screen: every byte of every visible line gets its color.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include "src/editor/syntax.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define BENCH_LINES 200000
+#define BENCH_SCREEN_LINES 50
+#define BENCH_SCREEN_COLS 80
+#define BENCH_KEYSTROKES 1000
+
+/* text is kept in a gap buffer like the editor does */
+static char *bench_buf = NULL;
+static off_t bench_size = 0;
+static off_t bench_gap_start = 0;
+static off_t bench_gap_end = 0;
+
+/* start offsets of lines of the original text */
+static off_t *bench_line = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+int
+edit_get_byte (const WEdit * edit, off_t byte_index)
+{
+    if (byte_index < 0 || byte_index >= edit->last_byte)
+        return '\n';
+
+    if (byte_index >= bench_gap_start)
+        byte_index += bench_gap_end - bench_gap_start;
+
+    return (unsigned char) bench_buf[byte_index];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+off_t
+edit_bol (const WEdit * edit, off_t current)
+{
+    if (current > edit->last_byte)
+        current = edit->last_byte;
+
+    for (; current > 0; current--)
+        if (edit_get_byte (edit, current - 1) == '\n')
+            break;
+
+    return current;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gboolean
+tty_use_colors (void)
+{
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+int
+tty_try_alloc_color_pair (const char *fg, const char *bg, const char *attrs)
+{
+    (void) fg;
+    (void) bg;
+    (void) attrs;
+
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+tty_color_free_all_tmp (void)
+{
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gchar *
+mc_skin_get (const gchar * group, const gchar * key, const gchar * default_value)
+{
+    (void) group;
+    (void) key;
+
+    return g_strdup (default_value);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    va_list args;
+
+    (void) flags;
+
+    fprintf (stderr, "%s: ", title);
+    va_start (args, text);
+    vfprintf (stderr, text, args);
+    va_end (args);
+    fprintf (stderr, "\n");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_make_text (void)
+{
+    static const char *const lines[] = {
+        "/* --------------------------------------------------------------------------- */\n",
+        "/** Comment of function number %d */\n",
+        "\n",
+        "#include <stdio.h>\n",
+        "#define BENCH_%d(x) ((x) * 2)\n",
+        "static int\n",
+        "bench_function_%d (const char *text, int count)\n",
+        "{\n",
+        "    int i, total = 0;  /* counter */\n",
+        "\n",
+        "    for (i = 0; i < count; i++)\n",
+        "        if (text[i] == '\\n' || text[i] == 0x20)\n",
+        "            total += BENCH_%d (i);\n",
+        "    printf (\"%%d: \\\"%%s\\\"\\n\", total, text);\n",
+        "    return total;\n",
+        "}\n"
+    };
+    GString *text;
+    size_t i;
+
+    text = g_string_sized_new (BENCH_LINES * 32);
+    bench_line = g_new (off_t, BENCH_LINES + 1);
+
+    for (i = 0; i < BENCH_LINES; i++)
+    {
+        bench_line[i] = text->len;
+        g_string_append_printf (text, lines[i % G_N_ELEMENTS (lines)],
+                                (int) (i / G_N_ELEMENTS (lines)));
+    }
+    bench_line[BENCH_LINES] = text->len;
+
+    /* room for typed text */
+    bench_size = text->len + BENCH_KEYSTROKES;
+    bench_buf = g_malloc (bench_size);
+    memcpy (bench_buf, text->str, text->len);
+    bench_gap_start = text->len;
+    bench_gap_end = bench_size;
+
+    g_string_free (text, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_move_gap (off_t offset)
+{
+    off_t gap = bench_gap_end - bench_gap_start;
+
+    if (offset < bench_gap_start)
+        memmove (bench_buf + offset + gap, bench_buf + offset, bench_gap_start - offset);
+    else if (offset > bench_gap_start)
+        memmove (bench_buf + bench_gap_start, bench_buf + bench_gap_end, offset - bench_gap_start);
+
+    bench_gap_start = offset;
+    bench_gap_end = offset + gap;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Insert the character like edit_insert() does */
+
+static void
+bench_insert (WEdit * edit, off_t offset, char c)
+{
+    edit_syntax_change (edit, offset, 1);
+
+    bench_move_gap (offset);
+    bench_buf[bench_gap_start++] = c;
+    edit->last_byte++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Color the screen starting at the line @top like edit_draw_this_line() does.
+ *
+ * @return sum of colors so that the work cannot be optimized out
+ */
+
+static long
+bench_redraw (WEdit * edit, off_t top)
+{
+    long sum = 0;
+    off_t p = top;
+    int row;
+
+    for (row = 0; row < BENCH_SCREEN_LINES && p < edit->last_byte; row++)
+    {
+        int col;
+
+        for (col = 0; col < BENCH_SCREEN_COLS && p < edit->last_byte; col++, p++)
+        {
+            if (edit_get_byte (edit, p) == '\n')
+                break;
+            sum += edit_get_syntax_color (edit, p);
+        }
+
+        /* skip the rest of line */
+        while (p < edit->last_byte && edit_get_byte (edit, p) != '\n')
+            p++;
+        p++;
+    }
+
+    return sum;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_report (const char *what, GTimer * timer, int count)
+{
+    double elapsed;
+
+    elapsed = g_timer_elapsed (timer, NULL);
+    printf ("%-44s %9.3f ms total, %9.4f ms per redraw\n", what, elapsed * 1000.0,
+            elapsed * 1000.0 / count);
+    g_timer_start (timer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    WEdit *edit;
+    GTimer *timer;
+    char *syntax_file, *rules;
+    off_t bottom, middle;
+    long sum = 0;
+    int i, ret;
+
+    bench_make_text ();
+
+    edit = g_new0 (WEdit, 1);
+    edit->last_byte = bench_line[BENCH_LINES];
+
+    /* the type is given explicitly, so only c.syntax is read */
+    syntax_file = g_build_filename (g_get_tmp_dir (), "mc-syntax-bench", (char *) NULL);
+    rules = g_strdup_printf ("file ..\\*\\\\.c$ C\\sProgram\ninclude %s/c.syntax\n",
+                             TEST_SYNTAX_DIR);
+    ret = g_file_set_contents (syntax_file, rules, -1, NULL) ? 0 : 1;
+    if (ret == 0)
+        ret = edit_read_syntax_file (edit, NULL, syntax_file, "bench.c", "", "C Program");
+    (void) unlink (syntax_file);
+    g_free (syntax_file);
+    g_free (rules);
+
+    if (ret != 0 || edit->rules == NULL)
+    {
+        fprintf (stderr, "cannot load %s/c.syntax\n", TEST_SYNTAX_DIR);
+        return 1;
+    }
+
+    bottom = bench_line[BENCH_LINES - BENCH_SCREEN_LINES];
+    middle = bench_line[BENCH_LINES / 2];
+
+    printf ("%d lines, %ld bytes\n", BENCH_LINES, (long) edit->last_byte);
+    timer = g_timer_new ();
+
+    /* open the file and go to its end */
+    sum += bench_redraw (edit, 0);
+    sum += bench_redraw (edit, bottom);
+    bench_report ("open, jump to end", timer, 2);
+
+    /* jump between the beginning and the end of the file */
+    for (i = 0; i < 20; i++)
+    {
+        sum += bench_redraw (edit, 0);
+        sum += bench_redraw (edit, bottom);
+    }
+    bench_report ("jump top <-> end, 20 times", timer, 40);
+
+    /* scroll through the file line by line upwards */
+    for (i = BENCH_LINES / 2; i > BENCH_LINES / 2 - 2000; i--)
+        sum += bench_redraw (edit, bench_line[i]);
+    bench_report ("scroll up 2000 lines from the middle", timer, 2000);
+
+    /* type at the top of the file, then look at the end */
+    for (i = 0; i < BENCH_KEYSTROKES / 2; i++)
+    {
+        bench_insert (edit, bench_line[10] + 8, 'x');
+        sum += bench_redraw (edit, 0);
+    }
+    bench_report ("type in line 10, redraw top", timer, BENCH_KEYSTROKES / 2);
+
+    sum += bench_redraw (edit, bottom + BENCH_KEYSTROKES / 2);
+    bench_report ("then jump to end", timer, 1);
+
+    /* type in the middle of the file */
+    middle += BENCH_KEYSTROKES / 2;
+    for (i = 0; i < BENCH_KEYSTROKES / 2; i++)
+    {
+        bench_insert (edit, middle + 200 + i, 'y');
+        sum += bench_redraw (edit, middle);
+    }
+    bench_report ("type in the middle, redraw middle", timer, BENCH_KEYSTROKES / 2);
+
+    printf ("checksum %ld\n", sum);
+
+    g_timer_destroy (timer);
+    edit_free_syntax_rules (edit);
+    g_free (edit);
+    g_free (bench_line);
+    g_free (bench_buf);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
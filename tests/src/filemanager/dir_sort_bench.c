@@ -0,0 +1,217 @@
+/*
+   src/filemanager - sorting of directory list benchmark
+
+   Copyright (C) 2013
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   This is not a part of the test suite. Build and run it by hand:
+
+   make -C tests/src/filemanager dir_sort_bench
+   tests/src/filemanager/dir_sort_bench
+
+   A panel of 1000000 entries is sorted by name, by extension, by size, by name in reverse order
+   and by name again, the way a user switches the sort order. do_sort() is compared against
+   qsort() with sort keys created for every sorting and freed after it, as do_sort() did before.
+ */
+
+#include <config.h>
+
+#include <locale.h>
+#include <stdio.h>
+
+#include "src/filemanager/dir.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define BENCH_ENTRIES 1000000
+
+static const struct
+{
+    const char *what;
+    sortfn *sort;
+    gboolean reverse;
+} bench_steps[] =
+{
+    /* *INDENT-OFF* */
+    { "by name", (sortfn *) sort_name, FALSE },
+    { "by extension", (sortfn *) sort_ext, FALSE },
+    { "by size", (sortfn *) sort_size, FALSE },
+    { "by name, reverse", (sortfn *) sort_name, TRUE },
+    { "by name again", (sortfn *) sort_name, FALSE }
+    /* *INDENT-ON* */
+};
+
+#define BENCH_STEPS G_N_ELEMENTS (bench_steps)
+
+/* unsorted entries, both ways of sorting start with them */
+static file_entry *bench_entries = NULL;
+
+/* names in the order got by qsort() after every step */
+static char **bench_order[BENCH_STEPS];
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_make_entries (void)
+{
+    static const char *const stems[] = {
+        "Makefile", "README", "backup", "config", "data", "image", "index", "main", "notes",
+        "report", "screenshot", "test", "Photo", "video", "zzz"
+    };
+    static const char *const exts[] = {
+        "c", "h", "txt", "tar.gz", "jpg", "png", "o", "html", "", "md", "log"
+    };
+    GRand *rand;
+    int i;
+
+    rand = g_rand_new_with_seed (BENCH_ENTRIES);
+    bench_entries = g_new0 (file_entry, BENCH_ENTRIES);
+
+    for (i = 0; i < BENCH_ENTRIES; i++)
+    {
+        file_entry *fe = &bench_entries[i];
+        const char *ext;
+
+        /* the number makes every name unique regardless of case */
+        ext = exts[g_rand_int_range (rand, 0, G_N_ELEMENTS (exts))];
+        fe->fname = g_strdup_printf ("%s_%d%s%s",
+                                     stems[g_rand_int_range (rand, 0, G_N_ELEMENTS (stems))],
+                                     g_rand_int_range (rand, 0, BENCH_ENTRIES) * 16 + i % 16,
+                                     *ext != '\0' ? "." : "", ext);
+        fe->fnamelen = strlen (fe->fname);
+        /* every 20th entry is a directory */
+        fe->st.st_mode = g_rand_int_range (rand, 0, 20) == 0 ? S_IFDIR | 0755 : S_IFREG | 0644;
+        fe->st.st_size = g_rand_int_range (rand, 0, 1000);
+        fe->st.st_mtime = g_rand_int_range (rand, 0, 1000000);
+    }
+
+    g_rand_free (rand);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Sort like do_sort() did before: qsort() and release keys after it */
+
+static void
+bench_qsort (dir_list * list, sortfn * sort, int top, gboolean reverse_f)
+{
+    int i;
+
+    reverse = reverse_f ? -1 : 1;
+    case_sensitive = 0;
+    exec_first = TRUE;
+
+    qsort (list->list, top + 1, sizeof (file_entry), sort);
+
+    for (i = 0; i <= top; i++)
+        release_sort_keys (&list->list[i]);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Run all steps of sorting a copy of the entries.
+ *
+ * @param use_qsort TRUE to sort with qsort(), FALSE to sort with do_sort()
+ *
+ * @return number of steps that gave the order different from the qsort() one
+ */
+
+static int
+bench_run (gboolean use_qsort)
+{
+    dir_list list;
+    GTimer *timer;
+    size_t step;
+    int i, ret = 0;
+
+    list.size = BENCH_ENTRIES;
+    list.list = g_memdup (bench_entries, sizeof (file_entry) * BENCH_ENTRIES);
+
+    printf ("%s\n", use_qsort ? "qsort(), keys created for every sorting" : "do_sort()");
+    timer = g_timer_new ();
+
+    for (step = 0; step < BENCH_STEPS; step++)
+    {
+        gboolean same = TRUE;
+
+        g_timer_start (timer);
+        if (use_qsort)
+            bench_qsort (&list, bench_steps[step].sort, BENCH_ENTRIES - 1,
+                         bench_steps[step].reverse);
+        else
+            do_sort (&list, bench_steps[step].sort, BENCH_ENTRIES - 1, bench_steps[step].reverse,
+                     FALSE, TRUE);
+        printf ("    %-20s %9.1f ms\n", bench_steps[step].what,
+                g_timer_elapsed (timer, NULL) * 1000.0);
+
+        if (use_qsort)
+            bench_order[step] = g_new (char *, BENCH_ENTRIES);
+
+        for (i = 0; i < BENCH_ENTRIES; i++)
+            if (use_qsort)
+                bench_order[step][i] = list.list[i].fname;
+            else
+                same = same && bench_order[step][i] == list.list[i].fname;
+
+        if (!same)
+        {
+            fprintf (stderr, "%s: order differs from the qsort() one\n", bench_steps[step].what);
+            ret++;
+        }
+    }
+
+    g_timer_destroy (timer);
+
+    /* names belong to bench_entries */
+    for (i = 0; i < BENCH_ENTRIES; i++)
+        release_sort_keys (&list.list[i]);
+    g_free (list.list);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    size_t step;
+    int i, ret;
+
+    (void) setlocale (LC_ALL, "");
+    str_init_strings (NULL);
+    panels_options.mix_all_files = FALSE;
+
+    bench_make_entries ();
+    printf ("%d entries\n", BENCH_ENTRIES);
+
+    ret = bench_run (TRUE);
+    ret += bench_run (FALSE);
+
+    for (step = 0; step < BENCH_STEPS; step++)
+        g_free (bench_order[step]);
+    for (i = 0; i < BENCH_ENTRIES; i++)
+        g_free (bench_entries[i].fname);
+    g_free (bench_entries);
+    str_uninit_strings ();
+
+    return ret == 0 ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */